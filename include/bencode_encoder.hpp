@@ -6,8 +6,19 @@
 class BencodeEncoder {
 public:
     static std::string encode(const BencodedValue& value);
+    // Encode into a caller-provided buffer, e.g. a pooled packet. Returns the
+    // encoded length; if that exceeds capacity, only capacity bytes were written.
+    static size_t encode(const BencodedValue& value, char* out, size_t capacity);
     
 private:
+    struct Sink {
+        char* out;
+        size_t capacity;
+        size_t length;
+        void append(const char* data, size_t size);
+    };
+
+    static void encodeTo(const BencodedValue& value, Sink& sink);
     static std::string encodeInt(int64_t value);
     static std::string encodeString(const std::string& value);
     static std::string encodeList(const BencodedList& list);
@@ -5,6 +5,7 @@
 #include <vector>
 #include <map>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <stdexcept>
 
@@ -62,18 +63,19 @@ struct BencodedValue {
 // BencodeParser class declaration
 class BencodeParser {
 public:
-    // Parse a bencoded string into a BencodedValue
-    BencodedValue parse(const std::string& data);
+    // Parse a bencoded string into a BencodedValue. The input is only read
+    // during the call, so a received datagram can be parsed in place.
+    BencodedValue parse(std::string_view data);
 
 private:
     // Helper functions for parsing specific types
-    int64_t parseInt(const std::string& data, size_t& pos);
-    std::string parseString(const std::string& data, size_t& pos);
-    BencodedList parseList(const std::string& data, size_t& pos);
-    BencodedDict parseDict(const std::string& data, size_t& pos);
+    int64_t parseInt(std::string_view data, size_t& pos);
+    std::string parseString(std::string_view data, size_t& pos);
+    BencodedList parseList(std::string_view data, size_t& pos);
+    BencodedDict parseDict(std::string_view data, size_t& pos);
 
     // Main parsing function
-    BencodedValue parseValue(const std::string& data, size_t& pos);
+    BencodedValue parseValue(std::string_view data, size_t& pos);
 };
 
 #endif // BENCODE_PARSER_HPP
\ No newline at end of file
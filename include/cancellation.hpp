@@ -0,0 +1,40 @@
+#ifndef CANCELLATION_HPP
+#define CANCELLATION_HPP
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace DHT {
+
+    // Shared cancellation flag. Copies observe the same state. cancel() runs
+    // every registered callback once, on the cancelling thread and without
+    // the internal lock held, so callbacks may call remove().
+    class CancellationToken {
+    public:
+        CancellationToken();
+
+        void cancel();
+        bool cancelled() const;
+
+        // Register a callback for cancel(). Runs it immediately and returns 0
+        // if the token is already cancelled.
+        size_t on_cancel(std::function<void()> callback);
+        void remove(size_t id);
+
+    private:
+        struct State {
+            bool cancelled = false;
+            size_t next_id = 1;
+            std::map<size_t, std::function<void()>> callbacks;
+            std::mutex mutex;
+        };
+
+        std::shared_ptr<State> state_;
+    };
+
+} // namespace DHT
+
+#endif // CANCELLATION_HPP
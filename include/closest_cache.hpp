@@ -0,0 +1,49 @@
+#ifndef CLOSEST_CACHE_HPP
+#define CLOSEST_CACHE_HPP
+
+#include "dht_types.hpp"
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace DHT {
+
+    // Recently discovered closest-node sets, keyed by the first prefix_bits
+    // bits of the lookup target. A lookup for a target in the same prefix
+    // starts from nodes that were among the closest to a nearby target a
+    // short while ago, so it converges in one or two hops instead of
+    // walking down from the routing table again.
+    //
+    // Entries expire after ttl; when full, the least recently stored entry
+    // is dropped. Thread-safe.
+    class ClosestCache {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        ClosestCache(unsigned prefix_bits, std::chrono::seconds ttl, size_t capacity);
+
+        void store(const NodeID& target, const std::vector<Node>& closest);
+        std::vector<Node> seeds(const NodeID& target, size_t k) const; // Closest first; empty on miss
+        size_t size() const;
+
+    private:
+        struct Entry {
+            std::vector<Node> nodes;
+            Clock::time_point stored;
+        };
+
+        uint64_t key(const NodeID& target) const;
+        void evict(Clock::time_point now);  // Requires mutex_
+
+        unsigned prefix_bits_;
+        std::chrono::seconds ttl_;
+        size_t capacity_;
+        std::unordered_map<uint64_t, Entry> entries_;
+        mutable std::mutex mutex_;
+    };
+
+} // namespace DHT
+
+#endif // CLOSEST_CACHE_HPP
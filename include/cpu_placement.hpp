@@ -0,0 +1,43 @@
+#ifndef CPU_PLACEMENT_HPP
+#define CPU_PLACEMENT_HPP
+
+#include <cstddef>
+
+namespace DHT {
+
+    // Core and NUMA placement helpers for DHT worker threads. Everything here
+    // degrades to a no-op (returning false / -1) on platforms without the
+    // corresponding facility.
+
+    bool pin_current_thread(int cpu);           // Restrict the calling thread to one CPU
+    int current_cpu();                          // CPU the caller is running on, or -1
+    int numa_node_of_cpu(int cpu);              // NUMA node owning a CPU, or -1 if unknown
+    bool set_incoming_cpu(int sock, int cpu);   // SO_INCOMING_CPU: steer the flow's softirq CPU
+    bool enable_reuseport(int sock);            // SO_REUSEPORT, set before bind()
+
+    // Memory block placed on a given NUMA node (preferred policy, then
+    // first-touched by the caller). Falls back to ordinary heap memory.
+    class LocalBuffer {
+    public:
+        LocalBuffer() = default;
+        LocalBuffer(size_t size, int numa_node);
+        ~LocalBuffer();
+        LocalBuffer(LocalBuffer&& other) noexcept;
+        LocalBuffer& operator=(LocalBuffer&& other) noexcept;
+        LocalBuffer(const LocalBuffer&) = delete;
+        LocalBuffer& operator=(const LocalBuffer&) = delete;
+
+        char* data() { return data_; }
+        size_t size() const { return size_; }
+
+    private:
+        void release();
+
+        char* data_ = nullptr;
+        size_t size_ = 0;
+        bool mapped_ = false;
+    };
+
+} // namespace DHT
+
+#endif // CPU_PLACEMENT_HPP
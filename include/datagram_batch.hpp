@@ -0,0 +1,87 @@
+#ifndef DATAGRAM_BATCH_HPP
+#define DATAGRAM_BATCH_HPP
+
+#include "packet_pool.hpp"
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+#else
+    #include <netinet/in.h>
+    #include <sys/socket.h>
+#endif
+
+namespace DHT {
+
+    struct Datagram {
+        Packet data;
+        sockaddr_in addr;
+    };
+
+    // Receive slots for one batch of datagrams, each a packet from a pool.
+    // On Linux a whole batch is read with a single recvmmsg(); elsewhere
+    // receive() loops over recvmsg() (recvfrom() on Windows) into the same
+    // slots. Datagrams longer than a packet are dropped (a cut-off KRPC
+    // message is useless) and counted in truncated(). The slots are only
+    // valid until the next receive().
+    class ReceiveRing {
+    public:
+        ReceiveRing(size_t slots, PacketPool& pool);
+        ReceiveRing(const ReceiveRing&) = delete;
+        ReceiveRing& operator=(const ReceiveRing&) = delete;
+
+        // Fill up to slots() datagrams without blocking. Returns the number
+        // read, or -1 if the first read failed (errno / WSAGetLastError()).
+        int receive(int sock);
+        // Read one datagram into packet, outside the slots. Returns its
+        // length, or -1 as above.
+        int receive_one(int sock, Packet& packet, sockaddr_in& sender);
+
+        size_t slots() const { return lengths_.size(); }
+        const char* data(size_t slot) const { return packets_[slot].data(); }
+        size_t length(size_t slot) const { return lengths_[slot]; }
+        const sockaddr_in& sender(size_t slot) const { return senders_[slot]; }
+        Packet take(size_t slot);   // Move a slot's packet out (sized to the datagram); refilled next receive()
+        // Datagrams longer than a packet so far; readable from any thread
+        uint64_t truncated() const { return truncated_.load(std::memory_order_relaxed); }
+
+    private:
+        void refill();
+
+        PacketPool& pool_;
+        std::vector<Packet> packets_;                   // Empty slots are refilled by receive()
+        std::atomic<uint64_t> truncated_{0};
+        std::vector<size_t> lengths_;
+        std::vector<sockaddr_in> senders_;
+#ifdef __linux__
+        std::vector<struct mmsghdr> headers_;
+        std::vector<struct iovec> vectors_;
+#endif
+    };
+
+    // Sends the front of a queue of datagrams, up to a batch per call: one
+    // sendmmsg() on Linux, a sendto() loop elsewhere. The message headers
+    // point into the queued packets, so nothing is copied.
+    class SendBatch {
+    public:
+        explicit SendBatch(size_t capacity);
+
+        // Returns how many datagrams from the front of the queue were sent
+        // (in order), or -1 if the first one failed (errno / WSAGetLastError()).
+        int send(int sock, const std::deque<Datagram>& queue);
+
+    private:
+        size_t capacity_;
+#ifdef __linux__
+        std::vector<struct mmsghdr> headers_;
+        std::vector<struct iovec> vectors_;
+#endif
+    };
+
+} // namespace DHT
+
+#endif // DATAGRAM_BATCH_HPP
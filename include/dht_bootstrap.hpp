@@ -2,6 +2,26 @@
 #define DHT_BOOTSTRAP_HPP
 
 #include "bencode_parser.hpp"
+#include "dht_types.hpp"
+#include "dht_config.hpp"
+#include "routing_table.hpp"
+#include "node_trie.hpp"
+#include "shared_contacts.hpp"
+#include "cpu_placement.hpp"
+#include "transaction_manager.hpp"
+#include "lookup.hpp"
+#include "multi_lookup.hpp"
+#include "disjoint_lookup.hpp"
+#include "closest_cache.hpp"
+#include "rtt_estimator.hpp"
+#include "timer_queue.hpp"
+#include "host_resolver.hpp"
+#include "event_loop.hpp"
+#include "datagram_batch.hpp"
+#include "uring_socket.hpp"
+#include "socket_shard.hpp"
+#include "pipeline.hpp"
+#include "mpsc_queue.hpp"
 #include <vector>
 #include <array>
 #include <iostream>
@@ -9,6 +29,13 @@
 #include <cstdint>
 #include <cstring>
 #include <algorithm>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
 
 #ifdef _WIN32
     #include <winsock2.h>
@@ -28,50 +55,153 @@
 
 namespace DHT {
 
-    constexpr uint16_t DHT_PORT = 6881;
-    constexpr size_t NODE_ID_SIZE = 20;
-    constexpr size_t K = 8;
-
-    using NodeID = std::array<uint8_t, NODE_ID_SIZE>;
-
-    struct Node {
-        NodeID id;
-        std::string ip;
-        uint16_t port;
-
-        bool operator==(const Node& other) const {
-            return id == other.id && ip == other.ip && port == other.port;
-        }
-    };
-
-    using Bucket = std::vector<Node>;
-
     class DHTBootstrap {
     public:
-        DHTBootstrap(const NodeID& my_node_id);
+        DHTBootstrap(const NodeID& my_node_id, const DHTConfig& config = DHTConfig());
         // ~DHTBootstrap();
-        void add_bootstrap_node(const std::string& ip, uint16_t port);
-        void bootstrap();
-        const std::vector<Bucket>& get_routing_table() const;
+        void add_bootstrap_node(const std::string& host, uint16_t port); // IPv4 literal or hostname (resolved in the background)
+        void bootstrap();                                   // Blocks until the table is usable
+        void bootstrap(std::function<void(size_t)> done);   // done(routing table size)
+        std::vector<Bucket> get_routing_table() const; // Snapshot copy
         const std::vector<Node> get_bootstrap_nodes();
+
+        // Virtual identities hosted on the same socket, contact pool and peer
+        // store. Index 0 is the primary identity (my_node_id). Each remote
+        // address is assigned one identity (by hash), and every query to and
+        // reply from it carries that ID; all replies are served from the
+        // shared contact pool.
+        size_t add_identity(const NodeID& id);
+        size_t identity_count() const;
+        const NodeID& identity_id(size_t index) const;
+        std::vector<Bucket> get_routing_table(size_t identity) const;
+        std::vector<Node> get_contacts() const;
         static NodeID generate_random_node_id();
         std::vector<Node> send_find_node_request(const Node& remote_node, const NodeID& target_id); // find peers
-        void run(); // Main loop for handling incoming messages
+        void run(); // Main loop for handling incoming messages; returns after stop()
+        void stop();
+        size_t run_once(std::chrono::milliseconds timeout); // One loop iteration, for embedding
+
+        // Send a KRPC query on the shared socket without blocking. "id" is
+        // filled in if args lacks it. The callback runs exactly once (response,
+        // error or timeout) on whichever thread is pumping the socket, unless
+        // the query is cancelled. Returns the transaction ID, or an empty
+        // string if the query already failed.
+        std::string send_query(const Node& node, const std::string& method, BencodedDict args,
+                               QueryCallback callback);
+        std::string send_query(const Node& node, const std::string& method, BencodedDict args,
+                               QueryCallback callback, std::chrono::milliseconds timeout);
+        bool cancel_query(const std::string& transaction_id); // Free the slot; no callback
+        void ping(const Node& node, std::function<void(bool)> done);
+        size_t pending_queries() const;
+        bool send_backlogged() const;                   // Socket buffer full; queued sends are waiting
+        PacketPool::Stats packet_pool_stats() const;    // Primary socket's pool (shards have their own)
+        uint64_t truncated_datagrams() const;           // Longer than packet_size, on the primary socket
+        uint64_t unmatched_replies() const;             // Late or stray responses/errors, dropped
+        Pipeline::Stats pipeline_stats() const;         // Zeros unless run() is active with pipeline_workers
+        uint64_t shard_send_drops() const;              // Zero unless run() is active with socket_shards > 1
+        std::chrono::milliseconds query_timeout_for(const Node& node) const;
+
+        // Run fn on the thread pumping the socket after delay (tick resolution)
+        void schedule(std::chrono::milliseconds delay, std::function<void()> fn);
 
         const NodeID& getMyNodeId() const {
             return my_node_id_;
         }
         std::vector<DHT::Node> findPeers(const NodeID& info_hash);
 
+        // Iterative lookup for the K closest nodes to target. The async form
+        // calls back from the thread pumping the socket.
+        void lookup(const NodeID& target, const LookupOptions& options, LookupCallback done);
+        void lookup(const NodeID& target, LookupCallback done);
+        LookupResult lookup(const NodeID& target);
+
+        // find_node lookups for many targets whose traversals are merged while
+        // the targets share a prefix (see MultiLookup)
+        void lookup_many(const std::vector<NodeID>& targets, const LookupOptions& options,
+                         MultiLookupCallback done);
+        MultiLookupResult lookup_many(const std::vector<NodeID>& targets);
+
+        // BEP 5 peer discovery. get_peers runs an iterative get_peers lookup
+        // (max_peers > 0 stops it early); announce follows it with parallel
+        // announce_peer queries to the K closest responders using their
+        // tokens. port 0 announces with implied_port.
+        void get_peers(const NodeID& info_hash, size_t max_peers, LookupCallback done);
+        LookupResult get_peers(const NodeID& info_hash, size_t max_peers = 0);
+        void announce(const NodeID& info_hash, uint16_t port, AnnounceCallback done);
+        AnnounceResult announce(const NodeID& info_hash, uint16_t port);
 
     private:
+        // How long wait_for() blocks per turn when it pumps the socket itself
+        static constexpr int RECEIVE_TICK_MS = 50;
+        // Longest idle wait in run(); timers and query deadlines wake it sooner
+        static constexpr int IDLE_WAIT_MS = 1000;
+        // Datagrams read per wakeup (one recvmmsg()) before timers get a turn
+        static constexpr size_t RECEIVE_BATCH = 64;
+        // Datagrams per sendmmsg() when flushing the send queue
+        static constexpr size_t SEND_BATCH = 64;
+        // Provided receive buffers registered with io_uring
+        static constexpr size_t URING_BUFFERS = 512;
+        // Datagrams held while the socket buffer is full
+        static constexpr size_t MAX_QUEUED_SENDS = 4096;
+        // Announce tokens stay valid for one to two rotations (BEP 5)
+        static constexpr std::chrono::minutes TOKEN_ROTATION{5};
+
+        struct TokenSecret {
+            uint64_t k0 = 0;
+            uint64_t k1 = 0;
+        };
+
         int sock_;
+        std::unique_ptr<EventLoop> loop_;
+        PacketPool packet_pool_;                        // Receive slots and outbound datagrams
+        std::atomic<bool> stopping_{false};
+        std::atomic<TimerQueue::Clock::rep> wait_until_{TimerQueue::Clock::time_point::min().time_since_epoch().count()};
+        MpscQueue<Datagram> send_queue_;                // Any thread -> the thread pumping the socket
+        std::deque<Datagram> outgoing_;                 // Drained from send_queue_, not yet sent; guarded by pump_mutex_
+        SendBatch send_batch_;                          // Guarded by pump_mutex_
+        std::atomic<bool> send_wake_pending_{false};    // A sender woke the loop since the last flush
+        std::atomic<bool> send_backlogged_{false};      // The socket buffer was full at the last flush
+        std::atomic<uint64_t> unmatched_replies_{0};
+        TransactionManager transactions_;
+        std::recursive_mutex pump_mutex_;               // Held by whichever thread reads sock_
+        std::unique_ptr<ReceiveRing> receive_ring_;     // Guarded by pump_mutex_
+        int receive_depth_ = 0;                         // Nested receive_datagrams() calls; guarded by pump_mutex_
+        UringSocket uring_;                             // Used instead of loop_ when open; guarded by pump_mutex_
+        std::vector<std::unique_ptr<SocketShard>> shards_; // Extra sockets on the port during run(); changed under
+        mutable std::mutex shards_mutex_;               // both pump_mutex_ and this (read by shard_send_drops())
+        std::unique_ptr<Pipeline> pipeline_;            // Stages behind the primary socket during run(); set under
+        mutable std::mutex pipeline_mutex_;             // both pump_mutex_ and this (read by pipeline_stats())
+        RttEstimator rtt_;                              // Per-contact and global RTT estimates
+        TimerQueue timers_;
         // static NodeID generate_random_node_id();
-        static NodeID xor_distance(const NodeID& a, const NodeID& b);
         // std::vector<Node> send_find_node_request(const Node& remote_node, const NodeID& target_id);
         void add_to_routing_table(const Node& node);
+        void insert_with_eviction(RoutingTable& table, const Node& node);
+        size_t import_shared_contacts();
         void parse_compact_nodes(const std::string& compact, std::vector<Node>& nodes);
+        void parse_compact_peers(const std::string& compact, std::vector<Node>& peers);
         bool ping(const Node& node);
+        size_t receive_datagrams();
+        size_t receive_one();
+        size_t run_uring(std::chrono::milliseconds timeout);
+        void start_shards();
+        void stop_shards();
+        void start_pipeline();
+        void stop_pipeline();
+        bool send_message(const BencodedValue& message, const sockaddr_in& addr);
+        bool send_datagram(Packet data, const sockaddr_in& addr);
+        size_t drain_send_queue(size_t limit);
+        void flush_send_queue();
+        void queue_uring_sends();
+        void wake_if_sooner(TimerQueue::Clock::time_point when);
+        void dispatch(const char* data, size_t length, const sockaddr_in& sender_addr);
+        template <typename T>
+        T wait_for(std::future<T>& result);
+        LookupOptions default_lookup_options() const;
+        std::vector<Node> lookup_seeds(const NodeID& target, size_t k);
+        void refresh_empty_buckets(size_t rounds, size_t previous_size, std::function<void(size_t)> done);
+        void on_bootstrap_resolved(const std::vector<std::string>& addresses, uint16_t port);
+        QueryResult send_query_blocking(const Node& node, const std::string& method, BencodedDict args);
         void handle_ping(const BencodedValue& request, const sockaddr_in& sender_addr);
         std::vector<Node> find_closest_nodes(const NodeID& target_id, size_t k);
         std::string encode_nodes(const std::vector<Node>& nodes);
@@ -79,14 +209,63 @@ namespace DHT {
         void handle_find_node(const BencodedValue& request, const sockaddr_in& sender_addr);
         void handle_get_peers(const BencodedValue& request, const sockaddr_in& sender_addr);
         void handle_announce_peer(const BencodedValue& request, const sockaddr_in& sender_addr);
+        void rotate_token_secrets();                    // Requires token_mutex_
+        std::string make_token(const sockaddr_in& addr);
+        bool valid_token(const std::string& token, const sockaddr_in& addr);
         NodeID string_to_node_id(const std::string& str);
+        const RoutingTable& identity_table(size_t index) const;
+        NodeID identity_for(const sockaddr_in& addr) const;
 
+        DHTConfig config_;
         NodeID my_node_id_;
-        std::vector<Bucket> routing_table_;
+        RoutingTable routing_table_;
+        std::vector<std::unique_ptr<RoutingTable>> virtual_identities_; // Identities 1..N
+        mutable std::mutex identities_mutex_;
+        NodeTrie contacts_;                              // Routing table members + recently seen contacts,
+                                                         // deduplicated and shared by all identities
+        mutable std::shared_mutex contacts_mutex_;
+        SharedContacts shared_contacts_;                 // Optional cross-process contact table
+        ClosestCache closest_cache_;                     // Recent lookup results by target prefix
         std::vector<Node> bootstrap_nodes_;
+        size_t unresolved_bootstrap_hosts_ = 0;
+        bool bootstrap_started_ = false;                 // Seeds resolved later are queried directly
+        std::vector<std::function<void(size_t)>> bootstrap_waiting_; // bootstrap() calls before any seed resolved
+        std::mutex bootstrap_mutex_;                     // Guards the bootstrap_* members above
         std::map<std::string, std::vector<Node>> peer_store_; // Infohash -> List of peers
+        std::shared_mutex peer_store_mutex_;             // Shard workers answer get_peers concurrently
+        TokenSecret token_secrets_[2];                   // Current, previous
+        std::chrono::steady_clock::time_point token_rotated_;
+        std::mutex token_mutex_;
+        HostResolver resolver_;                          // Last member: its thread stops first
+
+        friend class Lookup;
+        friend class MultiLookup;
+        friend class LookupScheduler;
+        friend class AsyncDHT;
     };
 
+    /**
+     * @brief Block until a future is ready. If no other thread is reading the
+     *        socket, the caller pumps it itself; otherwise it waits for the
+     *        thread running run() to complete the future.
+     *
+     * @param result The future completed by a query or lookup callback.
+     *
+     * @return The future's value.
+     */
+    template <typename T>
+    T DHTBootstrap::wait_for(std::future<T>& result) {
+        while (result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            std::unique_lock<std::recursive_mutex> lock(pump_mutex_, std::try_to_lock);
+            if (lock.owns_lock()) {
+                run_once(std::chrono::milliseconds(RECEIVE_TICK_MS));
+            } else {
+                result.wait_for(std::chrono::milliseconds(RECEIVE_TICK_MS));
+            }
+        }
+        return result.get();
+    }
+
     std::string node_id_to_hex(const NodeID& id);
     bool ip_to_binary(const std::string& ip, uint32_t& binary_ip);
 
@@ -0,0 +1,74 @@
+#ifndef DHT_CONFIG_HPP
+#define DHT_CONFIG_HPP
+
+#include "dht_types.hpp"
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace DHT {
+
+    // Runtime configuration for a DHTBootstrap instance
+    struct DHTConfig {
+        uint16_t port = DHT_PORT;                 // UDP port shared by every hosted identity
+        size_t contact_pool_capacity = 100000;    // Recently seen contacts kept in the trie index
+
+        // Outbound queries on the shared socket
+        std::chrono::milliseconds query_timeout{2000}; // Deadline for a KRPC query (upper bound if adaptive)
+        bool adaptive_timeouts = true;            // Derive deadlines from per-contact RTT estimates
+        std::chrono::milliseconds min_query_timeout{150}; // Lower bound on adaptive deadlines
+        size_t max_pending_queries = 16384;       // Transaction table size (max 65536)
+
+        // Iterative lookups
+        size_t lookup_alpha = 3;                  // Queries in flight per lookup
+        size_t lookup_hedge_budget = 2;           // Extra queries per lookup for hops slower than p90 RTT
+        size_t lookup_disjoint_paths = 1;         // Disjoint paths per lookup (S/Kademlia; 1 = single path)
+        size_t lookup_path_quorum = 1;            // Paths that must finish before results are merged
+
+        // Closest-node sets from recent lookups, used to seed later lookups
+        // for targets with the same prefix
+        unsigned closest_cache_prefix_bits = 16;
+        std::chrono::seconds closest_cache_ttl{300};
+        size_t closest_cache_capacity = 4096;     // Prefixes remembered (0 = disabled)
+
+        // Bootstrap: self-lookup, then rounds of lookups into empty buckets
+        size_t bootstrap_target_size = 8 * K;     // Routing table size at which bootstrap stops
+        size_t bootstrap_rounds = 3;              // Bucket-refresh rounds at most
+        std::string resolver_cache_path;          // Resolved bootstrap hostnames, kept across restarts ("" = memory only)
+
+        // Shared-memory contact table reused by sibling processes on this host
+        std::string shared_contacts_name;         // shm_open name, e.g. "/dht-contacts" ("" = disabled)
+        size_t shared_contacts_capacity = 65536;  // Slots, when this process creates the segment
+        uint64_t shared_contacts_max_age = 15 * 60; // Seconds before a shared contact is considered stale
+
+        // Socket I/O. With io_uring (Linux 6.0+) a multishot receive fills
+        // registered buffers and sends are batched submissions; without it,
+        // or on older kernels, the loop uses epoll with recvmmsg/sendmmsg.
+        // io_uring and pipeline_workers are mutually exclusive: the ring's
+        // buffers cannot be handed to other threads, so with a pipeline the
+        // socket always uses epoll and this setting is ignored.
+        bool io_uring = true;
+        size_t packet_size = 2048;                // Pooled packet buffer size: the largest datagram received whole
+        size_t packet_pool_capacity = 16384;      // Pooled packets per socket; beyond that buffers come from the heap
+
+        // Worker placement (Linux). Each receive/handle worker is pinned to one
+        // CPU, allocates its buffers on that CPU's NUMA node and asks the kernel
+        // to steer its socket's packets to the same CPU.
+        std::vector<int> worker_cpus;             // CPU per worker; run() takes the first (empty = unpinned)
+        bool reuse_port = false;                  // SO_REUSEPORT so sharded sockets can share the port
+        size_t socket_shards = 1;                 // Sockets on the port while run() is active, one worker
+                                                  // each (worker i on worker_cpus[i]); >1 implies reuse_port
+        size_t pipeline_workers = 0;              // Parse/handle stages behind run()'s receive stage, plus a
+                                                  // send stage; they take the worker_cpus after the shards'.
+                                                  // 0 = handle inline. >0 disables io_uring (see above)
+        size_t pipeline_ring_capacity = 1024;     // Datagrams per ring between stages
+
+        // Log every datagram (hex dump and parsed form) and every reply sent.
+        // For debugging only: with shards or a pipeline the workers then
+        // serialise on stdout.
+        bool log_packets = false;
+    };
+
+} // namespace DHT
+
+#endif // DHT_CONFIG_HPP
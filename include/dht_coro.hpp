@@ -0,0 +1,199 @@
+#ifndef DHT_CORO_HPP
+#define DHT_CORO_HPP
+
+// C++20 coroutine front end for DHTBootstrap. Everything below is compiled
+// only when the compiler implements coroutines; the rest of the library
+// does not depend on it.
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include "dht_bootstrap.hpp"
+#include "cancellation.hpp"
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace DHT {
+
+    // Eagerly started coroutine that nobody awaits, e.g. one per client
+    // operation driven from the DHT thread.
+    struct DetachedTask {
+        struct promise_type {
+            DetachedTask get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    // A single-shot asynchronous DHT operation. Nothing is sent until it is
+    // awaited. The awaiting coroutine resumes on the thread pumping the
+    // socket once the operation completes, times out or is cancelled.
+    template <typename T>
+    class Operation {
+    public:
+        struct State {
+            std::optional<T> result;
+            std::coroutine_handle<> waiter;
+            bool done = false;
+            bool suspended = false;     // await_suspend() returned true
+            CancellationToken token;
+            size_t cancel_id = 0;      // Set once suspended
+            std::string transaction_id; // KRPC query in flight, if any
+            std::mutex mutex;
+
+            // Remember the query started for this operation, so a
+            // cancellation can free its transaction slot.
+            void sent(std::string id) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!done) {
+                    transaction_id = std::move(id);
+                }
+            }
+
+            // Finish with the cancelled value. The query in flight is dropped
+            // from the transaction table, so its callback never runs.
+            void cancel(DHTBootstrap& dht, T value) {
+                std::string pending;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (done) {
+                        return;
+                    }
+                    pending = std::move(transaction_id);
+                }
+                if (!pending.empty()) {
+                    dht.cancel_query(pending);
+                }
+                finish(std::move(value));
+            }
+
+            // First call wins; later results (e.g. a response after a
+            // cancellation) are dropped.
+            void finish(T value) {
+                std::coroutine_handle<> resume;
+                size_t registered;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (done) {
+                        return;
+                    }
+                    done = true;
+                    transaction_id.clear();
+                    result.emplace(std::move(value));
+                    if (suspended) {
+                        resume = waiter;
+                    }
+                    registered = cancel_id;
+                }
+                if (registered) {
+                    token.remove(registered);
+                }
+                if (resume) {
+                    resume.resume();
+                }
+            }
+        };
+
+        using Start = std::function<void(const std::shared_ptr<State>& state)>;
+
+        Operation(DHTBootstrap& dht, Start start, T cancelled, CancellationToken token)
+            : dht_(dht), start_(std::move(start)), cancelled_(std::move(cancelled)),
+              state_(std::make_shared<State>()) {
+            state_->token = std::move(token);
+        }
+
+        bool await_ready() const { return false; }
+
+        bool await_suspend(std::coroutine_handle<> waiter) {
+            state_->waiter = waiter;
+            if (state_->token.cancelled()) {
+                state_->finish(cancelled_);
+                return false;
+            }
+            start_(state_);
+
+            // Cancellation completes on the pumping thread like everything else
+            std::weak_ptr<State> weak = state_;
+            DHTBootstrap* dht = &dht_;
+            T cancelled = cancelled_;
+            size_t cancel_id = state_->token.on_cancel([weak, dht, cancelled]() {
+                dht->schedule(std::chrono::milliseconds(0), [weak, dht, cancelled]() {
+                    if (auto state = weak.lock()) {
+                        state->cancel(*dht, cancelled);
+                    }
+                });
+            });
+
+            {
+                std::lock_guard<std::mutex> lock(state_->mutex);
+                if (!state_->done) {
+                    state_->cancel_id = cancel_id;
+                    state_->suspended = true;
+                    return true;
+                }
+            }
+            // Completed synchronously; do not suspend
+            state_->token.remove(cancel_id);
+            return false;
+        }
+
+        T await_resume() { return std::move(*state_->result); }
+
+    private:
+        DHTBootstrap& dht_;
+        Start start_;
+        T cancelled_;
+        std::shared_ptr<State> state_;
+    };
+
+    struct FindNodeResult {
+        QueryResult::Status status = QueryResult::Status::Timeout;
+        std::vector<Node> nodes;    // Contacts the node returned
+        bool ok() const { return status == QueryResult::Status::Response; }
+    };
+
+    // Awaitable DHT calls, e.g.
+    //     auto nodes = co_await dht.find_node(node, target);
+    // A zero deadline means the node's usual (adaptive) query timeout for
+    // single queries and no deadline for lookups. A lookup that misses its
+    // deadline or is cancelled yields its partial result (see
+    // LookupResult::status).
+    class AsyncDHT {
+    public:
+        explicit AsyncDHT(DHTBootstrap& dht) : dht_(dht) {}
+
+        Operation<QueryResult> query(const Node& node, const std::string& method, BencodedDict args,
+                                     std::chrono::milliseconds deadline = std::chrono::milliseconds(0),
+                                     CancellationToken token = CancellationToken());
+        Operation<FindNodeResult> find_node(const Node& node, const NodeID& target,
+                                            std::chrono::milliseconds deadline = std::chrono::milliseconds(0),
+                                            CancellationToken token = CancellationToken());
+        Operation<bool> ping(const Node& node,
+                             std::chrono::milliseconds deadline = std::chrono::milliseconds(0),
+                             CancellationToken token = CancellationToken());
+        Operation<LookupResult> lookup(const NodeID& target,
+                                       std::chrono::milliseconds deadline = std::chrono::milliseconds(0),
+                                       CancellationToken token = CancellationToken());
+        Operation<LookupResult> get_peers(const NodeID& info_hash, size_t max_peers = 0,
+                                          std::chrono::milliseconds deadline = std::chrono::milliseconds(0),
+                                          CancellationToken token = CancellationToken());
+
+    private:
+        Operation<LookupResult> run_lookup(const NodeID& target, const LookupOptions& options,
+                                           std::chrono::milliseconds deadline,
+                                           CancellationToken token);
+
+        DHTBootstrap& dht_;
+    };
+
+} // namespace DHT
+
+#endif // __cpp_impl_coroutine
+
+#endif // DHT_CORO_HPP
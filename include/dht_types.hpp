@@ -0,0 +1,41 @@
+#ifndef DHT_TYPES_HPP
+#define DHT_TYPES_HPP
+
+#include <array>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace DHT {
+
+    constexpr uint16_t DHT_PORT = 6881;
+    constexpr size_t NODE_ID_SIZE = 20;
+    constexpr size_t K = 8;
+
+    using NodeID = std::array<uint8_t, NODE_ID_SIZE>;
+
+    struct Node {
+        NodeID id;
+        std::string ip;
+        uint16_t port;
+
+        bool operator==(const Node& other) const {
+            return id == other.id && ip == other.ip && port == other.port;
+        }
+    };
+
+    using Bucket = std::vector<Node>;
+
+    // XOR metric between two IDs
+    inline NodeID xor_distance(const NodeID& a, const NodeID& b) {
+        NodeID result;
+        for (size_t i = 0; i < NODE_ID_SIZE; ++i) {
+            result[i] = a[i] ^ b[i];
+        }
+        return result;
+    }
+
+} // namespace DHT
+
+#endif // DHT_TYPES_HPP
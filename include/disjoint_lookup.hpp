@@ -0,0 +1,57 @@
+#ifndef DISJOINT_LOOKUP_HPP
+#define DISJOINT_LOOKUP_HPP
+
+#include "dht_types.hpp"
+#include "lookup.hpp"
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace DHT {
+
+    class DHTBootstrap;
+
+    // S/Kademlia-style lookup over options.disjoint_paths independent
+    // Lookups. The seeds are dealt round-robin to the paths and each contact
+    // is queried by whichever path reaches it first, so one bad contact can
+    // stall or mislead at most one path. Once options.path_quorum paths have
+    // finished with responders (or all have finished), the others are
+    // cancelled and the results are merged: the k closest responders of all
+    // paths with their tokens, every peer found, summed statistics.
+    //
+    // on_progress, the deadline and the cancellation token apply to every
+    // path; progress is reported per path.
+    class DisjointLookup : public std::enable_shared_from_this<DisjointLookup> {
+    public:
+        DisjointLookup(DHTBootstrap& dht, const NodeID& target, const LookupOptions& options,
+                       LookupCallback done);
+
+        void start(const std::vector<Node>& seeds);
+
+    private:
+        bool claim(const Node& node);
+        void on_path_done(size_t path, const LookupResult& result);
+        LookupResult merge() const;     // Requires mutex_
+
+        DHTBootstrap& dht_;
+        NodeID target_;
+        LookupOptions options_;
+        LookupCallback done_;
+
+        std::vector<std::shared_ptr<Lookup>> paths_;
+        std::vector<LookupResult> results_;
+        std::vector<bool> path_finished_;
+        std::set<std::string> claimed_;     // Contacts some path has queried
+        size_t quorum_reached_ = 0;         // Paths finished with responders
+        size_t paths_finished_ = 0;
+        bool cancelling_ = false;           // Quorum met; the rest are cancelled
+        bool finished_ = false;
+        std::mutex mutex_;
+        std::mutex claim_mutex_;
+    };
+
+} // namespace DHT
+
+#endif // DISJOINT_LOOKUP_HPP
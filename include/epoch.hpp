@@ -0,0 +1,61 @@
+#ifndef EPOCH_HPP
+#define EPOCH_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace DHT {
+
+    // Epoch-based reclamation domain (RCU style) for read-mostly structures.
+    // Readers announce the epoch they entered in a per-thread slot; writers
+    // publish a new version, retire the old one and free it once every active
+    // reader has moved past the retiring epoch.
+    class EpochDomain {
+    public:
+        static constexpr size_t MAX_THREADS = 128;
+
+        static EpochDomain& global();
+
+        void enter();  // Begin a read-side critical section on this thread
+        void leave();  // End it; guards may nest
+        void retire(std::function<void()> deleter);
+        void reclaim(); // Free everything no reader can still see
+
+        ~EpochDomain();
+
+    private:
+        struct alignas(64) Slot {
+            std::atomic<uint64_t> epoch{0}; // 0 = not inside a critical section
+            std::atomic<bool> in_use{false};
+        };
+
+        size_t acquire_slot();
+        void release_slot(size_t index);
+        uint64_t min_active_epoch() const;
+
+        std::array<Slot, MAX_THREADS> slots_;
+        std::atomic<uint64_t> global_epoch_{1};
+
+        std::mutex retire_mutex_;
+        std::vector<std::pair<uint64_t, std::function<void()>>> retired_;
+
+        friend struct EpochThreadState;
+    };
+
+    // RAII read-side critical section on the global domain
+    class EpochGuard {
+    public:
+        EpochGuard() { EpochDomain::global().enter(); }
+        ~EpochGuard() { EpochDomain::global().leave(); }
+        EpochGuard(const EpochGuard&) = delete;
+        EpochGuard& operator=(const EpochGuard&) = delete;
+    };
+
+} // namespace DHT
+
+#endif // EPOCH_HPP
@@ -0,0 +1,47 @@
+#ifndef EVENT_LOOP_HPP
+#define EVENT_LOOP_HPP
+
+#include <chrono>
+
+namespace DHT {
+
+    // Readiness wait for the DHT socket. On Linux this is an epoll instance
+    // watching the socket and an eventfd, so wake() interrupts a wait from
+    // any thread. Elsewhere it falls back to poll()/WSAPoll() and a wait is
+    // never longer than FALLBACK_WAIT_MS, since wake() cannot interrupt it.
+    class EventLoop {
+    public:
+        static constexpr int FALLBACK_WAIT_MS = 50;
+
+        struct Ready {
+            bool readable = false;
+            bool writable = false;
+            bool woken = false;     // wake() was called
+        };
+
+        explicit EventLoop(int sock);
+        ~EventLoop();
+        EventLoop(const EventLoop&) = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        // Block until the socket is readable (or writable, if want_write), a
+        // wake() arrives or the timeout passes. Level-triggered.
+        Ready wait(std::chrono::milliseconds timeout, bool want_write);
+        void wake();    // Thread-safe
+        int wake_fd() const;    // The eventfd wake() signals, or -1
+
+    private:
+        int sock_;
+#ifdef __linux__
+        int epoll_fd_ = -1;
+        int wake_fd_ = -1;
+        bool write_armed_ = false;  // EPOLLOUT registered for sock_
+#endif
+    };
+
+    bool set_nonblocking(int sock);
+    bool wait_writable(int sock, std::chrono::milliseconds timeout);
+
+} // namespace DHT
+
+#endif // EVENT_LOOP_HPP
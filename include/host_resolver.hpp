@@ -0,0 +1,58 @@
+#ifndef HOST_RESOLVER_HPP
+#define HOST_RESOLVER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace DHT {
+
+    // Resolves hostnames to IPv4 addresses on a background thread so that
+    // callers never block in getaddrinfo(). Results are cached and, if a
+    // cache path is given, persisted so that the next start can use them
+    // before DNS answers (the entry is refreshed in the background).
+    class HostResolver {
+    public:
+        // Called once with the addresses found (empty if resolution failed and
+        // nothing is cached). Runs on the resolver thread, or on the calling
+        // thread when answered from the cache.
+        using Callback = std::function<void(const std::string& host, const std::vector<std::string>& addresses)>;
+
+        explicit HostResolver(const std::string& cache_path = "");
+        ~HostResolver();
+        HostResolver(const HostResolver&) = delete;
+        HostResolver& operator=(const HostResolver&) = delete;
+
+        void resolve(const std::string& host, Callback done);
+        std::vector<std::string> cached(const std::string& host) const;
+        size_t pending() const;
+
+    private:
+        struct Request {
+            std::string host;
+            Callback done;      // Empty for background refreshes of cached hosts
+        };
+
+        void worker();
+        void load_cache();
+        void save_cache();  // Requires mutex_
+
+        std::string cache_path_;
+        std::map<std::string, std::vector<std::string>> cache_;
+        std::deque<Request> queue_;
+        size_t in_progress_ = 0;
+        bool stopping_ = false;
+        std::thread thread_;        // Started on the first request
+        std::condition_variable wake_;
+        mutable std::mutex mutex_;
+    };
+
+} // namespace DHT
+
+#endif // HOST_RESOLVER_HPP
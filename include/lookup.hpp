@@ -0,0 +1,170 @@
+#ifndef LOOKUP_HPP
+#define LOOKUP_HPP
+
+#include "dht_types.hpp"
+#include "transaction_manager.hpp"
+#include "cancellation.hpp"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace DHT {
+
+    class DHTBootstrap;
+
+    // Streamed while a lookup runs
+    struct LookupProgress {
+        std::vector<Node> new_peers;        // get_peers: peers not reported before
+        std::vector<Node> closest;          // Current closest responders, closest first
+        bool closest_changed = false;       // closest differs from the last report
+    };
+
+    using LookupProgressCallback = std::function<void(const LookupProgress&)>;
+
+    struct LookupOptions {
+        size_t alpha = 3;   // Queries kept in flight
+        size_t k = K;       // Size of the result set that must answer before we stop
+
+        // Hedging: once a query has been outstanding longer than this
+        // percentile of observed RTTs, also query the next-closest candidate
+        // (the slow query is kept). At most hedge_budget extra queries.
+        size_t hedge_budget = 2;
+        double hedge_percentile = 0.9;
+
+        // Send get_peers instead of find_node, collecting peers ("values") and
+        // each responder's announce token. A non-zero max_peers ends the
+        // lookup as soon as that many distinct peers are known.
+        bool get_peers = false;
+        size_t max_peers = 0;
+
+        // Finish early with whatever has been found so far once the deadline
+        // passes (0 = none) or the token is cancelled.
+        std::chrono::milliseconds deadline{0};
+        std::optional<CancellationToken> cancel;
+
+        // Called after every answer that found new peers or changed the
+        // closest responders, on the thread that delivered the answer.
+        LookupProgressCallback on_progress;
+
+        // S/Kademlia disjoint paths: split the seeds over this many lookups
+        // that never query the same contact, and merge their results once
+        // path_quorum of them have finished with responders (the rest are
+        // cancelled). More paths cost more queries but route around slow or
+        // poisoning contacts.
+        size_t disjoint_paths = 1;
+        size_t path_quorum = 1;
+    };
+
+    struct LookupResult {
+        enum class Status {
+            Converged,      // The k closest live candidates answered (or none were left)
+            EnoughPeers,    // get_peers: max_peers reached
+            DeadlineExpired,
+            Cancelled
+        };
+
+        Status status = Status::Converged;
+        NodeID target{};
+        std::vector<Node> closest;          // Up to k closest nodes that answered, closest first
+        size_t hops = 0;                    // Longest referral chain that reached a responder
+        size_t queries = 0;
+        size_t responses = 0;
+        size_t timeouts = 0;                // Queries that got no answer
+        size_t errors = 0;                  // Answered with a KRPC error or an unusable reply
+        size_t hedges = 0;                  // Extra queries issued for slow ones
+        std::vector<std::string> tokens;    // get_peers: tokens[i] was issued by closest[i]
+        std::vector<Node> peers;            // get_peers: distinct peers found (no IDs)
+        std::chrono::milliseconds duration{0};
+    };
+
+    using LookupCallback = std::function<void(const LookupResult&)>;
+
+    struct AnnounceResult {
+        LookupResult lookup;                // The get_peers lookup that found the closest nodes
+        size_t announced = 0;               // announce_peer queries that were acknowledged
+        size_t attempted = 0;               // Closest responders that handed out a token
+    };
+
+    using AnnounceCallback = std::function<void(const AnnounceResult&)>;
+
+    // How a lookup sends its queries. Empty means straight to the socket via
+    // DHTBootstrap::send_query; the bulk scheduler interposes its budgets.
+    using QuerySender = std::function<void(const Node& node, const std::string& method,
+                                           BencodedDict args, QueryCallback callback)>;
+
+    // Whether a lookup may query a contact. Disjoint paths use it to claim
+    // each contact for a single path.
+    using ContactFilter = std::function<bool(const Node& node)>;
+
+    // Iterative Kademlia lookup. Keeps a shortlist sorted by XOR distance to
+    // the target, keeps alpha find_node queries in flight, folds returned
+    // contacts into the shortlist as responses arrive and stops once the k
+    // closest live candidates have all answered. Slow queries are hedged
+    // with a bounded number of extra queries to the next candidates.
+    //
+    // Driven entirely by query callbacks; owned by shared_ptr so in-flight
+    // queries keep it alive. A deadline or cancellation finishes it with the
+    // partial result on the thread pumping the socket, whichever thread
+    // cancelled; answers still in flight are then only used to refresh the
+    // routing table.
+    class Lookup : public std::enable_shared_from_this<Lookup> {
+    public:
+        Lookup(DHTBootstrap& dht, const NodeID& target, const LookupOptions& options,
+               LookupCallback done, QuerySender sender = nullptr, ContactFilter filter = nullptr);
+
+        void start(const std::vector<Node>& seeds);
+        void cancel();  // Finish with the partial result, on the pumping thread
+
+    private:
+        enum class State { Pending, InFlight, Responded, Failed };
+
+        struct Candidate {
+            Node node;
+            NodeID distance;
+            State state = State::Pending;
+            size_t hop = 0;     // Referrals between a seed and this node
+            bool hedged = false; // A hedge was already issued for this query
+            std::string token;  // get_peers: token for announcing to this node
+        };
+
+        using Clock = std::chrono::steady_clock;
+
+        void add_candidate(const Node& node, size_t hop);   // Requires mutex_
+        Candidate* find_candidate(const std::string& ip, uint16_t port); // Requires mutex_
+        bool converged() const;                             // Requires mutex_
+        bool enough_peers() const;                          // Requires mutex_
+        LookupResult build_result() const;                  // Requires mutex_
+        void on_result(const std::string& ip, uint16_t port, const QueryResult& result);
+        void on_slow(const std::string& ip, uint16_t port);
+        void finish_early(LookupResult::Status status);
+        void report(const std::vector<Node>& new_peers);
+        void step();
+        void send(const std::vector<Node>& nodes);
+
+        DHTBootstrap& dht_;
+        NodeID target_;
+        LookupOptions options_;
+        LookupCallback done_;
+        QuerySender sender_;
+        ContactFilter filter_;
+
+        std::vector<Candidate> shortlist_;  // Sorted by distance
+        std::vector<Node> peers_;
+        size_t in_flight_ = 0;
+        size_t queries_ = 0;
+        size_t responses_ = 0;
+        size_t timeouts_ = 0;
+        size_t errors_ = 0;
+        size_t hedges_ = 0;
+        bool finished_ = false;
+        size_t cancel_id_ = 0;
+        std::vector<NodeID> reported_closest_;  // Last closest set passed to on_progress
+        Clock::time_point started_;
+        std::mutex mutex_;
+    };
+
+} // namespace DHT
+
+#endif // LOOKUP_HPP
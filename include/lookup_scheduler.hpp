@@ -0,0 +1,93 @@
+#ifndef LOOKUP_SCHEDULER_HPP
+#define LOOKUP_SCHEDULER_HPP
+
+#include "dht_types.hpp"
+#include "lookup.hpp"
+#include "transaction_manager.hpp"
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace DHT {
+
+    class DHTBootstrap;
+
+    struct BulkLookupOptions {
+        size_t max_outstanding = 256;                       // Queries in flight across all lookups
+        std::chrono::milliseconds contact_interval{250};    // Minimum gap between queries to one contact
+        unsigned shared_prefix_bits = 24;                   // find_node targets sharing this prefix get the same answer
+        std::chrono::seconds response_ttl{60};              // How long an answer is reused
+    };
+
+    struct BulkLookupStats {
+        size_t lookups_active = 0;
+        size_t outstanding = 0;     // Queries on the wire
+        size_t queued = 0;          // Waiting for budget or for the contact's rate limit
+        size_t sent = 0;
+        size_t deduplicated = 0;    // Joined a query already in flight
+        size_t reused = 0;          // Answered from a fresh cached response
+    };
+
+    // Runs many lookups at once over the shared socket. All queries go
+    // through one queue bounded by a global outstanding-query budget and a
+    // per-contact rate limit. Queries to the same contact for equivalent
+    // targets (identical info_hash for get_peers, a shared prefix of
+    // shared_prefix_bits for find_node) are sent once: a second lookup joins
+    // the query in flight or gets the answer received within response_ttl.
+    //
+    // Owned by shared_ptr; queued queries keep it alive. Like Lookup, it is
+    // driven by query callbacks and timers on the thread pumping the socket.
+    class LookupScheduler : public std::enable_shared_from_this<LookupScheduler> {
+    public:
+        LookupScheduler(DHTBootstrap& dht, const BulkLookupOptions& options = BulkLookupOptions());
+
+        void lookup(const NodeID& target, const LookupOptions& options, LookupCallback done);
+        void lookup(const NodeID& target, LookupCallback done);
+        void get_peers(const NodeID& info_hash, size_t max_peers, LookupCallback done);
+
+        BulkLookupStats stats() const;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct Pending {
+            Node node;
+            std::string method;
+            BencodedDict args;
+            std::string key;            // Share key; empty if the answer is not shared
+            QueryCallback callback;     // Unshared queries only
+        };
+
+        struct Shared {
+            std::vector<QueryCallback> waiters;     // In flight: everyone who wants the answer
+            std::shared_ptr<const QueryResult> result;  // Answered: the response to reuse
+            Clock::time_point answered;
+            bool in_flight = true;
+        };
+
+        void send(const Node& node, const std::string& method, BencodedDict args, QueryCallback callback);
+        void pump();
+        void on_response(const std::string& key, const QueryCallback& callback, const QueryResult& result);
+        void prune(Clock::time_point now);  // Requires mutex_
+        std::string share_key(const Node& node, const std::string& method, const BencodedDict& args) const;
+        static std::string contact_key(const Node& node);
+
+        DHTBootstrap& dht_;
+        BulkLookupOptions options_;
+
+        std::deque<Pending> queue_;
+        std::unordered_map<std::string, Shared> shared_;            // Share key -> query state
+        std::unordered_map<std::string, Clock::time_point> next_allowed_; // Contact -> earliest next send
+        size_t deferred_ = 0;       // Queued entries parked on a rate-limit timer
+        size_t inserts_since_prune_ = 0;
+        BulkLookupStats stats_;
+        mutable std::mutex mutex_;
+    };
+
+} // namespace DHT
+
+#endif // LOOKUP_SCHEDULER_HPP
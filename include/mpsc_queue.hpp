@@ -0,0 +1,85 @@
+#ifndef MPSC_QUEUE_HPP
+#define MPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace DHT {
+
+    // Bounded lock-free queue with any number of producer threads and one
+    // consumer (Vyukov's array queue). Each cell carries a sequence number:
+    // a producer claims a position with one CAS on the tail and publishes
+    // the cell by advancing its sequence, so producers never wait on each
+    // other or on the consumer. A full queue is reported, not waited out.
+    template <typename T>
+    class MpscQueue {
+    public:
+        explicit MpscQueue(size_t capacity) : mask_(round_up(capacity) - 1), cells_(new Cell[mask_ + 1]) {
+            for (uint64_t i = 0; i <= mask_; ++i) {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+        MpscQueue(const MpscQueue&) = delete;
+        MpscQueue& operator=(const MpscQueue&) = delete;
+
+        // Any thread. Leaves value untouched and returns false if full.
+        bool push(T& value) {
+            uint64_t position = tail_.load(std::memory_order_relaxed);
+            for (;;) {
+                Cell& cell = cells_[position & mask_];
+                uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+                int64_t lag = static_cast<int64_t>(sequence - position);
+                if (lag == 0) {
+                    if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        cell.value = std::move(value);
+                        cell.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (lag < 0) {
+                    return false;   // The consumer has not freed this cell yet
+                } else {
+                    position = tail_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Consumer only. Empty also while the oldest push is mid-write.
+        std::optional<T> pop() {
+            Cell& cell = cells_[head_ & mask_];
+            if (cell.sequence.load(std::memory_order_acquire) != head_ + 1) {
+                return std::nullopt;
+            }
+            std::optional<T> value(std::move(cell.value));
+            cell.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+            head_++;
+            return value;
+        }
+
+        size_t capacity() const { return mask_ + 1; }
+
+    private:
+        struct Cell {
+            std::atomic<uint64_t> sequence{0};
+            T value{};
+        };
+
+        static size_t round_up(size_t capacity) {
+            size_t size = 1;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            return size;
+        }
+
+        const uint64_t mask_;
+        std::unique_ptr<Cell[]> cells_;
+        alignas(64) std::atomic<uint64_t> tail_{0};     // Next position to claim; producers
+        alignas(64) uint64_t head_ = 0;                 // Next position to pop; consumer
+    };
+
+} // namespace DHT
+
+#endif // MPSC_QUEUE_HPP
@@ -0,0 +1,110 @@
+#ifndef MULTI_LOOKUP_HPP
+#define MULTI_LOOKUP_HPP
+
+#include "dht_types.hpp"
+#include "lookup.hpp"
+#include "transaction_manager.hpp"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace DHT {
+
+    class DHTBootstrap;
+
+    struct MultiLookupResult {
+        std::vector<LookupResult> lookups;  // One per target, in the order given
+        size_t queries = 0;                 // find_node queries actually sent
+        size_t shared = 0;                  // Answers delivered to more than one traversal
+    };
+
+    using MultiLookupCallback = std::function<void(const MultiLookupResult&)>;
+
+    // find_node lookups for many targets at once (bucket refreshes, bulk
+    // maintenance). Targets sharing a prefix are walked as one group with a
+    // merged shortlist: a contact whose ID leaves the group's common prefix
+    // answers the same for every target in it, so it is queried once, for
+    // the group's first target. When the closest pending contact falls inside
+    // the common prefix, the group splits at the first differing bit and each
+    // half continues on its own, keeping the answers collected so far. Single
+    // targets finish like an ordinary Lookup (alpha and k from the options;
+    // no hedging).
+    //
+    // Owned by shared_ptr; in-flight queries keep it alive.
+    class MultiLookup : public std::enable_shared_from_this<MultiLookup> {
+    public:
+        MultiLookup(DHTBootstrap& dht, const std::vector<NodeID>& targets, const LookupOptions& options,
+                    MultiLookupCallback done);
+
+        void start();
+
+    private:
+        enum class State { Pending, InFlight, Responded, Failed };
+
+        struct Candidate {
+            Node node;
+            NodeID distance;
+            State state = State::Pending;
+            size_t hop = 0;
+        };
+
+        struct Group {
+            std::vector<size_t> targets;        // Indices into targets_
+            NodeID pivot{};                     // Target sent in this group's queries
+            size_t prefix_bits = 0;             // Bits all targets share
+            size_t parent = SIZE_MAX;
+            std::vector<size_t> children;       // Set once split
+            std::vector<Candidate> shortlist;   // Sorted by distance to pivot
+            size_t in_flight = 0;
+            size_t queries = 0;
+            size_t responses = 0;
+            size_t timeouts = 0;
+            size_t errors = 0;
+            bool finished = false;
+        };
+
+        // One find_node sent to a contact, and every group using its answer
+        struct Query {
+            NodeID target{};
+            std::vector<size_t> groups;
+            bool answered = false;
+            bool responded = false;
+            bool timed_out = false;             // No answer at all (rather than an error)
+            NodeID responder{};                 // ID the contact reported
+            std::vector<Node> referrals;
+        };
+
+        using Clock = std::chrono::steady_clock;
+
+        static size_t common_prefix(const NodeID& a, const NodeID& b);
+        static std::string contact_key(const Node& node);
+        static size_t reusable_query(const std::vector<Query>& sent, const Node& node, const NodeID& target);
+        void add_candidate(Group& group, const Node& node, size_t hop);     // Requires mutex_
+        bool converged(const Group& group) const;                           // Requires mutex_
+        void split(size_t index);                                           // Requires mutex_
+        void deliver(size_t index, const std::string& ip, uint16_t port, const Query& query); // Requires mutex_
+        void finish(size_t index);                                          // Requires mutex_
+        void step();
+        void on_result(const Node& node, size_t slot, const QueryResult& result);
+
+        DHTBootstrap& dht_;
+        std::vector<NodeID> targets_;
+        LookupOptions options_;
+        MultiLookupCallback done_;
+
+        std::vector<Group> groups_;                     // All targets first, then split halves
+        std::unordered_map<std::string, std::vector<Query>> queries_; // Contact -> queries sent to it
+        MultiLookupResult result_;
+        size_t remaining_ = 0;                          // Targets not finished yet
+        bool reported_ = false;
+        Clock::time_point started_;
+        std::mutex mutex_;
+    };
+
+} // namespace DHT
+
+#endif // MULTI_LOOKUP_HPP
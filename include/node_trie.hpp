@@ -0,0 +1,61 @@
+#ifndef NODE_TRIE_HPP
+#define NODE_TRIE_HPP
+
+#include "dht_types.hpp"
+#include <list>
+#include <memory>
+
+namespace DHT {
+
+    // Compressed binary (PATRICIA) trie over node IDs. Answers "k nearest to
+    // target" by XOR metric with an ordered traversal: at every branch the
+    // subtree agreeing with the target's bit is strictly closer than the other
+    // one, so visiting it first yields nodes in increasing distance.
+    //
+    // Entries are kept in least-recently-seen order; once the trie holds more
+    // than `capacity` entries the oldest unpinned one is dropped. Pinned
+    // entries (e.g. routing table members) are never evicted.
+    //
+    // Not thread-safe; callers synchronize.
+    class NodeTrie {
+    public:
+        explicit NodeTrie(size_t capacity = 0); // 0 = unbounded
+        ~NodeTrie();
+        NodeTrie(const NodeTrie&) = delete;
+        NodeTrie& operator=(const NodeTrie&) = delete;
+
+        bool insert(const Node& node);          // True if the ID was new; refreshes recency
+        bool erase(const NodeID& id);
+        bool contains(const NodeID& id) const;
+        void pin(const NodeID& id);             // Exempt from eviction (counted)
+        void unpin(const NodeID& id);
+
+        std::vector<Node> closest(const NodeID& target_id, size_t k) const;
+        std::vector<Node> all() const;
+        size_t size() const { return size_; }
+
+    private:
+        struct TrieNode {
+            std::unique_ptr<TrieNode> child[2];
+            size_t bit = 0;     // Branching bit (internal nodes only)
+            bool leaf = false;
+            Node node;          // Leaf payload
+            size_t pins = 0;
+            std::list<NodeID>::iterator lru;
+        };
+
+        static int bit_at(const NodeID& id, size_t bit);
+        static size_t first_diff_bit(const NodeID& a, const NodeID& b);
+        TrieNode* find_leaf(const NodeID& id) const;
+        void collect(const TrieNode* n, const NodeID& target_id, size_t k, std::vector<Node>& out) const;
+        void evict_if_needed();
+
+        std::unique_ptr<TrieNode> root_;
+        std::list<NodeID> lru_;  // Unpinned IDs, least recently seen first
+        size_t size_ = 0;
+        size_t capacity_;
+    };
+
+} // namespace DHT
+
+#endif // NODE_TRIE_HPP
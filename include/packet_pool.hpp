@@ -0,0 +1,86 @@
+#ifndef PACKET_POOL_HPP
+#define PACKET_POOL_HPP
+
+#include "cpu_placement.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace DHT {
+
+    class PacketPool;
+
+    // A datagram buffer owned by exactly one holder at a time. Moving it
+    // hands the bytes on (to a queue, another thread, the kernel) without a
+    // copy; destroying it returns the buffer to its pool. Packets that did
+    // not fit the pool live on the heap and are freed instead.
+    class Packet {
+    public:
+        Packet() = default;
+        ~Packet();
+        Packet(Packet&& other) noexcept;
+        Packet& operator=(Packet&& other) noexcept;
+        Packet(const Packet&) = delete;
+        Packet& operator=(const Packet&) = delete;
+
+        char* data() { return data_; }
+        const char* data() const { return data_; }
+        size_t size() const { return size_; }
+        size_t capacity() const { return capacity_; }
+        void resize(size_t size);   // Clamped to capacity()
+        void reset();               // Release the buffer now
+        explicit operator bool() const { return data_ != nullptr; }
+
+    private:
+        friend class PacketPool;
+        Packet(PacketPool* pool, char* data, size_t capacity);
+
+        PacketPool* pool_ = nullptr;    // nullptr: heap buffer
+        char* data_ = nullptr;
+        size_t size_ = 0;
+        size_t capacity_ = 0;
+    };
+
+    // Fixed-size packet buffers carved from slabs. Slabs are allocated on
+    // demand, up to a capacity, on the NUMA node of the thread that needs
+    // them. Thread-safe: a packet may be released on any thread. The pool
+    // must outlive its packets.
+    class PacketPool {
+    public:
+        struct Stats {
+            size_t packets = 0;         // Pooled buffers allocated so far
+            size_t in_use = 0;          // Pooled buffers held right now
+            size_t high_water = 0;      // Most pooled buffers held at once
+            uint64_t exhausted = 0;     // Requests served from the heap: pool empty and at capacity
+            uint64_t oversize = 0;      // Requests served from the heap: larger than packet_size
+        };
+
+        PacketPool(size_t packet_size, size_t capacity, size_t packets_per_slab = 256);
+        PacketPool(const PacketPool&) = delete;
+        PacketPool& operator=(const PacketPool&) = delete;
+
+        // A buffer of at least size bytes (packet_size() if 0), with
+        // size() set to its capacity. Never fails.
+        Packet acquire(size_t size = 0);
+        size_t packet_size() const { return packet_size_; }
+        Stats stats() const;
+
+    private:
+        friend class Packet;
+        void release(char* data);
+        bool grow();    // Requires mutex_
+
+        size_t packet_size_;
+        size_t capacity_;
+        size_t packets_per_slab_;
+        std::vector<LocalBuffer> slabs_;
+        std::vector<char*> free_;
+        Stats stats_;
+        mutable std::mutex mutex_;
+    };
+
+} // namespace DHT
+
+#endif // PACKET_POOL_HPP
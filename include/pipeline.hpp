@@ -0,0 +1,93 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include "datagram_batch.hpp"
+#include "spsc_ring.hpp"
+#include "uring_socket.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace DHT {
+
+    // Staged receive -> parse/handle -> send path for one socket. The thread
+    // reading the socket (receive stage) submit()s each datagram to the
+    // parse worker chosen by its sender, so a peer's packets stay in order
+    // and on one core. Workers run the handler; whatever it sends (see
+    // current()) travels on to a single send stage that coalesces replies
+    // from all workers into sendmmsg() batches. Every hop is an SPSC ring,
+    // and every stage can be pinned to its own CPU.
+    class Pipeline {
+    public:
+        struct Stats {
+            uint64_t handled = 0;           // Datagrams through the parse workers
+            uint64_t sent = 0;              // Datagrams sent by the send stage
+            uint64_t receive_drops = 0;     // A worker's inbound ring was full
+            uint64_t send_drops = 0;        // A worker's outbound ring was full
+        };
+
+        // workers parse/handle stages with rings of ring_capacity datagrams;
+        // each worker's replies come from its own packet pool.
+        Pipeline(int sock, size_t workers, size_t ring_capacity, size_t send_batch,
+                 size_t packet_size, size_t pool_capacity);
+        ~Pipeline();
+        Pipeline(const Pipeline&) = delete;
+        Pipeline& operator=(const Pipeline&) = delete;
+
+        // Start the stages. Worker i is pinned to cpus[i] and the send stage
+        // to cpus[workers()], where given.
+        void start(const std::vector<int>& cpus, DatagramHandler handler);
+        void stop();    // Drain nothing; join every stage
+
+        // Receive stage only: queue a datagram for its sender's worker.
+        // False (and the datagram is dropped) if that worker is backed up.
+        bool submit(Packet packet, const sockaddr_in& sender);
+
+        // Parse workers only (current() != nullptr): queue a datagram for
+        // the send stage.
+        bool send(Packet data, const sockaddr_in& addr);
+        PacketPool& packet_pool();  // The calling worker's pool
+
+        size_t workers() const { return workers_.size(); }
+        Stats stats() const;
+
+        // The pipeline whose parse worker is the calling thread, or nullptr
+        static Pipeline* current();
+
+    private:
+        static constexpr int IDLE_SPINS = 64;
+        static constexpr int SEND_WAIT_MS = 50;
+
+        struct Worker {
+            Worker(size_t ring_capacity, size_t packet_size, size_t pool_capacity)
+                : inbox(ring_capacity), outbox(ring_capacity), pool(packet_size, pool_capacity) {}
+
+            SpscRing<Datagram> inbox;       // Receive stage -> worker
+            SpscRing<Datagram> outbox;      // Worker -> send stage
+            Doorbell inbox_bell;
+            PacketPool pool;
+            std::thread thread;
+        };
+
+        void work(size_t index, int cpu);
+        void send_loop(int cpu);
+
+        int sock_;
+        size_t send_batch_size_;
+        std::vector<std::unique_ptr<Worker>> workers_;
+        Doorbell send_bell_;                // Rung by every worker
+        DatagramHandler handler_;
+        std::thread send_thread_;
+        std::atomic<bool> stopping_{false};
+        std::atomic<uint64_t> handled_{0};
+        std::atomic<uint64_t> sent_{0};
+        std::atomic<uint64_t> receive_drops_{0};
+        std::atomic<uint64_t> send_drops_{0};
+    };
+
+} // namespace DHT
+
+#endif // PIPELINE_HPP
@@ -0,0 +1,62 @@
+#ifndef ROUTING_TABLE_HPP
+#define ROUTING_TABLE_HPP
+
+#include "dht_types.hpp"
+#include "epoch.hpp"
+#include <atomic>
+#include <mutex>
+
+namespace DHT {
+
+    // Read-mostly Kademlia routing table. Readers work on an immutable
+    // snapshot without taking a lock; writers serialize on a mutex, copy the
+    // table, modify the copy and publish it, retiring the old version through
+    // the global EpochDomain.
+    class RoutingTable {
+    public:
+        using Table = std::vector<Bucket>;
+
+        enum class InsertResult {
+            Added,      // Node stored in a bucket with free space
+            Refreshed,  // Node was known and moved to the most-recently-seen end
+            BucketFull  // Bucket full; caller should ping the oldest node
+        };
+
+        explicit RoutingTable(const NodeID& self_id);
+        ~RoutingTable();
+        RoutingTable(const RoutingTable&) = delete;
+        RoutingTable& operator=(const RoutingTable&) = delete;
+
+        // Insert or refresh a node. On BucketFull, *oldest receives the
+        // eviction candidate.
+        InsertResult insert(const Node& node, Node* oldest = nullptr);
+        void touch(const Node& node);                          // Mark node as recently seen
+        bool replace(const Node& stale, const Node& fresh);    // Evict stale in favour of fresh
+
+        std::vector<Node> find_closest(const NodeID& target_id, size_t k) const;
+        NodeID random_id_in_bucket(size_t index) const; // A lookup target that refreshes bucket index
+        Table copy() const;
+        size_t size() const;
+
+        // Run f(const Table&) on the current snapshot inside a read-side
+        // critical section. f must not keep references past its return.
+        template <typename F>
+        auto read(F&& f) const {
+            EpochGuard guard;
+            return f(*current_.load(std::memory_order_seq_cst));
+        }
+
+        const NodeID& self_id() const { return self_id_; }
+
+    private:
+        size_t bucket_index(const NodeID& id) const;
+        void publish(const Table* next); // Requires write_mutex_
+
+        NodeID self_id_;
+        std::atomic<const Table*> current_;
+        std::mutex write_mutex_;
+    };
+
+} // namespace DHT
+
+#endif // ROUTING_TABLE_HPP
@@ -0,0 +1,63 @@
+#ifndef RTT_ESTIMATOR_HPP
+#define RTT_ESTIMATOR_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace DHT {
+
+    // Round-trip time estimation (Jacobson/Karels, as in TCP's RTO from
+    // RFC 6298) per contact, plus a global estimate used for contacts we
+    // have never heard from. Timeouts back off exponentially per contact
+    // until the next successful sample.
+    class RttEstimator {
+    public:
+        using Duration = std::chrono::milliseconds;
+
+        RttEstimator(Duration initial, Duration min_timeout, Duration max_timeout,
+                     size_t max_contacts = 65536);
+
+        void sample(uint32_t ip, uint16_t port, Duration rtt);  // Answer arrived after rtt
+        void timed_out(uint32_t ip, uint16_t port);             // No answer before the deadline
+        Duration timeout_for(uint32_t ip, uint16_t port) const; // Deadline for the next query
+        Duration global_timeout() const;
+
+        // Percentile (0..1) of recently observed RTTs across all contacts, or
+        // zero if too few samples have been seen to say.
+        Duration percentile(double p) const;
+
+    private:
+        struct Estimate {
+            double srtt = 0;    // Smoothed RTT (ms)
+            double rttvar = 0;  // RTT variation (ms)
+            bool valid = false;
+            unsigned backoff = 0; // Consecutive timeouts
+        };
+
+        static void update(Estimate& estimate, double rtt_ms);
+        Duration rto(const Estimate& estimate) const;
+        static uint64_t key(uint32_t ip, uint16_t port) {
+            return (static_cast<uint64_t>(ip) << 16) | port;
+        }
+
+        Duration initial_;
+        Duration min_timeout_;
+        Duration max_timeout_;
+        size_t max_contacts_;
+
+        static constexpr size_t RECENT_SAMPLES = 256;
+        static constexpr size_t MIN_PERCENTILE_SAMPLES = 16;
+
+        Estimate global_;
+        std::unordered_map<uint64_t, Estimate> contacts_;
+        std::vector<Duration::rep> recent_;   // Ring of the last RECENT_SAMPLES RTTs
+        size_t recent_next_ = 0;
+        mutable std::mutex mutex_;
+    };
+
+} // namespace DHT
+
+#endif // RTT_ESTIMATOR_HPP
@@ -0,0 +1,64 @@
+#ifndef SHARED_CONTACTS_HPP
+#define SHARED_CONTACTS_HPP
+
+#include "dht_types.hpp"
+#include <atomic>
+#include <string>
+
+namespace DHT {
+
+    // Contact table in a POSIX shared-memory segment, so sibling DHT processes
+    // on one host reuse each other's discovered contacts.
+    //
+    // Layout is a fixed open-addressed array of slots, each guarded by a
+    // sequence lock: writers bump the sequence to odd, store the fields and
+    // bump it back to even; readers retry if the sequence moved. Only
+    // address-free lock-free atomics live in the segment, so it is safe to map
+    // at different addresses in different processes. No process-shared mutex
+    // is ever held, so a crashed sibling cannot wedge the others.
+    class SharedContacts {
+    public:
+        SharedContacts() = default;
+        ~SharedContacts();
+        SharedContacts(const SharedContacts&) = delete;
+        SharedContacts& operator=(const SharedContacts&) = delete;
+
+        // Create or attach to the named segment ("/name" as for shm_open).
+        // Returns false (and stays closed) if shared memory is unavailable.
+        bool open(const std::string& name, size_t capacity);
+        void close();
+        bool is_open() const { return header_ != nullptr; }
+
+        void publish(const Node& node);                        // Insert or refresh a contact
+        std::vector<Node> snapshot(uint64_t max_age_seconds) const; // Contacts seen recently
+
+    private:
+        static constexpr uint64_t MAGIC = 0x4448544b4e4f4453ULL; // "DHTKNODS"
+        static constexpr size_t PROBE_LIMIT = 8;
+
+        struct Header {
+            std::atomic<uint64_t> magic;    // Written last by the creator
+            uint64_t capacity;
+        };
+
+        struct Slot {
+            std::atomic<uint64_t> seq;      // Odd while a writer is inside
+            std::atomic<uint64_t> words[5]; // 20-byte ID, IPv4 + port, last-seen
+        };
+
+        static_assert(std::atomic<uint64_t>::is_always_lock_free,
+                      "shared contacts need lock-free 64-bit atomics");
+
+        static uint64_t now_seconds();
+        bool read_slot(const Slot& slot, Node& node, uint64_t& last_seen) const;
+        bool try_write_slot(Slot& slot, const Node& node, uint64_t last_seen);
+
+        Header* header_ = nullptr;
+        Slot* slots_ = nullptr;
+        size_t capacity_ = 0;
+        size_t mapped_size_ = 0;
+    };
+
+} // namespace DHT
+
+#endif // SHARED_CONTACTS_HPP
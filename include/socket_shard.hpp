@@ -0,0 +1,70 @@
+#ifndef SOCKET_SHARD_HPP
+#define SOCKET_SHARD_HPP
+
+#include "datagram_batch.hpp"
+#include "event_loop.hpp"
+#include "uring_socket.hpp"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace DHT {
+
+    // An extra socket bound to the DHT port with SO_REUSEPORT, served by its
+    // own worker thread. The kernel hashes each flow to one of the sockets
+    // sharing the port, so N shards spread receive and reply work over N
+    // cores. The worker owns its receive ring and send queue outright: the
+    // handler runs on the worker, and everything it sends (see current())
+    // is queued on the shard and goes out in one sendmmsg() after the batch.
+    // Packets come from the shard's own pool, grown on the worker's node.
+    class SocketShard {
+    public:
+        SocketShard(size_t batch, size_t packet_size, size_t pool_capacity, size_t max_queued_sends);
+        ~SocketShard();
+        SocketShard(const SocketShard&) = delete;
+        SocketShard& operator=(const SocketShard&) = delete;
+
+        // Create the socket and bind it to port next to the sockets already
+        // there. Fails unless those also set SO_REUSEPORT.
+        bool open(uint16_t port);
+        // Start the worker, pinned to cpu (-1 = unpinned) with its buffers
+        // on that CPU's NUMA node.
+        void start(int cpu, DatagramHandler handler);
+        void stop();    // Join the worker and close the socket
+
+        // Queue a datagram on this shard. Only the shard's own worker may
+        // call it; the queue is flushed after the batch being handled.
+        bool send(Packet data, const sockaddr_in& addr);
+        PacketPool& packet_pool() { return pool_; }
+        // Datagrams dropped because the send queue was full; readable from any thread
+        uint64_t send_drops() const { return send_drops_.load(std::memory_order_relaxed); }
+
+        // The shard whose worker is the calling thread, or nullptr
+        static SocketShard* current();
+
+    private:
+        static constexpr int IDLE_WAIT_MS = 1000;
+
+        void loop(int cpu);
+        size_t receive();
+        void flush();
+
+        int sock_ = -1;
+        std::unique_ptr<EventLoop> loop_;
+        PacketPool pool_;
+        std::unique_ptr<ReceiveRing> receive_ring_;
+        size_t max_queued_sends_;
+        std::deque<Datagram> send_queue_;               // Worker only
+        std::atomic<uint64_t> send_drops_{0};
+        SendBatch send_batch_;
+        DatagramHandler handler_;
+        std::atomic<bool> stopping_{false};
+        std::thread worker_;
+    };
+
+} // namespace DHT
+
+#endif // SOCKET_SHARD_HPP
@@ -0,0 +1,96 @@
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace DHT {
+
+    // Bounded lock-free queue between exactly one producer thread and one
+    // consumer thread. Head and tail live on separate cache lines, and each
+    // side caches the other's index so the shared line is only read when
+    // the ring looks full (producer) or empty (consumer).
+    template <typename T>
+    class SpscRing {
+    public:
+        explicit SpscRing(size_t capacity) : mask_(round_up(capacity) - 1), slots_(mask_ + 1) {}
+        SpscRing(const SpscRing&) = delete;
+        SpscRing& operator=(const SpscRing&) = delete;
+
+        // Producer side. Leaves value untouched and returns false if full.
+        bool push(T& value) {
+            uint64_t tail = tail_.value.load(std::memory_order_relaxed);
+            if (tail - head_cache_ > mask_) {
+                head_cache_ = head_.value.load(std::memory_order_acquire);
+                if (tail - head_cache_ > mask_) {
+                    return false;
+                }
+            }
+            slots_[tail & mask_] = std::move(value);
+            tail_.value.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side
+        std::optional<T> pop() {
+            uint64_t head = head_.value.load(std::memory_order_relaxed);
+            if (head == tail_cache_) {
+                tail_cache_ = tail_.value.load(std::memory_order_acquire);
+                if (head == tail_cache_) {
+                    return std::nullopt;
+                }
+            }
+            std::optional<T> value(std::move(slots_[head & mask_]));
+            head_.value.store(head + 1, std::memory_order_release);
+            return value;
+        }
+
+        // Approximate unless called by the consumer
+        bool empty() const {
+            return head_.value.load(std::memory_order_acquire) == tail_.value.load(std::memory_order_acquire);
+        }
+        size_t capacity() const { return mask_ + 1; }
+
+    private:
+        struct alignas(64) Index {
+            std::atomic<uint64_t> value{0};
+        };
+
+        static size_t round_up(size_t capacity) {
+            size_t size = 1;
+            while (size < capacity) {
+                size <<= 1;
+            }
+            return size;
+        }
+
+        const uint64_t mask_;
+        std::vector<T> slots_;
+        Index head_;                            // Next slot to pop; written by the consumer
+        alignas(64) uint64_t tail_cache_ = 0;   // Consumer's copy of tail_
+        Index tail_;                            // Next slot to fill; written by the producer
+        alignas(64) uint64_t head_cache_ = 0;   // Producer's copy of head_
+    };
+
+    // Lets a consumer sleep until some producer has pushed. Producers ring()
+    // after pushing; the consumer reads ticket() before checking its rings
+    // and wait()s on it only if they were all empty, so no push is missed.
+    class Doorbell {
+    public:
+        uint32_t ticket() const { return count_.load(std::memory_order_acquire); }
+        void wait(uint32_t ticket) const { count_.wait(ticket, std::memory_order_acquire); }
+        void ring() {
+            count_.fetch_add(1, std::memory_order_release);
+            count_.notify_one();
+        }
+
+    private:
+        std::atomic<uint32_t> count_{0};
+    };
+
+} // namespace DHT
+
+#endif // SPSC_RING_HPP
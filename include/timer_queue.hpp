@@ -0,0 +1,42 @@
+#ifndef TIMER_QUEUE_HPP
+#define TIMER_QUEUE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+namespace DHT {
+
+    // One-shot timers serviced by the thread pumping the DHT socket.
+    // Thread-safe; callbacks run without the internal lock held.
+    class TimerQueue {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        void schedule(Clock::time_point when, std::function<void()> callback);
+        size_t run_due(Clock::time_point now);      // Fire every timer due by now
+        Clock::time_point next_due() const;         // Clock::time_point::max() if empty
+        size_t size() const;
+
+    private:
+        struct Timer {
+            Clock::time_point when;
+            uint64_t sequence;  // FIFO among timers due at the same instant
+            std::function<void()> callback;
+
+            bool operator>(const Timer& other) const {
+                return when != other.when ? when > other.when : sequence > other.sequence;
+            }
+        };
+
+        std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+        uint64_t next_sequence_ = 0;
+        mutable std::mutex mutex_;
+    };
+
+} // namespace DHT
+
+#endif // TIMER_QUEUE_HPP
@@ -0,0 +1,94 @@
+#ifndef TRANSACTION_MANAGER_HPP
+#define TRANSACTION_MANAGER_HPP
+
+#include "bencode_parser.hpp"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <vector>
+
+namespace DHT {
+
+    // Outcome of an outbound KRPC query
+    struct QueryResult {
+        enum class Status {
+            Response,   // "y": "r"
+            Error,      // "y": "e"
+            Timeout,    // No answer before the deadline (or the send failed)
+            Cancelled   // Abandoned by the caller before an answer arrived
+        };
+
+        Status status = Status::Timeout;
+        BencodedValue message;  // The full response/error message
+        std::string ip;         // Address the answer came from
+        uint16_t port = 0;
+
+        bool ok() const { return status == Status::Response; }
+    };
+
+    using QueryCallback = std::function<void(const QueryResult&)>;
+
+    // Tracks outbound queries sent on the shared DHT socket. Transaction IDs
+    // are 2-byte strings; the ID doubles as the slot index in an
+    // open-addressed table, so matching a response is a single array lookup.
+    // Deadlines are kept in a min-heap with lazy invalidation.
+    //
+    // Callbacks are always invoked without the internal lock held.
+    class TransactionManager {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        explicit TransactionManager(size_t capacity = 16384); // Rounded up to a power of two, max 65536
+
+        // Reserve a transaction ID for a query to ip:port. Returns false if
+        // every slot is in use.
+        bool begin(uint32_t ip, uint16_t port, Clock::time_point deadline,
+                   QueryCallback&& callback, std::string& transaction_id);
+
+        // Match an incoming response or error. The result is only accepted
+        // from the address the query was sent to.
+        bool complete(const std::string& transaction_id, uint32_t ip, uint16_t port,
+                      QueryResult result);
+
+        bool cancel(const std::string& transaction_id);  // Drop without calling back
+        void fail(const std::string& transaction_id);    // Complete now with Timeout
+        size_t expire(Clock::time_point now);            // Time out every overdue query
+        Clock::time_point next_deadline() const;         // Clock::time_point::max() if idle
+        size_t pending() const;
+
+    private:
+        struct Slot {
+            bool in_use = false;
+            uint16_t id = 0;        // Full transaction ID (the slot is id & mask_)
+            uint64_t serial = 0;    // Distinguishes reuses of the same slot
+            uint32_t ip = 0;
+            uint16_t port = 0;
+            Clock::time_point deadline;
+            QueryCallback callback;
+        };
+
+        struct Deadline {
+            Clock::time_point when;
+            uint16_t index;
+            uint64_t serial;
+            bool operator>(const Deadline& other) const { return when > other.when; }
+        };
+
+        static bool decode_id(const std::string& transaction_id, uint16_t& value);
+        QueryCallback take(uint16_t index); // Requires mutex_
+
+        std::vector<Slot> slots_;
+        size_t mask_;
+        uint16_t next_id_ = 0;
+        uint64_t next_serial_ = 1;
+        size_t pending_ = 0;
+        std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> deadlines_;
+        mutable std::mutex mutex_;
+    };
+
+} // namespace DHT
+
+#endif // TRANSACTION_MANAGER_HPP
@@ -0,0 +1,139 @@
+#ifndef URING_SOCKET_HPP
+#define URING_SOCKET_HPP
+
+#include "cpu_placement.hpp"
+#include "datagram_batch.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#ifdef __linux__
+    #include <sys/socket.h>
+    #include <sys/uio.h>
+
+    struct io_uring_sqe;
+    struct io_uring_cqe;
+    struct io_uring_buf;
+#endif
+
+namespace DHT {
+
+    using DatagramHandler = std::function<void(const char* data, size_t length, const sockaddr_in& sender)>;
+
+    // io_uring driver for the DHT's UDP socket (Linux 6.0+, raw syscalls, no
+    // liburing). One multishot recvmsg keeps receiving into a registered
+    // ring of provided buffers, so a packet costs no syscall and no copy
+    // out of the kernel's choice of buffer; sends are queued as sendmsg
+    // submissions and go in with the next io_uring_enter(), which also waits.
+    //
+    // Only the thread driving wait()/submit() may touch the ring. Other
+    // threads interrupt a wait() by signalling the eventfd passed to open()
+    // (EventLoop::wake()), which the ring keeps a multishot poll on.
+    class UringSocket {
+    public:
+        UringSocket() = default;
+        ~UringSocket();
+        UringSocket(const UringSocket&) = delete;
+        UringSocket& operator=(const UringSocket&) = delete;
+
+        // Set up the ring for sock with receive buffers (count rounded up to
+        // a power of two) of buffer_size payload bytes on the given NUMA
+        // node. Returns false (and stays closed) if the kernel lacks any
+        // required feature, so the caller can fall back to epoll.
+        bool open(int sock, int wake_fd, size_t buffers, size_t buffer_size, int numa_node);
+        void close();
+        bool is_open() const { return ring_fd_ >= 0; }
+
+        // Move datagrams from the front of queue into sendmsg submissions,
+        // as many as there are free send slots. They go out with the next
+        // wait() or submit().
+        void queue_sends(std::deque<Datagram>& queue);
+        // Submit, then wait up to timeout for completions if none are ready
+        // and hand each received datagram to handler. Returns datagrams
+        // received, or 0 on timeout / wake().
+        size_t wait(std::chrono::milliseconds timeout, const DatagramHandler& handler);
+        void submit();                      // Submit without waiting
+        size_t sends_in_flight() const;
+        // The last send completion failed for lack of socket buffer (the
+        // datagram was dropped); cleared by the next one that gets through
+        bool send_blocked() const { return send_blocked_; }
+        // Datagrams longer than a buffer, dropped so far. Any thread.
+        uint64_t truncated() const { return truncated_.load(std::memory_order_relaxed); }
+
+    private:
+#ifdef __linux__
+        static constexpr unsigned SQ_ENTRIES = 256;
+        static constexpr unsigned CQ_ENTRIES = 1024;
+        static constexpr size_t SEND_SLOTS = 192;
+        static constexpr uint16_t BUFFER_GROUP = 0;
+        static constexpr uint64_t RECV_TAG = 1ULL << 62;
+        static constexpr uint64_t WAKE_TAG = 1ULL << 61;
+        static constexpr uint64_t SEND_TAG = 1ULL << 60;
+        static constexpr uint64_t CANCEL_TAG = 1ULL << 59;
+
+        struct SendSlot {
+            Datagram datagram;
+            msghdr header{};
+            iovec vector{};
+        };
+
+        struct Completion {
+            uint64_t user_data;
+            int32_t res;
+            uint32_t flags;
+        };
+
+        struct io_uring_sqe* next_sqe();
+        int enter(unsigned to_submit, unsigned min_complete, unsigned flags, std::chrono::milliseconds timeout);
+        void arm_receive();
+        void arm_wake();
+        size_t take_completions(std::vector<Completion>& out);
+        void recycle_buffer(uint16_t id);
+
+        // Ring mappings
+        void* sq_ring_ = nullptr;
+        void* cq_ring_ = nullptr;
+        size_t sq_ring_size_ = 0;
+        size_t cq_ring_size_ = 0;
+        struct io_uring_sqe* sqes_ = nullptr;
+        size_t sqes_size_ = 0;
+        unsigned* sq_head_ = nullptr;
+        unsigned* sq_tail_ = nullptr;
+        unsigned* sq_array_ = nullptr;
+        unsigned sq_mask_ = 0;
+        unsigned* cq_head_ = nullptr;
+        unsigned* cq_tail_ = nullptr;
+        struct io_uring_cqe* cqes_ = nullptr;
+        unsigned cq_mask_ = 0;
+        unsigned pending_ = 0;              // SQEs written but not yet submitted
+
+        // Provided buffers for the multishot receive
+        struct io_uring_buf* buffer_ring_ = nullptr;   // bufs[0].resv doubles as the tail
+        size_t buffer_ring_size_ = 0;
+        LocalBuffer buffers_;
+        size_t buffer_count_ = 0;
+        size_t buffer_stride_ = 0;
+        msghdr receive_header_{};           // Template for the multishot recvmsg
+        bool receive_armed_ = false;
+        bool closing_ = false;
+
+        int wake_fd_ = -1;                  // Not owned
+        bool wake_armed_ = false;
+
+        std::vector<SendSlot> send_slots_;
+        std::vector<size_t> free_send_slots_;
+        std::vector<Completion> completions_;
+        size_t nesting_ = 0;                // wait() calls in progress (handlers may pump)
+        int sock_ = -1;
+#endif
+        int ring_fd_ = -1;
+        bool send_blocked_ = false;
+        std::atomic<uint64_t> truncated_{0};
+    };
+
+} // namespace DHT
+
+#endif // URING_SOCKET_HPP
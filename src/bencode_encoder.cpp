@@ -1,4 +1,6 @@
 #include "../include/bencode_encoder.hpp"
+#include <algorithm>
+#include <cstring>
 
 std::string BencodeEncoder::encode(const BencodedValue& value) {
     if (value.isInt()) {
@@ -38,4 +40,49 @@ std::string BencodeEncoder::encodeDict(const BencodedDict& dict) {
         result += encode(value);
     }
     return result + "e";
-}
\ No newline at end of file
+}
+
+size_t BencodeEncoder::encode(const BencodedValue& value, char* out, size_t capacity) {
+    Sink sink{out, capacity, 0};
+    encodeTo(value, sink);
+    return sink.length;
+}
+
+void BencodeEncoder::Sink::append(const char* data, size_t size) {
+    if (length < capacity) {
+        std::memcpy(out + length, data, std::min(size, capacity - length));
+    }
+    length += size;
+}
+
+void BencodeEncoder::encodeTo(const BencodedValue& value, Sink& sink) {
+    if (value.isInt()) {
+        std::string digits = std::to_string(value.asInt());
+        sink.append("i", 1);
+        sink.append(digits.data(), digits.size());
+        sink.append("e", 1);
+    } else if (value.isString()) {
+        const std::string& str = value.asString();
+        std::string length = std::to_string(str.size());
+        sink.append(length.data(), length.size());
+        sink.append(":", 1);
+        sink.append(str.data(), str.size());
+    } else if (value.isList()) {
+        sink.append("l", 1);
+        for (const auto& item : value.asList()) {
+            encodeTo(item, sink);
+        }
+        sink.append("e", 1);
+    } else if (value.isDict()) {
+        // BencodedDict is a std::map, so keys are already in order
+        sink.append("d", 1);
+        for (const auto& [key, item] : value.asDict()) {
+            std::string length = std::to_string(key.size());
+            sink.append(length.data(), length.size());
+            sink.append(":", 1);
+            sink.append(key.data(), key.size());
+            encodeTo(item, sink);
+        }
+        sink.append("e", 1);
+    }
+}
@@ -4,20 +4,20 @@
 #include <cctype>
 
 // Parse a bencoded string into a BencodedValue
-BencodedValue BencodeParser::parse(const std::string& data) {
+BencodedValue BencodeParser::parse(std::string_view data) {
     size_t pos = 0;
     return parseValue(data, pos);
 }
 
 // Method to Parse Integer data, e.g, i1234e
-int64_t BencodeParser::parseInt(const std::string& data, size_t& pos) {
+int64_t BencodeParser::parseInt(std::string_view data, size_t& pos) {
     pos++; // Skip 'i'
     size_t endPos = data.find('e', pos);
-    if (endPos == std::string::npos) {
+    if (endPos == std::string_view::npos) {
         throw std::runtime_error("Invalid integer format");
     }
 
-    std::string numberStr = data.substr(pos, endPos - pos);
+    std::string numberStr(data.substr(pos, endPos - pos));
     pos = endPos + 1; // Skip 'e'
 
     try {
@@ -28,13 +28,13 @@ int64_t BencodeParser::parseInt(const std::string& data, size_t& pos) {
 }
 
 // Method to Parse String data, e.g, 4:abcd
-std::string BencodeParser::parseString(const std::string& data, size_t& pos) {
+std::string BencodeParser::parseString(std::string_view data, size_t& pos) {
     size_t colonPos = data.find(':', pos);
-    if (colonPos == std::string::npos) {
+    if (colonPos == std::string_view::npos) {
         throw std::runtime_error("Invalid string format");
     }
 
-    std::string lengthStr = data.substr(pos, colonPos - pos);
+    std::string lengthStr(data.substr(pos, colonPos - pos));
     int64_t length = std::stoll(lengthStr);
     pos = colonPos + 1;
 
@@ -42,13 +42,13 @@ std::string BencodeParser::parseString(const std::string& data, size_t& pos) {
         throw std::runtime_error("String length exceeds input size");
     }
 
-    std::string result = data.substr(pos, length);
+    std::string result(data.substr(pos, length));
     pos += length;
     return result;
 }
 
 // Method to Parse a list, e.g, li42e5:helloli1ei2eee -> [42, "hello", [1, 2]]
-BencodedList BencodeParser::parseList(const std::string& data, size_t& pos) {
+BencodedList BencodeParser::parseList(std::string_view data, size_t& pos) {
     pos++; // Skip 'l'
     BencodedList result;
 
@@ -65,7 +65,7 @@ BencodedList BencodeParser::parseList(const std::string& data, size_t& pos) {
 }
 
 // Method to Parse a dictionary, e.g, d3:keyi42ee -> {"key": 42}
-BencodedDict BencodeParser::parseDict(const std::string& data, size_t& pos) {
+BencodedDict BencodeParser::parseDict(std::string_view data, size_t& pos) {
     pos++; // Skip 'd'
     BencodedDict result;
 
@@ -84,7 +84,7 @@ BencodedDict BencodeParser::parseDict(const std::string& data, size_t& pos) {
 }
 
 // Main Parse function
-BencodedValue BencodeParser::parseValue(const std::string& data, size_t& pos) {
+BencodedValue BencodeParser::parseValue(std::string_view data, size_t& pos) {
     if (pos >= data.size()) {
         throw std::runtime_error("Unexpected end of input");
     }
@@ -0,0 +1,65 @@
+#include "../include/cancellation.hpp"
+
+namespace DHT {
+
+    /**
+     * @brief Construct a token that is not cancelled.
+     */
+    CancellationToken::CancellationToken() : state_(std::make_shared<State>()) {}
+
+    /**
+     * @brief Cancel and run every registered callback. Later calls do nothing.
+     */
+    void CancellationToken::cancel() {
+        std::map<size_t, std::function<void()>> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            if (state_->cancelled) {
+                return;
+            }
+            state_->cancelled = true;
+            callbacks.swap(state_->callbacks);
+        }
+        for (auto& entry : callbacks) {
+            entry.second();
+        }
+    }
+
+    /**
+     * @brief Whether cancel() has been called on this token or a copy.
+     */
+    bool CancellationToken::cancelled() const {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        return state_->cancelled;
+    }
+
+    /**
+     * @brief Register a callback to run on cancel().
+     *
+     * @param callback The callback.
+     *
+     * @return An ID for remove(), or 0 if the token was already cancelled and
+     *         the callback has run.
+     */
+    size_t CancellationToken::on_cancel(std::function<void()> callback) {
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            if (!state_->cancelled) {
+                size_t id = state_->next_id++;
+                state_->callbacks.emplace(id, std::move(callback));
+                return id;
+            }
+        }
+        callback();
+        return 0;
+    }
+
+    /**
+     * @brief Unregister a callback that is no longer needed.
+     */
+    void CancellationToken::remove(size_t id) {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->callbacks.erase(id);
+    }
+
+} // namespace DHT
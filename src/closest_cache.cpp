@@ -0,0 +1,127 @@
+#include "../include/closest_cache.hpp"
+#include <algorithm>
+
+namespace DHT {
+
+    /**
+     * @brief Construct an empty cache.
+     *
+     * @param prefix_bits Leading target bits that select an entry (1..64).
+     * @param ttl         How long a stored set is used for seeding.
+     * @param capacity    Maximum number of entries (0 disables the cache).
+     */
+    ClosestCache::ClosestCache(unsigned prefix_bits, std::chrono::seconds ttl, size_t capacity)
+        : prefix_bits_(std::clamp(prefix_bits, 1u, 64u)), ttl_(ttl), capacity_(capacity) {}
+
+    /**
+     * @brief Entry key: the first prefix_bits bits of the target.
+     */
+    uint64_t ClosestCache::key(const NodeID& target) const {
+        uint64_t prefix = 0;
+        for (size_t i = 0; i < 8; ++i) {
+            prefix = (prefix << 8) | target[i];
+        }
+        return prefix >> (64 - prefix_bits_);
+    }
+
+    /**
+     * @brief Remember the closest nodes a lookup found. Nodes already cached
+     *        for the prefix are kept too, the merged set is trimmed to the 2K
+     *        closest to this target and the entry's age restarts.
+     *
+     * @param target  The lookup target.
+     * @param closest The responders the lookup returned.
+     */
+    void ClosestCache::store(const NodeID& target, const std::vector<Node>& closest) {
+        if (capacity_ == 0 || closest.empty()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        Clock::time_point now = Clock::now();
+
+        auto it = entries_.find(key(target));
+        if (it == entries_.end()) {
+            if (entries_.size() >= capacity_) {
+                evict(now);
+            }
+            it = entries_.emplace(key(target), Entry{}).first;
+        } else if (now - it->second.stored >= ttl_) {
+            it->second.nodes.clear();
+        }
+
+        std::vector<Node>& nodes = it->second.nodes;
+        for (const auto& node : closest) {
+            bool known = std::any_of(nodes.begin(), nodes.end(), [&](const Node& n) {
+                return n.id == node.id;
+            });
+            if (!known) {
+                nodes.push_back(node);
+            }
+        }
+        std::sort(nodes.begin(), nodes.end(), [&](const Node& a, const Node& b) {
+            return xor_distance(a.id, target) < xor_distance(b.id, target);
+        });
+        if (nodes.size() > 2 * K) {
+            nodes.resize(2 * K);
+        }
+        it->second.stored = now;
+    }
+
+    /**
+     * @brief Nodes to seed a lookup for target with.
+     *
+     * @param target The lookup target.
+     * @param k      Maximum number of nodes to return.
+     *
+     * @return Up to k cached nodes, closest to target first, or nothing if no
+     *         fresh entry covers the target's prefix.
+     */
+    std::vector<Node> ClosestCache::seeds(const NodeID& target, size_t k) const {
+        std::vector<Node> nodes;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = entries_.find(key(target));
+            if (it == entries_.end() || Clock::now() - it->second.stored >= ttl_) {
+                return {};
+            }
+            nodes = it->second.nodes;
+        }
+        std::sort(nodes.begin(), nodes.end(), [&](const Node& a, const Node& b) {
+            return xor_distance(a.id, target) < xor_distance(b.id, target);
+        });
+        if (nodes.size() > k) {
+            nodes.resize(k);
+        }
+        return nodes;
+    }
+
+    /**
+     * @brief Number of entries, fresh or not.
+     */
+    size_t ClosestCache::size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.size();
+    }
+
+    /**
+     * @brief Make room for one entry: drop every expired entry, or the oldest
+     *        one if none has expired. Requires mutex_.
+     */
+    void ClosestCache::evict(Clock::time_point now) {
+        auto oldest = entries_.end();
+        for (auto it = entries_.begin(); it != entries_.end();) {
+            if (now - it->second.stored >= ttl_) {
+                it = entries_.erase(it);
+                continue;
+            }
+            if (oldest == entries_.end() || it->second.stored < oldest->second.stored) {
+                oldest = it;
+            }
+            ++it;
+        }
+        if (entries_.size() >= capacity_ && oldest != entries_.end()) {
+            entries_.erase(oldest);
+        }
+    }
+
+} // namespace DHT
@@ -0,0 +1,178 @@
+#include "../include/cpu_placement.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#ifdef __linux__
+    #include <dirent.h>
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/mman.h>
+    #include <sys/socket.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    #include <linux/mempolicy.h>
+#endif
+
+namespace DHT {
+
+    /**
+     * @brief Pin the calling thread to a single CPU.
+     *
+     * @param cpu The CPU index.
+     *
+     * @return True if the affinity was applied.
+     */
+    bool pin_current_thread(int cpu) {
+#ifdef __linux__
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            return false;
+        }
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+        (void)cpu;
+        return false;
+#endif
+    }
+
+    /**
+     * @brief The CPU the calling thread is currently running on.
+     */
+    int current_cpu() {
+#ifdef __linux__
+        return sched_getcpu();
+#else
+        return -1;
+#endif
+    }
+
+    /**
+     * @brief Find the NUMA node a CPU belongs to by looking for the nodeN link
+     *        sysfs places in /sys/devices/system/cpu/cpuC/.
+     *
+     * @param cpu The CPU index.
+     *
+     * @return The node number, or -1 if unknown (non-NUMA kernel or platform).
+     */
+    int numa_node_of_cpu(int cpu) {
+#ifdef __linux__
+        std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+        DIR* dir = opendir(path.c_str());
+        if (!dir) {
+            return -1;
+        }
+        int node = -1;
+        while (dirent* entry = readdir(dir)) {
+            if (std::strncmp(entry->d_name, "node", 4) == 0 &&
+                entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+                node = std::atoi(entry->d_name + 4);
+                break;
+            }
+        }
+        closedir(dir);
+        return node;
+#else
+        (void)cpu;
+        return -1;
+#endif
+    }
+
+    /**
+     * @brief Ask the kernel to deliver this socket's packets on a given CPU
+     *        (SO_INCOMING_CPU), which also picks the matching SO_REUSEPORT shard.
+     */
+    bool set_incoming_cpu(int sock, int cpu) {
+#if defined(__linux__) && defined(SO_INCOMING_CPU)
+        return setsockopt(sock, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) == 0;
+#else
+        (void)sock;
+        (void)cpu;
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Allow several sockets to bind the same UDP port (SO_REUSEPORT).
+     *        Must be called before bind().
+     */
+    bool enable_reuseport(int sock) {
+#if defined(__linux__) && defined(SO_REUSEPORT)
+        int one = 1;
+        return setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) == 0;
+#else
+        (void)sock;
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Allocate a buffer on a NUMA node. The pages get a preferred-node
+     *        policy (mbind) and are touched immediately, so the caller should
+     *        already be running on that node.
+     *
+     * @param size      Buffer size in bytes.
+     * @param numa_node Target node, or -1 to rely on first-touch only.
+     */
+    LocalBuffer::LocalBuffer(size_t size, int numa_node) : size_(size) {
+#ifdef __linux__
+        void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem != MAP_FAILED) {
+            if (numa_node >= 0 && numa_node < 64) {
+                unsigned long mask = 1UL << numa_node;
+                syscall(SYS_mbind, mem, size, MPOL_PREFERRED, &mask, 64, 0);
+            }
+            data_ = static_cast<char*>(mem);
+            mapped_ = true;
+        }
+#else
+        (void)numa_node;
+#endif
+        if (!data_) {
+            data_ = new char[size];
+        }
+        std::memset(data_, 0, size); // First touch places the pages
+    }
+
+    LocalBuffer::~LocalBuffer() {
+        release();
+    }
+
+    LocalBuffer::LocalBuffer(LocalBuffer&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)),
+          size_(std::exchange(other.size_, 0)),
+          mapped_(std::exchange(other.mapped_, false)) {}
+
+    LocalBuffer& LocalBuffer::operator=(LocalBuffer&& other) noexcept {
+        if (this != &other) {
+            release();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            mapped_ = std::exchange(other.mapped_, false);
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Return the memory to the system.
+     */
+    void LocalBuffer::release() {
+        if (!data_) {
+            return;
+        }
+#ifdef __linux__
+        if (mapped_) {
+            munmap(data_, size_);
+            data_ = nullptr;
+            return;
+        }
+#endif
+        delete[] data_;
+        data_ = nullptr;
+    }
+
+} // namespace DHT
@@ -0,0 +1,209 @@
+#include "../include/datagram_batch.hpp"
+#include <algorithm>
+#include <cerrno>
+
+#ifndef _WIN32
+    #include <sys/uio.h>
+#endif
+
+namespace DHT {
+
+    /**
+     * @brief Set up the slots. Their packets are taken from the pool on the
+     *        first receive(), so they come from the receiving thread's node.
+     *
+     * @param slots Datagrams per batch.
+     * @param pool  Where the slot buffers come from; a datagram longer than
+     *              the pool's packet size is truncated.
+     */
+    ReceiveRing::ReceiveRing(size_t slots, PacketPool& pool)
+        : pool_(pool), packets_(slots), lengths_(slots, 0), senders_(slots) {
+#ifdef __linux__
+        headers_.resize(slots);
+        vectors_.resize(slots);
+        for (size_t i = 0; i < slots; ++i) {
+            headers_[i].msg_hdr.msg_iov = &vectors_[i];
+            headers_[i].msg_hdr.msg_iovlen = 1;
+            headers_[i].msg_hdr.msg_name = &senders_[i];
+        }
+#endif
+    }
+
+    /**
+     * @brief Read as many waiting datagrams as fit into the slots. Datagrams
+     *        longer than a packet are dropped and counted in truncated().
+     *
+     * @param sock A non-blocking UDP socket.
+     *
+     * @return Datagrams read into slots [0, n) (0 if every one read was
+     *         dropped), or -1 on error / nothing waiting.
+     */
+    int ReceiveRing::receive(int sock) {
+        refill();
+#ifdef __linux__
+        for (auto& header : headers_) {
+            header.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            header.msg_hdr.msg_flags = 0;
+        }
+        // MSG_TRUNC makes msg_len the datagram's real length, so a cut-off
+        // datagram is recognisable either way.
+        int count = recvmmsg(sock, headers_.data(), static_cast<unsigned int>(headers_.size()),
+                             MSG_DONTWAIT | MSG_TRUNC, nullptr);
+        if (count < 0) {
+            return count;
+        }
+
+        // Move the complete datagrams to the front, keeping their order
+        int kept = 0;
+        for (int i = 0; i < count; ++i) {
+            if ((headers_[i].msg_hdr.msg_flags & MSG_TRUNC) || headers_[i].msg_len > packets_[i].capacity()) {
+                truncated_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (kept != i) {
+                std::swap(packets_[kept], packets_[i]);
+                std::swap(senders_[kept], senders_[i]);
+                vectors_[kept].iov_base = packets_[kept].data();
+                vectors_[kept].iov_len = packets_[kept].capacity();
+                vectors_[i].iov_base = packets_[i].data();
+                vectors_[i].iov_len = packets_[i].capacity();
+            }
+            lengths_[kept++] = headers_[i].msg_len;
+        }
+        return kept;
+#else
+        int count = 0;
+        while (static_cast<size_t>(count) < lengths_.size()) {
+            int bytes = receive_one(sock, packets_[count], senders_[count]);
+            if (bytes < 0) {
+                return count > 0 ? count : -1;
+            }
+            lengths_[count++] = static_cast<size_t>(bytes);
+        }
+        return count;
+#endif
+    }
+
+    /**
+     * @brief Read a single datagram into a packet outside the slots, e.g.
+     *        while the slots still hold a batch being handled. Datagrams
+     *        longer than the packet are dropped and counted in truncated().
+     *
+     * @param sock   A non-blocking UDP socket.
+     * @param packet Receives the datagram (its size is left unchanged).
+     * @param sender Receives the sender's address.
+     *
+     * @return The datagram's length, or -1 on error / nothing waiting.
+     */
+    int ReceiveRing::receive_one(int sock, Packet& packet, sockaddr_in& sender) {
+        for (;;) {
+#ifdef _WIN32
+            socklen_t sender_len = sizeof(sockaddr_in);
+            int bytes = recvfrom(sock, packet.data(), static_cast<int>(packet.capacity()), 0,
+                                 reinterpret_cast<sockaddr*>(&sender), &sender_len);
+            if (bytes < 0 && WSAGetLastError() == WSAEMSGSIZE) {
+                truncated_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            return bytes;
+#else
+            iovec vector{packet.data(), packet.capacity()};
+            msghdr header{};
+            header.msg_name = &sender;
+            header.msg_namelen = sizeof(sockaddr_in);
+            header.msg_iov = &vector;
+            header.msg_iovlen = 1;
+            ssize_t bytes = recvmsg(sock, &header, 0);
+            if (bytes < 0) {
+                if (errno == EMSGSIZE) {
+                    truncated_.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                return -1;
+            }
+            if (header.msg_flags & MSG_TRUNC) {
+                truncated_.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            return static_cast<int>(bytes);
+#endif
+        }
+    }
+
+    /**
+     * @brief Hand a received datagram on without copying it. The slot gets
+     *        a fresh packet from the pool on the next receive().
+     *
+     * @param slot A slot filled by the last receive().
+     */
+    Packet ReceiveRing::take(size_t slot) {
+        Packet packet = std::move(packets_[slot]);
+        packet.resize(lengths_[slot]);
+        return packet;
+    }
+
+    /**
+     * @brief Give every empty slot a packet from the pool.
+     */
+    void ReceiveRing::refill() {
+        for (size_t i = 0; i < packets_.size(); ++i) {
+            if (packets_[i]) {
+                continue;
+            }
+            packets_[i] = pool_.acquire();
+#ifdef __linux__
+            vectors_[i].iov_base = packets_[i].data();
+            vectors_[i].iov_len = packets_[i].capacity();
+#endif
+        }
+    }
+
+    /**
+     * @brief Preallocate headers for up to capacity datagrams per send().
+     */
+    SendBatch::SendBatch(size_t capacity) : capacity_(std::max<size_t>(capacity, 1)) {
+#ifdef __linux__
+        headers_.resize(capacity_);
+        vectors_.resize(capacity_);
+#endif
+    }
+
+    /**
+     * @brief Send datagrams from the front of the queue in one batch. The
+     *        caller pops what was sent; the queue must not change meanwhile.
+     *
+     * @param sock  A non-blocking UDP socket.
+     * @param queue Datagrams waiting to be sent, oldest first.
+     *
+     * @return Datagrams sent, or -1 if the first send failed.
+     */
+    int SendBatch::send(int sock, const std::deque<Datagram>& queue) {
+        size_t count = std::min(capacity_, queue.size());
+        if (count == 0) {
+            return 0;
+        }
+#ifdef __linux__
+        for (size_t i = 0; i < count; ++i) {
+            const Datagram& datagram = queue[i];
+            vectors_[i].iov_base = const_cast<char*>(datagram.data.data());
+            vectors_[i].iov_len = datagram.data.size();
+            headers_[i].msg_hdr = {};
+            headers_[i].msg_hdr.msg_name = const_cast<sockaddr_in*>(&datagram.addr);
+            headers_[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            headers_[i].msg_hdr.msg_iov = &vectors_[i];
+            headers_[i].msg_hdr.msg_iovlen = 1;
+        }
+        return sendmmsg(sock, headers_.data(), static_cast<unsigned int>(count), 0);
+#else
+        for (size_t i = 0; i < count; ++i) {
+            const Datagram& datagram = queue[i];
+            if (sendto(sock, datagram.data.data(), static_cast<int>(datagram.data.size()), 0,
+                       reinterpret_cast<const sockaddr*>(&datagram.addr), sizeof(datagram.addr)) < 0) {
+                return i > 0 ? static_cast<int>(i) : -1;
+            }
+        }
+        return static_cast<int>(count);
+#endif
+    }
+
+} // namespace DHT
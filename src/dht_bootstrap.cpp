@@ -4,6 +4,7 @@
 #include <random>
 #include <sstream>
 #include <iomanip>
+#include <chrono>
 
 #ifdef _WIN32
     #pragma comment(lib, "ws2_32.lib")
@@ -32,21 +33,119 @@
     #include <arpa/inet.h>
     #include <sys/socket.h>
     #include <unistd.h>
-
-    // For non-Windows platforms, these are no-ops.
-    inline void init_winsock() {}
-    inline void cleanup_winsock() {}
 #endif
 
 namespace DHT {
 
+    /**
+     * @brief Whether the last failed socket call only found nothing to do
+     *        (non-blocking socket would block, or interrupted).
+     */
+    static bool would_block() {
+#ifdef _WIN32
+        int error = WSAGetLastError();
+        return error == WSAEWOULDBLOCK || error == WSAEINTR;
+#else
+        return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+    }
+
+    /**
+     * @brief Dotted-quad form of an IPv4 address. Unlike inet_ntoa() it uses
+     *        no shared buffer, so shard and pipeline workers may call it at once.
+     */
+    static std::string ip_string(const in_addr& addr) {
+        char ip_str[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+        return ip_str;
+    }
+
+    // The instance whose run_once() is on this thread's stack, if any: its
+    // sends need no wake-up, since the iteration flushes them
+    static thread_local const DHTBootstrap* pumping_instance = nullptr;
+
+    struct PumpingScope {
+        explicit PumpingScope(const DHTBootstrap* instance) : outer(pumping_instance) {
+            pumping_instance = instance;
+        }
+        ~PumpingScope() { pumping_instance = outer; }
+        const DHTBootstrap* outer;
+    };
+
+    static uint64_t rotl(uint64_t x, int b) {
+        return (x << b) | (x >> (64 - b));
+    }
+
+    /**
+     * @brief SipHash-2-4 of a short message (announce tokens are a keyed hash
+     *        of the requester's address; a plain mix would leak the key).
+     *
+     * @param k0   First half of the key.
+     * @param k1   Second half of the key.
+     * @param data Message bytes.
+     * @param len  Message length.
+     *
+     * @return The 64-bit tag.
+     */
+    static uint64_t siphash24(uint64_t k0, uint64_t k1, const uint8_t* data, size_t len) {
+        uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+        uint64_t v1 = 0x646f72616e646f6dULL ^ k1;
+        uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+        uint64_t v3 = 0x7465646279746573ULL ^ k1;
+
+        auto round = [&]() {
+            v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+            v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+            v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+            v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+        };
+
+        size_t full = len & ~size_t(7);
+        for (size_t i = 0; i < full; i += 8) {
+            uint64_t m = 0;
+            for (int b = 0; b < 8; ++b) {
+                m |= static_cast<uint64_t>(data[i + b]) << (8 * b);
+            }
+            v3 ^= m;
+            round();
+            round();
+            v0 ^= m;
+        }
+
+        uint64_t last = static_cast<uint64_t>(len) << 56;
+        for (size_t i = full; i < len; ++i) {
+            last |= static_cast<uint64_t>(data[i]) << (8 * (i - full));
+        }
+        v3 ^= last;
+        round();
+        round();
+        v0 ^= last;
+
+        v2 ^= 0xff;
+        round();
+        round();
+        round();
+        round();
+        return v0 ^ v1 ^ v2 ^ v3;
+    }
+
     /**
      * @brief Constructor for the DHTBootstrap class. Initializes Winsock (on Windows),
      *        creates a UDP socket, and binds it to the specified DHT port.
      *
-     * @param my_node_id The local node's ID.
+     * @param my_node_id The local node's ID (primary identity).
+     * @param config     Runtime configuration (listening port, ...).
      */
-    DHTBootstrap::DHTBootstrap(const NodeID& my_node_id) : my_node_id_(my_node_id) {
+    DHTBootstrap::DHTBootstrap(const NodeID& my_node_id, const DHTConfig& config)
+        : packet_pool_(config.packet_size, config.packet_pool_capacity),
+          send_queue_(MAX_QUEUED_SENDS), send_batch_(SEND_BATCH), transactions_(config.max_pending_queries),
+          receive_ring_(std::make_unique<ReceiveRing>(RECEIVE_BATCH, packet_pool_)),
+          rtt_(config.query_timeout, config.min_query_timeout, config.query_timeout),
+          config_(config), my_node_id_(my_node_id), routing_table_(my_node_id),
+          contacts_(config.contact_pool_capacity),
+          closest_cache_(config.closest_cache_prefix_bits, config.closest_cache_ttl,
+                         config.closest_cache_capacity),
+          resolver_(config.resolver_cache_path) {
         init_winsock();  // Initialize Winsock on Windows (no-op on other platforms)
 
         // Create UDP socket
@@ -60,10 +159,14 @@ namespace DHT {
             exit(1);
         }
 
+        if ((config_.reuse_port || config_.socket_shards > 1) && !enable_reuseport(sock_)) {
+            std::cerr << "Failed to enable SO_REUSEPORT on DHT socket" << '\n';
+        }
+
         // Bind the socket to a port
         sockaddr_in local_addr{};
         local_addr.sin_family = AF_INET;
-        local_addr.sin_port = htons(DHT_PORT);     // Use the configured DHT port
+        local_addr.sin_port = htons(config_.port); // Use the configured DHT port
         local_addr.sin_addr.s_addr = INADDR_ANY;   // Listen on all interfaces
 
         if (bind(sock_, reinterpret_cast<sockaddr*>(&local_addr), sizeof(local_addr)) < 0) {
@@ -75,68 +178,571 @@ namespace DHT {
             exit(1);
         }
 
-        std::cout << "DHT Node started on Port: " << DHT_PORT << '\n';
+        // Every receive and send goes through the event loop
+        if (!set_nonblocking(sock_)) {
+            std::cerr << "Failed to make the DHT socket non-blocking" << '\n';
+            exit(1);
+        }
+        loop_ = std::make_unique<EventLoop>(sock_);
+        if (config_.io_uring && config_.pipeline_workers > 0) {
+            std::cerr << "[DHT] io_uring is ignored with pipeline_workers > 0; socket I/O: epoll" << '\n';
+        } else if (config_.io_uring) {
+            if (uring_.open(sock_, loop_->wake_fd(), URING_BUFFERS, config_.packet_size, -1)) {
+                std::cout << "[DHT] Socket I/O: io_uring" << '\n';
+            } else {
+                std::cout << "[DHT] io_uring unavailable; socket I/O: epoll" << '\n';
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(token_mutex_);
+            rotate_token_secrets();
+            rotate_token_secrets();
+        }
+
+        std::cout << "DHT Node started on Port: " << config_.port << '\n';
 
-        // Create the first bucket in the routing table.
-        routing_table_.emplace_back();
+        if (!config_.shared_contacts_name.empty() &&
+            shared_contacts_.open(config_.shared_contacts_name, config_.shared_contacts_capacity)) {
+            std::cout << "Imported " << import_shared_contacts() << " contacts from "
+                      << config_.shared_contacts_name << '\n';
+        }
     }
 
     /**
      * @brief Adds a bootstrap node to the internal list of bootstrap nodes.
+     *        Hostnames are resolved on the resolver thread; every address they
+     *        resolve to becomes a bootstrap node once the answer arrives.
      *
-     * @param ip   The IP address of the bootstrap node.
+     * @param host An IPv4 literal or a hostname.
      * @param port The UDP port of the bootstrap node.
      */
-    void DHTBootstrap::add_bootstrap_node(const std::string& ip, uint16_t port) {
-        Node bootstrap_node;
-        bootstrap_node.id = generate_random_node_id();
-        bootstrap_node.ip = ip;
-        bootstrap_node.port = port;
-        bootstrap_nodes_.push_back(bootstrap_node);
+    void DHTBootstrap::add_bootstrap_node(const std::string& host, uint16_t port) {
+        in_addr literal{};
+        if (inet_pton(AF_INET, host.c_str(), &literal) == 1) {
+            on_bootstrap_resolved({host}, port);
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(bootstrap_mutex_);
+            unresolved_bootstrap_hosts_++;
+        }
+        resolver_.resolve(host, [this, port](const std::string&, const std::vector<std::string>& addresses) {
+            // Continue on the thread pumping the socket
+            schedule(std::chrono::milliseconds(0), [this, addresses, port]() {
+                {
+                    std::lock_guard<std::mutex> lock(bootstrap_mutex_);
+                    unresolved_bootstrap_hosts_--;
+                }
+                on_bootstrap_resolved(addresses, port);
+            });
+        });
     }
 
     /**
-     * @brief Perform the bootstrapping process by contacting each known bootstrap node
-     *        with a FIND_NODE request for our own node ID.
+     * @brief Add freshly resolved bootstrap addresses. If bootstrap() is waiting
+     *        for its first seed it starts now; if it is already running, the
+     *        new seeds are asked for our own neighbourhood directly.
+     *
+     * @param addresses IPv4 literals.
+     * @param port      The UDP port of the bootstrap node.
      */
-    void DHTBootstrap::bootstrap() {
-        // Re-initialize Winsock on Windows
-        // init_winsock();
+    void DHTBootstrap::on_bootstrap_resolved(const std::vector<std::string>& addresses, uint16_t port) {
+        std::vector<Node> added;
+        std::vector<std::function<void(size_t)>> waiting;
+        bool started;
+        {
+            std::lock_guard<std::mutex> lock(bootstrap_mutex_);
+            for (const auto& ip : addresses) {
+                bool known = std::any_of(bootstrap_nodes_.begin(), bootstrap_nodes_.end(), [&](const Node& n) {
+                    return n.ip == ip && n.port == port;
+                });
+                if (known) {
+                    continue;
+                }
+                Node bootstrap_node;
+                bootstrap_node.id = generate_random_node_id();
+                bootstrap_node.ip = ip;
+                bootstrap_node.port = port;
+                bootstrap_nodes_.push_back(bootstrap_node);
+                added.push_back(bootstrap_node);
+            }
+            started = bootstrap_started_;
+            if (!bootstrap_waiting_.empty() && (!bootstrap_nodes_.empty() || unresolved_bootstrap_hosts_ == 0)) {
+                waiting.swap(bootstrap_waiting_);
+            }
+        }
+
+        if (!waiting.empty()) {
+            // One bootstrap for everyone who asked while the seeds resolved
+            bootstrap([waiting = std::move(waiting)](size_t size) {
+                for (const auto& done : waiting) {
+                    done(size);
+                }
+            });
+            return;
+        }
+        if (!started) {
+            return;
+        }
+
+        BencodedDict args;
+        args["target"] = BencodedValue(std::string(reinterpret_cast<const char*>(my_node_id_.data()), NODE_ID_SIZE));
+        for (const auto& seed : added) {
+            std::cout << "Contacting bootstrap node: " << seed.ip << ":" << seed.port << '\n';
+            send_query(seed, "find_node", args, [this](const QueryResult& result) {
+                if (!result.ok()) {
+                    return;
+                }
+                try {
+                    const auto& r = result.message.asDict().at("r").asDict();
+                    Node responder{string_to_node_id(r.at("id").asString()), result.ip, result.port};
+                    add_to_routing_table(responder);
+
+                    std::vector<Node> nodes;
+                    auto nodes_it = r.find("nodes");
+                    if (nodes_it != r.end()) {
+                        parse_compact_nodes(nodes_it->second.asString(), nodes);
+                    }
+                    for (const auto& node : nodes) {
+                        add_to_routing_table(node);
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "Malformed find_node response from " << result.ip << ":" << result.port
+                              << ": " << e.what() << '\n';
+                }
+            });
+        }
+    }
+
+    /**
+     * @brief Join the network. A self-lookup queries every bootstrap node at
+     *        once, then random-target lookups refresh every bucket that is
+     *        still empty, round after round, until the routing table holds
+     *        bootstrap_target_size nodes or stops growing. Skipped if sibling
+     *        processes have already filled the shared contact table.
+     *
+     * @param done Invoked once with the routing table size when bootstrapping
+     *             stops. Callers arriving while hostnames still resolve all
+     *             wait for, and share, the bootstrap that starts then.
+     */
+    void DHTBootstrap::bootstrap(std::function<void(size_t)> done) {
+        std::vector<Node> seeds;
+        {
+            std::lock_guard<std::mutex> lock(bootstrap_mutex_);
+            if (bootstrap_nodes_.empty() && unresolved_bootstrap_hosts_ > 0) {
+                // Start as soon as the first hostname resolves
+                bootstrap_waiting_.push_back(std::move(done));
+                return;
+            }
+            bootstrap_started_ = true;
+            seeds = bootstrap_nodes_;
+        }
+
+        if (shared_contacts_.is_open()) {
+            import_shared_contacts();
+            if (routing_table_.size() >= config_.bootstrap_target_size) {
+                std::cout << "Routing table filled from shared contacts; skipping bootstrap nodes" << '\n';
+                done(routing_table_.size());
+                return;
+            }
+        }
 
-        for (const auto& bootstrap_node : bootstrap_nodes_) {
-            std::cout << "Contacting bootstrap node: " << bootstrap_node.ip 
+        for (const auto& bootstrap_node : seeds) {
+            std::cout << "Contacting bootstrap node: " << bootstrap_node.ip
                       << ":" << bootstrap_node.port << '\n';
+        }
+
+        // Wide enough to query every seed in the first round
+        LookupOptions options = default_lookup_options();
+        options.alpha = std::max(options.alpha, seeds.size());
+
+        lookup(my_node_id_, options, [this, done = std::move(done)](const LookupResult& result) {
+            std::cout << "Self-lookup finished in " << result.duration.count() << " ms; routing table has "
+                      << routing_table_.size() << " nodes" << '\n';
+            refresh_empty_buckets(config_.bootstrap_rounds, 0, done);
+        });
+    }
 
-            // Send a FIND_NODE request to the bootstrap node
-            auto nodes = send_find_node_request(bootstrap_node, my_node_id_);
-            for (const auto& node : nodes) {
-                add_to_routing_table(node);
+    /**
+     * @brief Join the network and block until bootstrapping stops.
+     */
+    void DHTBootstrap::bootstrap() {
+        auto promise = std::make_shared<std::promise<size_t>>();
+        std::future<size_t> result = promise->get_future();
+        bootstrap([promise](size_t size) { promise->set_value(size); });
+        wait_for(result);
+    }
+
+    /**
+     * @brief One bootstrap fill round: a lookup for a random ID in every empty
+     *        bucket range. The targets share leading bits with our own ID,
+     *        so they run as one merged traversal (see MultiLookup). Starts the next
+     *        round unless the table reached bootstrap_target_size or stopped
+     *        growing.
+     *
+     * @param rounds        Rounds left, including this one.
+     * @param previous_size Table size when the previous round ended.
+     * @param done          Invoked once with the final table size.
+     */
+    void DHTBootstrap::refresh_empty_buckets(size_t rounds, size_t previous_size,
+                                             std::function<void(size_t)> done) {
+        size_t size = routing_table_.size();
+
+        // Buckets past the last one are empty too; refresh the next one down
+        std::vector<size_t> empty = routing_table_.read([](const RoutingTable::Table& table) {
+            std::vector<size_t> indices;
+            for (size_t i = 0; i < table.size(); ++i) {
+                if (table[i].empty()) {
+                    indices.push_back(i);
+                }
             }
+            indices.push_back(table.size());
+            return indices;
+        });
+
+        if (size >= config_.bootstrap_target_size || rounds == 0 || (previous_size > 0 && size <= previous_size)) {
+            std::cout << "Bootstrap finished with " << size << " nodes in the routing table" << '\n';
+            done(size);
+            return;
+        }
+
+        std::vector<NodeID> targets;
+        for (size_t index : empty) {
+            targets.push_back(routing_table_.random_id_in_bucket(index));
         }
 
-        // Cleanup Winsock on Windows
-        cleanup_winsock();
+        lookup_many(targets, default_lookup_options(), [this, rounds, size, done](const MultiLookupResult& result) {
+            std::cout << "Refreshed " << result.lookups.size() << " buckets with " << result.queries
+                      << " queries; routing table has " << routing_table_.size() << " nodes" << '\n';
+            refresh_empty_buckets(rounds - 1, size, done);
+        });
     }
-    
+
+    /**
+     * @brief Find peers for an infohash with an iterative get_peers lookup.
+     *
+     * @param info_hash The infohash.
+     *
+     * @return The distinct peers returned by the nodes visited.
+     */
     std::vector<DHT::Node> DHTBootstrap::findPeers(const NodeID& info_hash) {
-        std::vector<DHT::Node> allPeers;
-    
-        for (const auto& bootstrap_node : bootstrap_nodes_) {
-            std::vector<DHT::Node> found_nodes = send_find_node_request(bootstrap_node, info_hash);
-            allPeers.insert(allPeers.end(), found_nodes.begin(), found_nodes.end());
+        LookupResult result = get_peers(info_hash);
+
+        std::cout << "get_peers for " << node_id_to_hex(info_hash) << " finished in "
+                  << result.duration.count() << " ms, " << result.hops << " hops, "
+                  << result.responses << "/" << result.queries << " queries answered, "
+                  << result.peers.size() << " peers" << '\n';
+
+        return result.peers;
+    }
+
+    /**
+     * @brief Start an iterative get_peers lookup.
+     *
+     * @param info_hash The infohash.
+     * @param max_peers Stop once this many distinct peers are known (0: run
+     *                  until the K closest nodes have answered).
+     * @param done      Invoked once with the closest responders, their tokens
+     *                  and the peers found.
+     */
+    void DHTBootstrap::get_peers(const NodeID& info_hash, size_t max_peers, LookupCallback done) {
+        LookupOptions options = default_lookup_options();
+        options.get_peers = true;
+        options.max_peers = max_peers;
+        lookup(info_hash, options, std::move(done));
+    }
+
+    /**
+     * @brief Run an iterative get_peers lookup and block until it finishes.
+     */
+    LookupResult DHTBootstrap::get_peers(const NodeID& info_hash, size_t max_peers) {
+        auto promise = std::make_shared<std::promise<LookupResult>>();
+        std::future<LookupResult> result = promise->get_future();
+        get_peers(info_hash, max_peers, [promise](const LookupResult& r) { promise->set_value(r); });
+        return wait_for(result);
+    }
+
+    /**
+     * @brief Announce that we serve an infohash: a full get_peers lookup, then
+     *        announce_peer to every one of the K closest responders at once,
+     *        each with the token it handed out.
+     *
+     * @param info_hash The infohash.
+     * @param port      The port peers should connect to; 0 asks the remote
+     *                  nodes to use our DHT source port (implied_port).
+     * @param done      Invoked once every announce_peer has been answered or
+     *                  has timed out.
+     */
+    void DHTBootstrap::announce(const NodeID& info_hash, uint16_t port, AnnounceCallback done) {
+        get_peers(info_hash, 0, [this, info_hash, port, done = std::move(done)](const LookupResult& found) {
+            struct State {
+                AnnounceResult result;
+                size_t outstanding = 0;
+                std::mutex mutex;
+                AnnounceCallback done;
+            };
+            auto state = std::make_shared<State>();
+            state->result.lookup = found;
+            state->done = std::move(done);
+
+            std::vector<size_t> targets;
+            for (size_t i = 0; i < found.closest.size(); ++i) {
+                if (!found.tokens[i].empty()) {
+                    targets.push_back(i);
+                }
+            }
+            state->result.attempted = targets.size();
+            state->outstanding = targets.size();
+
+            if (targets.empty()) {
+                state->done(state->result);
+                return;
+            }
+
+            std::string info_hash_str(reinterpret_cast<const char*>(info_hash.data()), NODE_ID_SIZE);
+            for (size_t i : targets) {
+                BencodedDict args;
+                args["info_hash"] = BencodedValue(info_hash_str);
+                args["port"] = BencodedValue(static_cast<int64_t>(port));
+                args["implied_port"] = BencodedValue(static_cast<int64_t>(port == 0 ? 1 : 0));
+                args["token"] = BencodedValue(found.tokens[i]);
+
+                send_query(found.closest[i], "announce_peer", std::move(args),
+                           [state](const QueryResult& result) {
+                               bool last;
+                               {
+                                   std::lock_guard<std::mutex> lock(state->mutex);
+                                   if (result.ok()) {
+                                       state->result.announced++;
+                                   }
+                                   last = --state->outstanding == 0;
+                               }
+                               if (last) {
+                                   state->done(state->result);
+                               }
+                           });
+            }
+        });
+    }
+
+    /**
+     * @brief Announce an infohash and block until every announce_peer finished.
+     */
+    AnnounceResult DHTBootstrap::announce(const NodeID& info_hash, uint16_t port) {
+        auto promise = std::make_shared<std::promise<AnnounceResult>>();
+        std::future<AnnounceResult> result = promise->get_future();
+        announce(info_hash, port, [promise](const AnnounceResult& r) { promise->set_value(r); });
+        return wait_for(result);
+    }
+
+    /**
+     * @brief Lookup options from the node configuration.
+     */
+    LookupOptions DHTBootstrap::default_lookup_options() const {
+        LookupOptions options;
+        options.alpha = config_.lookup_alpha;
+        options.hedge_budget = config_.lookup_hedge_budget;
+        options.disjoint_paths = config_.lookup_disjoint_paths;
+        options.path_quorum = config_.lookup_path_quorum;
+        return options;
+    }
+
+    /**
+     * @brief Start an iterative lookup. The shortlist is seeded with the closest
+     *        known contacts and the bootstrap nodes. With disjoint_paths > 1 the
+     *        lookup runs as a DisjointLookup over k contacts per path.
+     *
+     * @param target  The ID to look up.
+     * @param options Parallelism and result size.
+     * @param done    Invoked once with the result.
+     */
+    void DHTBootstrap::lookup(const NodeID& target, const LookupOptions& options, LookupCallback done) {
+        if (options.disjoint_paths > 1) {
+            auto engine = std::make_shared<DisjointLookup>(*this, target, options, std::move(done));
+            engine->start(lookup_seeds(target, options.k * options.disjoint_paths));
+            return;
         }
-    
-        return allPeers;
+        auto engine = std::make_shared<Lookup>(*this, target, options, std::move(done));
+        engine->start(lookup_seeds(target, options.k));
+    }
+
+    /**
+     * @brief Start find_node lookups for several targets as one merged
+     *        traversal.
+     *
+     * @param targets The IDs to look up.
+     * @param options Parallelism and result size per traversal.
+     * @param done    Invoked once with a result per target.
+     */
+    void DHTBootstrap::lookup_many(const std::vector<NodeID>& targets, const LookupOptions& options,
+                                   MultiLookupCallback done) {
+        auto engine = std::make_shared<MultiLookup>(*this, targets, options, std::move(done));
+        engine->start();
+    }
+
+    /**
+     * @brief Run a merged multi-target lookup and block until every target
+     *        has converged.
+     */
+    MultiLookupResult DHTBootstrap::lookup_many(const std::vector<NodeID>& targets) {
+        auto promise = std::make_shared<std::promise<MultiLookupResult>>();
+        std::future<MultiLookupResult> result = promise->get_future();
+        lookup_many(targets, default_lookup_options(),
+                    [promise](const MultiLookupResult& r) { promise->set_value(r); });
+        return wait_for(result);
+    }
+
+    /**
+     * @brief Initial shortlist for a lookup: nodes a recent lookup for the same
+     *        prefix found, the closest known contacts and the bootstrap nodes.
+     *
+     * @param target The ID to look up.
+     * @param k      How many cached and known contacts to include.
+     */
+    std::vector<Node> DHTBootstrap::lookup_seeds(const NodeID& target, size_t k) {
+        std::vector<Node> seeds = closest_cache_.seeds(target, k);
+        std::vector<Node> known = find_closest_nodes(target, k);
+        seeds.insert(seeds.end(), known.begin(), known.end());
+
+        std::lock_guard<std::mutex> lock(bootstrap_mutex_);
+        seeds.insert(seeds.end(), bootstrap_nodes_.begin(), bootstrap_nodes_.end());
+        return seeds;
     }
-    
+
+    /**
+     * @brief Start an iterative lookup with the configured options.
+     */
+    void DHTBootstrap::lookup(const NodeID& target, LookupCallback done) {
+        lookup(target, default_lookup_options(), std::move(done));
+    }
+
+    /**
+     * @brief Run an iterative lookup and block until it finishes.
+     */
+    LookupResult DHTBootstrap::lookup(const NodeID& target) {
+        auto promise = std::make_shared<std::promise<LookupResult>>();
+        std::future<LookupResult> result = promise->get_future();
+        lookup(target, [promise](const LookupResult& r) { promise->set_value(r); });
+        return wait_for(result);
+    }
+
 
     /**
      * @brief Retrieve the current routing table.
      *
-     * @return A const reference to the routing table (vector of buckets).
+     * @return A copy of the current routing table snapshot (vector of buckets).
+     */
+    std::vector<Bucket> DHTBootstrap::get_routing_table() const {
+        return routing_table_.copy();
+    }
+
+    /**
+     * @brief Host an additional node ID in this process. The new identity shares
+     *        the socket, contact pool and peer store, and gets its own routing
+     *        view seeded from the contacts already known.
+     *
+     * @param id The NodeID of the virtual identity.
+     *
+     * @return The identity's index (the primary identity is index 0).
      */
-    const std::vector<Bucket>& DHTBootstrap::get_routing_table() const {
-        return routing_table_;
+    size_t DHTBootstrap::add_identity(const NodeID& id) {
+        auto table = std::make_unique<RoutingTable>(id);
+        for (const auto& contact : get_contacts()) {
+            // Only fills free slots; no eviction pings
+            if (table->insert(contact) == RoutingTable::InsertResult::Added) {
+                std::unique_lock<std::shared_mutex> lock(contacts_mutex_);
+                contacts_.pin(contact.id);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(identities_mutex_);
+        virtual_identities_.push_back(std::move(table));
+        return virtual_identities_.size();
+    }
+
+    /**
+     * @brief Number of hosted identities, including the primary one.
+     */
+    size_t DHTBootstrap::identity_count() const {
+        std::lock_guard<std::mutex> lock(identities_mutex_);
+        return virtual_identities_.size() + 1;
+    }
+
+    /**
+     * @brief The NodeID of a hosted identity.
+     *
+     * @param index Identity index (0 = primary).
+     */
+    const NodeID& DHTBootstrap::identity_id(size_t index) const {
+        return identity_table(index).self_id();
+    }
+
+    /**
+     * @brief Retrieve the routing view of a hosted identity.
+     *
+     * @param identity Identity index (0 = primary).
+     *
+     * @return A copy of that identity's routing table snapshot.
+     */
+    std::vector<Bucket> DHTBootstrap::get_routing_table(size_t identity) const {
+        return identity_table(identity).copy();
+    }
+
+    /**
+     * @brief Retrieve every contact in the shared, deduplicated contact pool.
+     */
+    std::vector<Node> DHTBootstrap::get_contacts() const {
+        std::shared_lock<std::shared_mutex> lock(contacts_mutex_);
+        return contacts_.all();
+    }
+
+    /**
+     * @brief Look up the routing table of a hosted identity.
+     *
+     * @param index Identity index (0 = primary).
+     */
+    const RoutingTable& DHTBootstrap::identity_table(size_t index) const {
+        if (index == 0) {
+            return routing_table_;
+        }
+        std::lock_guard<std::mutex> lock(identities_mutex_);
+        if (index > virtual_identities_.size()) {
+            throw std::out_of_range("Invalid identity index");
+        }
+        return *virtual_identities_[index - 1];
+    }
+
+    /**
+     * @brief Pick the hosted identity a remote address deals with. Every query
+     *        to and reply from that address carries this ID, so the remote
+     *        sees a single node at our ip:port. Rendezvous hashing keeps most
+     *        addresses on the same identity when another one is added.
+     *
+     * @param addr The remote node's address.
+     */
+    NodeID DHTBootstrap::identity_for(const sockaddr_in& addr) const {
+        auto score = [key = (static_cast<uint64_t>(addr.sin_addr.s_addr) << 16) | addr.sin_port](const NodeID& id) {
+            uint64_t prefix = 0;
+            std::memcpy(&prefix, id.data(), sizeof(prefix));
+            uint64_t x = key ^ prefix;
+            x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+            return x ^ (x >> 31);
+        };
+
+        NodeID best = my_node_id_;
+        uint64_t best_score = score(my_node_id_);
+        std::lock_guard<std::mutex> lock(identities_mutex_);
+        for (const auto& table : virtual_identities_) {
+            uint64_t candidate = score(table->self_id());
+            if (candidate > best_score) {
+                best_score = candidate;
+                best = table->self_id();
+            }
+        }
+        return best;
     }
 
     /**
@@ -145,6 +751,7 @@ namespace DHT {
      * @return A vector of Node structs for all known bootstrap nodes.
      */
     const std::vector<Node> DHTBootstrap::get_bootstrap_nodes() {
+        std::lock_guard<std::mutex> lock(bootstrap_mutex_);
         return bootstrap_nodes_;
     }
 
@@ -166,132 +773,215 @@ namespace DHT {
     }
 
     /**
-     * @brief Compute the XOR distance between two Node IDs.
+     * @brief Send a KRPC query on the shared socket. The query is registered with
+     *        the transaction manager under a fresh transaction ID; the answer is
+     *        matched in the receive loop and handed to the callback.
      *
-     * @param a First NodeID.
-     * @param b Second NodeID.
+     * @param node     The node to query.
+     * @param method   The query name ("ping", "find_node", ...).
+     * @param args     The query arguments ("a" dictionary).
+     * @param callback Invoked exactly once with the response, error or timeout.
+     * @param timeout  How long to wait for an answer.
      *
-     * @return The XOR distance as a NodeID.
+     * @return The transaction ID, for cancel_query(); empty if the query failed
+     *         before it was sent (the callback has then already run).
      */
-    NodeID DHTBootstrap::xor_distance(const NodeID& a, const NodeID& b) {
-        NodeID result;
-        for (size_t i = 0; i < NODE_ID_SIZE; ++i) {
-            result[i] = a[i] ^ b[i];
+    std::string DHTBootstrap::send_query(const Node& node, const std::string& method, BencodedDict args,
+                                         QueryCallback callback, std::chrono::milliseconds timeout) {
+        sockaddr_in remote_addr{};
+        remote_addr.sin_family = AF_INET;
+        remote_addr.sin_port = htons(node.port);
+        if (inet_pton(AF_INET, node.ip.c_str(), &remote_addr.sin_addr) != 1) {
+            std::cerr << "Invalid node address: " << node.ip << '\n';
+            callback(QueryResult{});
+            return std::string();
         }
-        return result;
+
+        // Time every answer to feed the RTT estimator
+        auto user_callback = std::make_shared<QueryCallback>(std::move(callback));
+        auto sent_at = TransactionManager::Clock::now();
+        QueryCallback measured = [this, ip = remote_addr.sin_addr.s_addr, port = node.port,
+                                  sent_at, user_callback](const QueryResult& result) {
+            if (result.status == QueryResult::Status::Timeout) {
+                rtt_.timed_out(ip, port);
+            } else {
+                rtt_.sample(ip, port, std::chrono::duration_cast<std::chrono::milliseconds>(
+                                          TransactionManager::Clock::now() - sent_at));
+            }
+            (*user_callback)(result);
+        };
+
+        std::string transaction_id;
+        if (!transactions_.begin(remote_addr.sin_addr.s_addr, node.port, sent_at + timeout,
+                                 std::move(measured), transaction_id)) {
+            std::cerr << "Too many queries in flight; dropping " << method << '\n';
+            (*user_callback)(QueryResult{});
+            return std::string();
+        }
+
+        if (args.find("id") == args.end()) {
+            NodeID self_id = identity_for(remote_addr);
+            args["id"] = BencodedValue(std::string(reinterpret_cast<const char*>(self_id.data()), 20));
+        }
+
+        BencodedDict message;
+        message["t"] = BencodedValue(transaction_id);  // Transaction ID
+        message["y"] = BencodedValue("q");             // Message type (query)
+        message["q"] = BencodedValue(method);
+        message["a"] = BencodedValue(std::move(args));
+
+        if (!send_message(message, remote_addr)) {
+            transactions_.fail(transaction_id);
+            return std::string();
+        }
+        wake_if_sooner(sent_at + timeout);
+        return transaction_id;
+    }
+
+    /**
+     * @brief Send a KRPC query with the default timeout: the contact's RTT-based
+     *        timeout if adaptive timeouts are enabled, else the fixed query_timeout.
+     */
+    std::string DHTBootstrap::send_query(const Node& node, const std::string& method, BencodedDict args,
+                                         QueryCallback callback) {
+        return send_query(node, method, std::move(args), std::move(callback), query_timeout_for(node));
     }
 
     /**
-     * @brief Send a FIND_NODE request to a remote node for a given target_id. 
-     *        Parse the response (if any) and return the list of nodes included.
+     * @brief Abandon an outbound query. Its transaction slot is freed at once
+     *        and its callback never runs; a late answer is treated as unmatched.
      *
-     * @param remote_node The node to which the FIND_NODE request will be sent.
-     * @param target_id   The NodeID being searched for.
+     * @param transaction_id The ID send_query() returned.
      *
-     * @return A list of Node objects parsed from the response.
+     * @return True if the query was still pending.
      */
-    std::vector<Node> DHTBootstrap::send_find_node_request(const Node& remote_node, const NodeID& target_id) {
-        std::vector<Node> nodes;
+    bool DHTBootstrap::cancel_query(const std::string& transaction_id) {
+        return transactions_.cancel(transaction_id);
+    }
 
-        // Create UDP socket
-        int sock = socket(AF_INET, SOCK_DGRAM, 0);
-        if (sock < 0) {
-#ifdef _WIN32
-            std::cerr << "Error creating socket! Winsock error: " << WSAGetLastError() << '\n';
-#else
-            std::cerr << "Error creating socket! errno: " << strerror(errno) << '\n';
-#endif
-            return nodes;
+    /**
+     * @brief The deadline a query to this node gets by default.
+     *
+     * @param node The node about to be queried.
+     */
+    std::chrono::milliseconds DHTBootstrap::query_timeout_for(const Node& node) const {
+        in_addr addr{};
+        if (!config_.adaptive_timeouts || inet_pton(AF_INET, node.ip.c_str(), &addr) != 1) {
+            return config_.query_timeout;
         }
+        return rtt_.timeout_for(addr.s_addr, node.port);
+    }
 
-        // Set socket timeout (2 seconds)
-#ifdef _WIN32
-        DWORD timeout = 2000; // 2 seconds in milliseconds
-        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
-#else
-        struct timeval timeout;
-        timeout.tv_sec = 2;
-        timeout.tv_usec = 0;
-        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
-#endif
-
-        // Set up remote address
-        sockaddr_in remote_addr{};
-        remote_addr.sin_family = AF_INET;
-        remote_addr.sin_port = htons(remote_node.port);
-        inet_pton(AF_INET, remote_node.ip.c_str(), &remote_addr.sin_addr);
+    /**
+     * @brief Arm a one-shot timer. It fires on the thread pumping the socket;
+     *        a loop blocked past the deadline is woken up.
+     *
+     * @param delay How long from now.
+     * @param fn    The work to run.
+     */
+    void DHTBootstrap::schedule(std::chrono::milliseconds delay, std::function<void()> fn) {
+        TimerQueue::Clock::time_point when = TimerQueue::Clock::now() + delay;
+        timers_.schedule(when, std::move(fn));
+        wake_if_sooner(when);
+    }
 
-        std::cout << "Sending FIND_NODE request to: " 
-                  << remote_node.ip << ":" << remote_node.port << '\n';
+    /**
+     * @brief Number of outbound queries currently awaiting an answer.
+     */
+    size_t DHTBootstrap::pending_queries() const {
+        return transactions_.pending();
+    }
 
-        // Create the request message using bencode
-        BencodedDict query;
-        query["id"]     = BencodedValue(std::string(reinterpret_cast<const char*>(my_node_id_.data()), 20));
-        query["target"] = BencodedValue(std::string(reinterpret_cast<const char*>(target_id.data()), 20));
+    /**
+     * @brief Usage and exhaustion counters of the primary socket's packet pool.
+     */
+    PacketPool::Stats DHTBootstrap::packet_pool_stats() const {
+        return packet_pool_.stats();
+    }
 
-        BencodedDict message;
-        message["t"] = BencodedValue("aa");  // Transaction ID
-        message["y"] = BencodedValue("q");   // Message type (query)
-        message["q"] = BencodedValue("find_node");
-        message["a"] = BencodedValue(query);
+    /**
+     * @brief Datagrams received on the primary socket that were longer than
+     *        packet_size. They are dropped unread on every backend.
+     */
+    uint64_t DHTBootstrap::truncated_datagrams() const {
+        return receive_ring_->truncated() + uring_.truncated();
+    }
 
-        std::string request = BencodeEncoder::encode(message);
+    /**
+     * @brief Responses and errors that matched no pending query, e.g. late
+     *        answers to queries that already timed out. They are dropped.
+     */
+    uint64_t DHTBootstrap::unmatched_replies() const {
+        return unmatched_replies_.load(std::memory_order_relaxed);
+    }
 
-        std::cout << "Request: " << request << '\n';
-        std::cout << "Sending: " << request.size() << " bytes -> " << request << '\n';
+    /**
+     * @brief Stage counters of the receive pipeline, while run() is active.
+     */
+    Pipeline::Stats DHTBootstrap::pipeline_stats() const {
+        std::lock_guard<std::mutex> lock(pipeline_mutex_);
+        return pipeline_ ? pipeline_->stats() : Pipeline::Stats{};
+    }
 
-        // Send the FIND_NODE request
-        if (sendto(sock, request.c_str(), request.size(), 0,
-                   (struct sockaddr*)&remote_addr, sizeof(remote_addr)) < 0) {
-#ifdef _WIN32
-            std::cerr << "Sendto failed! Winsock error: " << WSAGetLastError() << '\n';
-#else
-            std::cerr << "Sendto failed! errno: " << strerror(errno) << '\n';
-#endif
-            CLOSESOCKET(sock);
-            return nodes;
+    /**
+     * @brief Replies the shard workers dropped because their send queue was
+     *        full, while run() is active.
+     */
+    uint64_t DHTBootstrap::shard_send_drops() const {
+        std::lock_guard<std::mutex> lock(shards_mutex_);
+        uint64_t drops = 0;
+        for (const auto& shard : shards_) {
+            drops += shard->send_drops();
         }
+        return drops;
+    }
 
-        // Receive response
-        char buffer[1024];
-        sockaddr_in sender_addr{};
-        socklen_t sender_len = sizeof(sender_addr);
+    /**
+     * @brief Send a query and block until it completes.
+     */
+    QueryResult DHTBootstrap::send_query_blocking(const Node& node, const std::string& method,
+                                                  BencodedDict args) {
+        auto promise = std::make_shared<std::promise<QueryResult>>();
+        std::future<QueryResult> result = promise->get_future();
+        send_query(node, method, std::move(args), [promise](const QueryResult& r) {
+            promise->set_value(r);
+        });
+        return wait_for(result);
+    }
 
-        std::cout << "Waiting for response..." << '\n';
-        int bytes_received = recvfrom(sock, buffer, sizeof(buffer), 0,
-                                      (struct sockaddr*)&sender_addr, &sender_len);
-        if (bytes_received < 0) {
-#ifdef _WIN32
-            std::cerr << "recvfrom failed! Winsock error: " << WSAGetLastError() << '\n';
-#else
-            std::cerr << "recvfrom failed! errno: " << strerror(errno) << '\n';
-#endif
-        }
+    /**
+     * @brief Send a FIND_NODE request to a remote node for a given target_id and
+     *        block until it is answered or times out. Parse the response (if any)
+     *        and return the list of nodes included.
+     *
+     * @param remote_node The node to which the FIND_NODE request will be sent.
+     * @param target_id   The NodeID being searched for.
+     *
+     * @return A list of Node objects parsed from the response.
+     */
+    std::vector<Node> DHTBootstrap::send_find_node_request(const Node& remote_node, const NodeID& target_id) {
+        std::vector<Node> nodes;
 
-        // Parse the response if we got any data
-        if (bytes_received > 0) {
-            std::cout << "Received " << bytes_received << " bytes from "
-                      << inet_ntoa(sender_addr.sin_addr) << ":"
-                      << ntohs(sender_addr.sin_port) << '\n';
+        std::cout << "Sending FIND_NODE request to: " 
+                  << remote_node.ip << ":" << remote_node.port << '\n';
 
-            try {
-                BencodeParser parser;
-                BencodedValue response = parser.parse(std::string(buffer, bytes_received));
-                auto& response_dict = response.asDict();
+        BencodedDict query;
+        query["target"] = BencodedValue(std::string(reinterpret_cast<const char*>(target_id.data()), 20));
 
-                // If this is a response message ("y": "r"), parse out the nodes.
-                if (response_dict.at("y").asString() == "r") {
-                    auto& nodes_str = response_dict.at("r").asDict().at("nodes").asString();
-                    parse_compact_nodes(nodes_str, nodes);
-                }
-            } catch (const std::exception& e) {
-                std::cerr << "Error parsing response: " << e.what() << '\n';
-            }
-        } else {
+        QueryResult result = send_query_blocking(remote_node, "find_node", std::move(query));
+        if (!result.ok()) {
             std::cerr << "No response received!" << '\n';
+            return nodes;
         }
 
-        CLOSESOCKET(sock);
+        std::cout << "Received response from " << result.ip << ":" << result.port << '\n';
+
+        try {
+            auto& nodes_str = result.message.asDict().at("r").asDict().at("nodes").asString();
+            parse_compact_nodes(nodes_str, nodes);
+        } catch (const std::exception& e) {
+            std::cerr << "Error parsing response: " << e.what() << '\n';
+        }
         return nodes;
     }
 
@@ -318,123 +1008,162 @@ namespace DHT {
             std::memcpy(&ip_binary, entry + 20, 4);
             char ip_str[INET_ADDRSTRLEN];
             inet_ntop(AF_INET, &ip_binary, ip_str, sizeof(ip_str));
-            node.ip = ip_str;
+            node.ip = ip_str;
+
+            // Parse port (2 bytes)
+            uint16_t port;
+            std::memcpy(&port, entry + 24, 2);
+            node.port = ntohs(port);
+
+            nodes.push_back(node);
+        }
+    }
+
+    /**
+     * @brief Parse compact peer info (6 bytes: IPv4 + port) into nodes without IDs.
+     *
+     * @param compact The compact string; trailing partial entries are ignored.
+     * @param peers   Output vector to which the peers are appended.
+     */
+    void DHTBootstrap::parse_compact_peers(const std::string& compact, std::vector<Node>& peers) {
+        const char* data = compact.data();
+        size_t num_peers = compact.size() / 6;
+
+        for (size_t i = 0; i < num_peers; ++i) {
+            Node peer{};
+            const char* entry = data + i * 6;
+
+            uint32_t ip_binary;
+            std::memcpy(&ip_binary, entry, 4);
+            char ip_str[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &ip_binary, ip_str, sizeof(ip_str));
+            peer.ip = ip_str;
 
-            // Parse port (2 bytes)
             uint16_t port;
-            std::memcpy(&port, entry + 24, 2);
-            node.port = ntohs(port);
+            std::memcpy(&port, entry + 4, 2);
+            peer.port = ntohs(port);
 
-            nodes.push_back(node);
+            peers.push_back(peer);
         }
     }
 
     /**
-     * @brief Add a node to the routing table. If the corresponding bucket is full,
-     *        use the Kademlia eviction rule (ping the oldest node, replace if dead).
+     * @brief Record a node in the shared contact pool and offer it to the routing
+     *        view of every hosted identity.
      *
      * @param node The node to add.
      */
     void DHTBootstrap::add_to_routing_table(const Node& node) {
-        NodeID distance = xor_distance(my_node_id_, node.id);
-        size_t bucket_index = 0;
+        {
+            std::unique_lock<std::shared_mutex> lock(contacts_mutex_);
+            contacts_.insert(node);
+        }
+        shared_contacts_.publish(node);
+
+        insert_with_eviction(routing_table_, node);
 
-        // Find the appropriate bucket index based on XOR distance bits
-        while (bucket_index < routing_table_.size() && 
-               (distance[bucket_index / 8] & (1 << (bucket_index % 8)))) {
-            bucket_index++;
+        std::vector<RoutingTable*> tables;
+        {
+            std::lock_guard<std::mutex> lock(identities_mutex_);
+            for (auto& table : virtual_identities_) {
+                tables.push_back(table.get());
+            }
+        }
+        for (RoutingTable* table : tables) {
+            insert_with_eviction(*table, node);
         }
+    }
 
-        // If the bucket doesn't exist, create it
-        if (bucket_index >= routing_table_.size()) {
-            routing_table_.emplace_back();
+    /**
+     * @brief Pull recently seen contacts from the shared-memory table into the
+     *        contact pool and every identity's routing view. Only free bucket
+     *        slots are filled; nobody is pinged.
+     *
+     * @return The number of contacts read from the shared table.
+     */
+    size_t DHTBootstrap::import_shared_contacts() {
+        std::vector<Node> nodes = shared_contacts_.snapshot(config_.shared_contacts_max_age);
+
+        std::vector<RoutingTable*> tables{&routing_table_};
+        {
+            std::lock_guard<std::mutex> lock(identities_mutex_);
+            for (auto& table : virtual_identities_) {
+                tables.push_back(table.get());
+            }
         }
 
-        auto& bucket = routing_table_[bucket_index];
-        // Check if the node is already in the bucket
-        auto it = std::find(bucket.begin(), bucket.end(), node);
-        if (it != bucket.end()) {
-            // Move node to the back (most recently seen)
-            std::rotate(it, it + 1, bucket.end());
-            return;
+        std::unique_lock<std::shared_mutex> lock(contacts_mutex_);
+        for (const auto& node : nodes) {
+            contacts_.insert(node);
+            for (RoutingTable* table : tables) {
+                if (table->insert(node) == RoutingTable::InsertResult::Added) {
+                    contacts_.pin(node.id);
+                }
+            }
         }
+        return nodes.size();
+    }
 
-        // If the bucket has space, add the node
-        if (bucket.size() < K) {
-            bucket.push_back(node);
+    /**
+     * @brief Add a node to one routing table. If the corresponding bucket is full,
+     *        use the Kademlia eviction rule (ping the oldest node, replace if dead).
+     *        The ping is asynchronous, so neither the table nor the receive loop is
+     *        ever blocked on the network. Routing table members are pinned in the
+     *        contact trie so they are never evicted from it.
+     *
+     * @param table The routing view to update.
+     * @param node  The node to add.
+     */
+    void DHTBootstrap::insert_with_eviction(RoutingTable& table, const Node& node) {
+        Node oldest_node;
+        RoutingTable::InsertResult result = table.insert(node, &oldest_node);
+        if (result == RoutingTable::InsertResult::Added) {
+            std::unique_lock<std::shared_mutex> lock(contacts_mutex_);
+            contacts_.pin(node.id);
+        }
+        if (result != RoutingTable::InsertResult::BucketFull) {
+            return;
+        }
+        // With the socket backed up, keep the incumbent rather than queue a ping
+        if (send_backlogged()) {
             return;
         }
 
         // Kademlia eviction rule: Ping the oldest node
-        Node& oldest_node = bucket.front();
-        if (ping(oldest_node)) {
-            // If the oldest node responds, move it to the back
-            std::rotate(bucket.begin(), bucket.begin() + 1, bucket.end());
-        } else {
-            // If the oldest node is unresponsive, replace it
-            bucket.front() = node;
-        }
+        ping(oldest_node, [this, &table, oldest_node, node](bool alive) {
+            if (alive) {
+                // If the oldest node responds, move it to the back
+                table.touch(oldest_node);
+            } else if (table.replace(oldest_node, node)) {
+                // If the oldest node is unresponsive, replace it
+                std::unique_lock<std::shared_mutex> lock(contacts_mutex_);
+                contacts_.unpin(oldest_node.id);
+                contacts_.pin(node.id);
+            }
+        });
+    }
+
+    /**
+     * @brief Ping a node to check if it's alive, without blocking.
+     *
+     * @param node The node to ping.
+     * @param done Invoked with true if the node answered before the timeout.
+     */
+    void DHTBootstrap::ping(const Node& node, std::function<void(bool)> done) {
+        send_query(node, "ping", BencodedDict{}, [done = std::move(done)](const QueryResult& result) {
+            done(result.ok());
+        });
     }
 
     /**
-     * @brief Ping a node to check if it's alive (simple UDP send + receive).
+     * @brief Ping a node and block until it answers or times out.
      *
      * @param node The node to ping.
      *
      * @return True if the node responded, false otherwise.
      */
     bool DHTBootstrap::ping(const Node& node) {
-        // Create a UDP socket
-        int sock = socket(AF_INET, SOCK_DGRAM, 0);
-        if (sock < 0) {
-            std::cerr << "Error creating socket!" << '\n';
-            return false;
-        }
-
-        // Set up the target node's address
-        sockaddr_in node_addr{};
-        node_addr.sin_family = AF_INET;
-        node_addr.sin_port = htons(node.port);
-        inet_pton(AF_INET, node.ip.c_str(), &node_addr.sin_addr);
-
-        // Ping message
-        // std::string ping_msg = "PING";
-        // Create a valid DHT PING query
-        BencodedDict query;
-        query["id"] = BencodedValue(std::string(reinterpret_cast<const char*>(my_node_id_.data()), 20));
-
-        BencodedDict message;
-        message["t"] = BencodedValue("pp"); // Transaction ID
-        message["y"] = BencodedValue("q");  // Query
-        message["q"] = BencodedValue("ping");
-        message["a"] = BencodedValue(query);
-
-        std::string ping_msg = BencodeEncoder::encode(message);
-
-        // Send the PING message
-        sendto(sock, ping_msg.c_str(), ping_msg.size(), 0,
-               (struct sockaddr*)&node_addr, sizeof(node_addr));
-
-        // Set socket timeout (2 seconds)
-#ifdef _WIN32
-        DWORD timeout = 2000; // 2000 ms
-        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
-#else
-        struct timeval timeout{};
-        timeout.tv_sec = 2;
-        timeout.tv_usec = 0;
-        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
-#endif
-
-        // Receive the PONG response
-        char buffer[1024];
-        sockaddr_in sender_addr{};
-        socklen_t sender_len = sizeof(sender_addr);
-        int bytes_received = recvfrom(sock, buffer, sizeof(buffer) - 1, 0,
-                                      (struct sockaddr*)&sender_addr, &sender_len);
-
-        CLOSESOCKET(sock);
-        return (bytes_received > 0); // If data received, the node is alive
+        return send_query_blocking(node, "ping", BencodedDict{}).ok();
     }
 
     /**
@@ -449,22 +1178,22 @@ namespace DHT {
             std::string transaction_id = request.asDict().at("t").asString();
 
             // Create the pong response
+            NodeID responder_id = identity_for(sender_addr);
             BencodedDict response;
             response["t"] = BencodedValue(transaction_id); // Same transaction ID
             response["y"] = BencodedValue("r");            // Response type
             response["r"] = BencodedValue(BencodedDict{
-                {"id", BencodedValue(std::string(reinterpret_cast<const char*>(my_node_id_.data()), 20))}
+                {"id", BencodedValue(std::string(reinterpret_cast<const char*>(responder_id.data()), 20))}
             });
 
             // Encode and send response
-            std::string response_str = BencodeEncoder::encode(response);
-            sendto(sock_, response_str.c_str(), response_str.size(), 0,
-                   reinterpret_cast<const sockaddr*>(&sender_addr), sizeof(sender_addr));
-
-            std::cout << "Sent PONG response to: "
-                      << inet_ntoa(sender_addr.sin_addr) << ":" 
-                      << ntohs(sender_addr.sin_port) << '\n';
-            std::cout << "PONG RESPONSE: \n" << response_str << '\n';
+            send_message(response, sender_addr);
+
+            if (config_.log_packets) {
+                std::cout << "Sent PONG response to: "
+                          << ip_string(sender_addr.sin_addr) << ":" 
+                          << ntohs(sender_addr.sin_port) << '\n';
+            }
         } catch (const std::exception& e) {
             std::cerr << "Error handling ping request: " << e.what() << '\n';
         }
@@ -503,32 +1232,34 @@ namespace DHT {
 
             // Find the K closest nodes
             std::vector<Node> closest_nodes = find_closest_nodes(target_id, K);
+            NodeID responder_id = identity_for(sender_addr);
 
             // Create the response
             BencodedDict response;
             response["t"] = BencodedValue(transaction_id);  // Same transaction ID
             response["y"] = BencodedValue("r");             // Response type
             response["r"] = BencodedValue(BencodedDict{
-                {"id",    BencodedValue(std::string(reinterpret_cast<const char*>(my_node_id_.data()), 20))},
+                {"id",    BencodedValue(std::string(reinterpret_cast<const char*>(responder_id.data()), 20))},
                 {"nodes", BencodedValue(encode_nodes(closest_nodes))}
             });
 
             // Encode and send response
-            std::string response_str = BencodeEncoder::encode(response);
-            sendto(sock_, response_str.c_str(), response_str.size(), 0,
-                   reinterpret_cast<const sockaddr*>(&sender_addr), sizeof(sender_addr));
-
-            std::cout << "************Sent FIND_NODE response to: "
-                      << inet_ntoa(sender_addr.sin_addr) << ":" << ntohs(sender_addr.sin_port) 
-                      << '\n'
-                      << "Response sent: " << response_str << '\n';
+            send_message(response, sender_addr);
+
+            if (config_.log_packets) {
+                std::cout << "************Sent FIND_NODE response to: "
+                          << ip_string(sender_addr.sin_addr) << ":" << ntohs(sender_addr.sin_port) 
+                          << '\n';
+            }
         } catch (const std::exception& e) {
             std::cerr << "Error handling find_node request: " << e.what() << '\n';
         }
     }
 
     /**
-     * @brief Find the K closest nodes in the routing table to a given target ID.
+     * @brief Find the K closest known nodes to a given target ID. Served from the
+     *        contact trie, which covers every identity's routing table plus
+     *        recently seen contacts, in O(log n + k).
      *
      * @param target_id The NodeID we want to find.
      * @param k         The maximum number of closest nodes to return.
@@ -536,25 +1267,8 @@ namespace DHT {
      * @return A vector of up to K closest Node objects.
      */
     std::vector<Node> DHTBootstrap::find_closest_nodes(const NodeID& target_id, size_t k) {
-        std::vector<Node> closest_nodes;
-
-        // Gather all nodes from all buckets
-        for (const auto& bucket : routing_table_) {
-            for (const auto& node : bucket) {
-                closest_nodes.push_back(node);
-            }
-        }
-
-        // Sort nodes by XOR distance to the target ID
-        std::sort(closest_nodes.begin(), closest_nodes.end(), [&](const Node& a, const Node& b) {
-            return xor_distance(a.id, target_id) < xor_distance(b.id, target_id);
-        });
-
-        // Return the K closest
-        if (closest_nodes.size() > k) {
-            closest_nodes.resize(k);
-        }
-        return closest_nodes;
+        std::shared_lock<std::shared_mutex> lock(contacts_mutex_);
+        return contacts_.closest(target_id, k);
     }
 
     /**
@@ -606,7 +1320,8 @@ namespace DHT {
 
     /**
      * @brief Handle an incoming "get_peers" query. If we know peers for the given infohash,
-     *        return them; otherwise, return the K closest nodes.
+     *        return them; otherwise, return the K closest nodes. Either way the reply
+     *        carries a token the requester needs to announce to us.
      *
      * @param request     The parsed Bencoded request.
      * @param sender_addr The sockaddr of the sender (to reply).
@@ -619,54 +1334,111 @@ namespace DHT {
             // Extract infohash
             std::string infohash = request.asDict().at("a").asDict().at("info_hash").asString();
 
-            // Check if peers are available for the infohash
-            auto it = peer_store_.find(infohash);
-            if (it != peer_store_.end()) {
-                // We have peers for this infohash
-                BencodedDict response;
-                response["t"] = BencodedValue(transaction_id); // Same transaction ID
-                response["y"] = BencodedValue("r");            // Response type
-                response["r"] = BencodedValue(BencodedDict{
-                    {"id",     BencodedValue(std::string(reinterpret_cast<const char*>(my_node_id_.data()), 20))},
-                    {"values", BencodedValue(encode_peers(it->second))}
-                });
+            NodeID target_id = string_to_node_id(infohash);
+            NodeID responder_id = identity_for(sender_addr);
 
-                std::string response_str = BencodeEncoder::encode(response);
-                sendto(sock_, response_str.c_str(), response_str.size(), 0,
-                       reinterpret_cast<const sockaddr*>(&sender_addr), sizeof(sender_addr));
+            BencodedDict r{
+                {"id",    BencodedValue(std::string(reinterpret_cast<const char*>(responder_id.data()), 20))},
+                {"token", BencodedValue(make_token(sender_addr))}
+            };
 
-                std::cout << "Sent GET_PEERS response (peers) to: "
-                          << inet_ntoa(sender_addr.sin_addr) << ":" 
-                          << ntohs(sender_addr.sin_port) << '\n';
+            // Check if peers are available for the infohash
+            BencodedList values;
+            {
+                std::shared_lock<std::shared_mutex> lock(peer_store_mutex_);
+                auto it = peer_store_.find(infohash);
+                if (it != peer_store_.end()) {
+                    // BEP 5: a list of compact peer strings, one per peer
+                    for (const auto& peer : it->second) {
+                        values.push_back(BencodedValue(encode_peers({peer})));
+                    }
+                }
+            }
+            bool have_peers = !values.empty();
+            if (have_peers) {
+                r["values"] = BencodedValue(std::move(values));
             } else {
                 // Return the K closest nodes
-                NodeID target_id;
-                std::memcpy(target_id.data(), infohash.data(), NODE_ID_SIZE);
-
-                std::vector<Node> closest_nodes = find_closest_nodes(target_id, K);
+                r["nodes"] = BencodedValue(encode_nodes(find_closest_nodes(target_id, K)));
+            }
 
-                BencodedDict response;
-                response["t"] = BencodedValue(transaction_id); // Same transaction ID
-                response["y"] = BencodedValue("r");            // Response type
-                response["r"] = BencodedValue(BencodedDict{
-                    {"id",    BencodedValue(std::string(reinterpret_cast<const char*>(my_node_id_.data()), 20))},
-                    {"nodes", BencodedValue(encode_nodes(closest_nodes))}
-                });
+            BencodedDict response;
+            response["t"] = BencodedValue(transaction_id); // Same transaction ID
+            response["y"] = BencodedValue("r");            // Response type
+            response["r"] = BencodedValue(std::move(r));
 
-                std::string response_str = BencodeEncoder::encode(response);
-                sendto(sock_, response_str.c_str(), response_str.size(), 0,
-                       reinterpret_cast<const sockaddr*>(&sender_addr), sizeof(sender_addr));
+            send_message(response, sender_addr);
 
-                std::cout << "Sent GET_PEERS response (nodes) to: "
-                          << inet_ntoa(sender_addr.sin_addr) << ":" 
+            if (config_.log_packets) {
+                std::cout << "Sent GET_PEERS response (" << (have_peers ? "peers" : "nodes") << ") to: "
+                          << ip_string(sender_addr.sin_addr) << ":"
                           << ntohs(sender_addr.sin_port) << '\n';
-                std::cout << "RESPONSE STRING - GET PEERS:\n" << response_str << '\n';
             }
         } catch (const std::exception& e) {
             std::cerr << "Error handling get_peers request: " << e.what() << '\n';
         }
     }
 
+    /**
+     * @brief Replace the previous token secret with the current one and draw a
+     *        new current secret. Requires token_mutex_.
+     */
+    void DHTBootstrap::rotate_token_secrets() {
+        static thread_local std::mt19937_64 rng(std::random_device{}());
+        token_secrets_[1] = token_secrets_[0];
+        token_secrets_[0] = TokenSecret{rng(), rng()};
+        token_rotated_ = std::chrono::steady_clock::now();
+    }
+
+    /**
+     * @brief Token handed out with get_peers replies: a keyed hash of the
+     *        requester's IP under the current secret.
+     *
+     * @param addr The requester's address.
+     *
+     * @return An 8-byte opaque token.
+     */
+    std::string DHTBootstrap::make_token(const sockaddr_in& addr) {
+        TokenSecret secret;
+        {
+            std::lock_guard<std::mutex> lock(token_mutex_);
+            if (std::chrono::steady_clock::now() - token_rotated_ >= TOKEN_ROTATION) {
+                rotate_token_secrets();
+            }
+            secret = token_secrets_[0];
+        }
+        uint64_t tag = siphash24(secret.k0, secret.k1,
+                                 reinterpret_cast<const uint8_t*>(&addr.sin_addr), sizeof(addr.sin_addr));
+        return std::string(reinterpret_cast<const char*>(&tag), sizeof(tag));
+    }
+
+    /**
+     * @brief Whether a token presented with announce_peer was issued to this IP
+     *        under the current or the previous secret.
+     */
+    bool DHTBootstrap::valid_token(const std::string& token, const sockaddr_in& addr) {
+        if (token.size() != sizeof(uint64_t)) {
+            return false;
+        }
+        TokenSecret secrets[2];
+        {
+            std::lock_guard<std::mutex> lock(token_mutex_);
+            if (std::chrono::steady_clock::now() - token_rotated_ >= TOKEN_ROTATION) {
+                rotate_token_secrets();
+            }
+            secrets[0] = token_secrets_[0];
+            secrets[1] = token_secrets_[1];
+        }
+        for (const auto& secret : secrets) {
+            uint64_t tag = siphash24(secret.k0, secret.k1,
+                                     reinterpret_cast<const uint8_t*>(&addr.sin_addr), sizeof(addr.sin_addr));
+            if (std::memcmp(token.data(), &tag, sizeof(tag)) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     /**
      * @brief Convert a std::string of length 20 into a NodeID (20-byte array).
      *
@@ -684,45 +1456,81 @@ namespace DHT {
     }
 
     /**
-     * @brief Handle an incoming "announce_peer" query. Store the announcing peer
-     *        in the peer_store_ under the given infohash.
+     * @brief Handle an incoming "announce_peer" query. If the token is one we
+     *        issued to the sender's IP, store the announcing peer in the
+     *        peer_store_ under the given infohash; otherwise reply with error 203.
      *
      * @param request     The parsed Bencoded request.
      * @param sender_addr The sockaddr of the sender (to reply).
      */
     void DHTBootstrap::handle_announce_peer(const BencodedValue& request, const sockaddr_in& sender_addr) {
         try {
+            const auto& args = request.asDict().at("a").asDict();
+
             // Extract infohash
-            std::string infohash = request.asDict().at("a").asDict().at("info_hash").asString();
+            std::string infohash = args.at("info_hash").asString();
+            string_to_node_id(infohash); // Validates the length
+
+            BencodedDict response;
+            response["t"] = BencodedValue(request.asDict().at("t").asString()); // Same transaction ID
+
+            auto token_it = args.find("token");
+            if (token_it == args.end() || !valid_token(token_it->second.asString(), sender_addr)) {
+                response["y"] = BencodedValue("e");
+                response["e"] = BencodedValue(BencodedList{BencodedValue(int64_t(203)),
+                                                           BencodedValue(std::string("Bad token"))});
+
+                send_message(response, sender_addr);
+
+                std::cerr << "Rejected ANNOUNCE_PEER with bad token from: "
+                          << ip_string(sender_addr.sin_addr) << ":"
+                          << ntohs(sender_addr.sin_port) << '\n';
+                return;
+            }
 
-            // Build Node struct for the peer
-            Node peer;
-            peer.ip   = inet_ntoa(sender_addr.sin_addr);
+            // Build Node struct for the peer; implied_port means "use my source port"
+            Node peer{};
+            peer.ip   = ip_string(sender_addr.sin_addr);
             peer.port = ntohs(sender_addr.sin_port);
+            auto implied_it = args.find("implied_port");
+            bool implied = implied_it != args.end() && implied_it->second.isInt() && implied_it->second.asInt() != 0;
+            if (!implied) {
+                peer.port = static_cast<uint16_t>(args.at("port").asInt());
+            }
 
-            // Store the peer information
-            peer_store_[infohash].push_back(peer);
+            // Store the peer information (re-announcing is not a new peer)
+            {
+                std::unique_lock<std::shared_mutex> lock(peer_store_mutex_);
+                auto& peers = peer_store_[infohash];
+                bool known = std::any_of(peers.begin(), peers.end(), [&](const Node& p) {
+                    return p.ip == peer.ip && p.port == peer.port;
+                });
+                if (!known) {
+                    peers.push_back(peer);
+                }
+            }
 
             // Log the announcement
-            std::cout << "Stored peer " << peer.ip << ":" << peer.port
-                      << " for infohash "
-                      << node_id_to_hex(string_to_node_id(infohash)) << '\n';
+            if (config_.log_packets) {
+                std::cout << "Stored peer " << peer.ip << ":" << peer.port
+                          << " for infohash "
+                          << node_id_to_hex(string_to_node_id(infohash)) << '\n';
+            }
 
             // Send a response
-            BencodedDict response;
-            response["t"] = BencodedValue(request.asDict().at("t").asString()); // Same transaction ID
+            NodeID responder_id = identity_for(sender_addr);
             response["y"] = BencodedValue("r");                                // Response type
             response["r"] = BencodedValue(BencodedDict{
-                {"id", BencodedValue(std::string(reinterpret_cast<const char*>(my_node_id_.data()), 20))}
+                {"id", BencodedValue(std::string(reinterpret_cast<const char*>(responder_id.data()), 20))}
             });
 
-            std::string response_str = BencodeEncoder::encode(response);
-            sendto(sock_, response_str.c_str(), response_str.size(), 0,
-                   reinterpret_cast<const sockaddr*>(&sender_addr), sizeof(sender_addr));
+            send_message(response, sender_addr);
 
-            std::cout << "Sent ANNOUNCE_PEER response to: "
-                      << inet_ntoa(sender_addr.sin_addr) << ":"
-                      << ntohs(sender_addr.sin_port) << '\n';
+            if (config_.log_packets) {
+                std::cout << "Sent ANNOUNCE_PEER response to: "
+                          << ip_string(sender_addr.sin_addr) << ":"
+                          << ntohs(sender_addr.sin_port) << '\n';
+            }
         } catch (const std::exception& e) {
             std::cerr << "Error handling announce_peer request: " << e.what() << '\n';
         }
@@ -731,80 +1539,487 @@ namespace DHT {
     /**
      * @brief Main loop that listens for incoming DHT messages and dispatches them
      *        to the appropriate handler functions (ping, find_node, get_peers, announce_peer).
+     *        If worker CPUs are configured, the calling thread is pinned to the first
+     *        one, the socket's packets are steered to it and packet buffers are
+     *        allocated on its NUMA node, so a packet never crosses sockets.
+     *        With socket_shards > 1, extra sockets share the port for as long
+     *        as run() is active (see start_shards()). Returns once stop() is
+     *        called.
      */
     void DHTBootstrap::run() {
-        char buffer[1024];
+        std::lock_guard<std::recursive_mutex> lock(pump_mutex_);
+
+        if (!config_.worker_cpus.empty()) {
+            int cpu = config_.worker_cpus.front();
+            if (!pin_current_thread(cpu)) {
+                std::cerr << "[DHT] Failed to pin worker to CPU " << cpu << '\n';
+            }
+            if (!set_incoming_cpu(sock_, cpu)) {
+                std::cerr << "[DHT] Failed to set SO_INCOMING_CPU " << cpu << '\n';
+            }
+            if (uring_.is_open() &&
+                !uring_.open(sock_, loop_->wake_fd(), URING_BUFFERS, config_.packet_size, numa_node_of_cpu(cpu))) {
+                std::cerr << "[DHT] Failed to reopen io_uring on CPU " << cpu << "; falling back to epoll" << '\n';
+            }
+        }
+        start_shards();
+        start_pipeline();
+
+        while (!stopping_.load()) {
+            run_once(std::chrono::milliseconds(IDLE_WAIT_MS));
+        }
+        stop_pipeline();
+        stop_shards();
+        stopping_.store(false);
+    }
+
+    /**
+     * @brief Put pipeline_workers parse/handle stages and a send stage
+     *        behind the primary socket. This thread stays the receive
+     *        stage: receive_datagrams() hands each packet to a worker
+     *        instead of dispatching it. Stages are pinned to the
+     *        worker_cpus after those of run() and the shards. Requires
+     *        pump_mutex_.
+     */
+    void DHTBootstrap::start_pipeline() {
+        if (config_.pipeline_workers == 0) {
+            return;
+        }
+        auto pipeline = std::make_unique<Pipeline>(sock_, config_.pipeline_workers, config_.pipeline_ring_capacity,
+                                                   SEND_BATCH, config_.packet_size, config_.packet_pool_capacity);
+        size_t first = std::max<size_t>(config_.socket_shards, 1);
+        std::vector<int> cpus;
+        for (size_t i = first; i < config_.worker_cpus.size(); ++i) {
+            cpus.push_back(config_.worker_cpus[i]);
+        }
+        pipeline->start(cpus, [this](const char* data, size_t length, const sockaddr_in& sender) {
+            dispatch(data, length, sender);
+        });
+        std::lock_guard<std::mutex> lock(pipeline_mutex_);
+        pipeline_ = std::move(pipeline);
+    }
+
+    /**
+     * @brief Join the pipeline stages; datagrams still between stages are
+     *        dropped. Requires pump_mutex_.
+     */
+    void DHTBootstrap::stop_pipeline() {
+        std::unique_ptr<Pipeline> pipeline;
+        {
+            std::lock_guard<std::mutex> lock(pipeline_mutex_);
+            pipeline = std::move(pipeline_);
+        }
+        if (pipeline) {
+            pipeline->stop();
+        }
+    }
+
+    /**
+     * @brief Open socket_shards - 1 more sockets on the DHT port, each served
+     *        by a worker pinned to the next entry of worker_cpus. The kernel
+     *        spreads incoming flows over all of them; queries are answered on
+     *        the worker that received them. Requires pump_mutex_.
+     */
+    void DHTBootstrap::start_shards() {
+        for (size_t i = 1; i < config_.socket_shards; ++i) {
+            auto shard = std::make_unique<SocketShard>(RECEIVE_BATCH, config_.packet_size,
+                                                       config_.packet_pool_capacity, MAX_QUEUED_SENDS);
+            if (!shard->open(config_.port)) {
+                std::cerr << "[DHT] Running with " << i << " of " << config_.socket_shards << " sockets" << '\n';
+                break;
+            }
+            int cpu = i < config_.worker_cpus.size() ? config_.worker_cpus[i] : -1;
+            shard->start(cpu, [this](const char* data, size_t length, const sockaddr_in& sender) {
+                dispatch(data, length, sender);
+            });
+            std::lock_guard<std::mutex> lock(shards_mutex_);
+            shards_.push_back(std::move(shard));
+        }
+    }
+
+    /**
+     * @brief Stop the shard workers and close their sockets, leaving the
+     *        primary socket as the only one on the port. Requires pump_mutex_.
+     */
+    void DHTBootstrap::stop_shards() {
+        for (auto& shard : shards_) {
+            shard->stop();
+        }
+        std::lock_guard<std::mutex> lock(shards_mutex_);
+        shards_.clear();
+    }
+
+    /**
+     * @brief Make run() return after the iteration in progress. Callable from
+     *        any thread, including callbacks running inside the loop.
+     */
+    void DHTBootstrap::stop() {
+        stopping_.store(true);
+        loop_->wake();
+    }
+
+    /**
+     * @brief One event-loop iteration: wait until the socket is readable, a
+     *        timer or query deadline is due, or the timeout passes; then drain
+     *        the socket, flush queued sends, time out overdue queries and fire
+     *        due timers. For embedding in another loop instead of run().
+     *
+     * @param timeout Longest time to block (0 only handles what is ready).
+     *
+     * @return Datagrams received plus timers and queries expired.
+     */
+    size_t DHTBootstrap::run_once(std::chrono::milliseconds timeout) {
+        std::lock_guard<std::recursive_mutex> lock(pump_mutex_);
+        PumpingScope pumping(this);
+        using Clock = TimerQueue::Clock;
+
+        // Publish the wait deadline before reading the queues: anything
+        // scheduled after that sees it and wakes us if it is due sooner
+        Clock::time_point now = Clock::now();
+        Clock::time_point deadline = now + std::min(timeout, std::chrono::milliseconds(INT32_MAX));
+        wait_until_.store(deadline.time_since_epoch().count());
+        deadline = std::min({deadline, timers_.next_due(), transactions_.next_deadline()});
+
+        bool want_write = send_backlogged_.load();
+        auto wait = std::chrono::ceil<std::chrono::milliseconds>(std::max(deadline - now, Clock::duration(0)));
+        if (uring_.is_open()) {
+            return run_uring(wait);
+        }
+        EventLoop::Ready ready = loop_->wait(wait, want_write);
+        wait_until_.store(Clock::time_point::min().time_since_epoch().count());
+
+        size_t handled = 0;
+        if (ready.readable) {
+            handled += receive_datagrams();
+        }
+        handled += transactions_.expire(Clock::now());
+        handled += timers_.run_due(Clock::now());
+        flush_send_queue();
+        return handled;
+    }
+
+    /**
+     * @brief The rest of run_once() on io_uring: submit queued sends and wait
+     *        in one io_uring_enter(), dispatch what arrived, expire queries
+     *        and run timers, then submit everything they sent at once.
+     *        Requires pump_mutex_.
+     *
+     * @param timeout Longest time to block.
+     *
+     * @return Datagrams received plus timers and queries expired.
+     */
+    size_t DHTBootstrap::run_uring(std::chrono::milliseconds timeout) {
+        using Clock = TimerQueue::Clock;
+        queue_uring_sends();
+
+        size_t handled = uring_.wait(timeout, [&](const char* data, size_t length, const sockaddr_in& sender) {
+            dispatch(data, length, sender);
+        });
+        wait_until_.store(Clock::time_point::min().time_since_epoch().count());
+        handled += transactions_.expire(Clock::now());
+        handled += timers_.run_due(Clock::now());
+
+        // Everything the handlers and timers sent goes in one submission
+        queue_uring_sends();
+        uring_.submit();
+        return handled;
+    }
+
+    /**
+     * @brief Read up to RECEIVE_BATCH waiting datagrams in one recvmmsg() and
+     *        dispatch them. Replies and queries sent meanwhile wait in the
+     *        send queue and go out together in flush_send_queue() afterwards.
+     *        Requires pump_mutex_.
+     *
+     * @return Datagrams dispatched.
+     */
+    size_t DHTBootstrap::receive_datagrams() {
+        // A handler that blocks pumps the socket again; the ring still holds
+        // the rest of this batch, so nested reads go one at a time
+        if (receive_depth_ > 0) {
+            return receive_one();
+        }
+
+        int count = receive_ring_->receive(sock_);
+        if (count < 0) {
+            if (!would_block()) {
+#ifdef _WIN32
+                int wsa_error = WSAGetLastError();
+                std::cerr << "recvmmsg failed! WSA Error Code: " << wsa_error << '\n';
+#else
+                std::cerr << "recvmmsg failed! errno: " << strerror(errno) << '\n';
+#endif
+            }
+            return 0;
+        }
+
+        if (pipeline_) {
+            for (int i = 0; i < count; ++i) {
+                pipeline_->submit(receive_ring_->take(i), receive_ring_->sender(i));
+            }
+            return static_cast<size_t>(count);
+        }
+
+        receive_depth_++;
+        for (int i = 0; i < count; ++i) {
+            dispatch(receive_ring_->data(i), receive_ring_->length(i), receive_ring_->sender(i));
+        }
+        receive_depth_--;
+        flush_send_queue();
+        return static_cast<size_t>(count);
+    }
+
+    /**
+     * @brief Read and dispatch at most one datagram, outside the receive
+     *        ring. Requires pump_mutex_.
+     *
+     * @return Datagrams dispatched (0 or 1).
+     */
+    size_t DHTBootstrap::receive_one() {
+        Packet packet = packet_pool_.acquire();
         sockaddr_in sender_addr{};
-        socklen_t sender_len = sizeof(sender_addr);
-        
-        while (true) {
-            // Receive a message
-            int bytes_received = recvfrom(sock_, buffer, sizeof(buffer), 0,
-                                          reinterpret_cast<sockaddr*>(&sender_addr), &sender_len);
-            if (bytes_received < 0) {
+        int bytes_received = receive_ring_->receive_one(sock_, packet, sender_addr);
+        if (bytes_received < 0) {
+            if (!would_block()) {
 #ifdef _WIN32
                 int wsa_error = WSAGetLastError();
                 std::cerr << "recvfrom failed! WSA Error Code: " << wsa_error << '\n';
 #else
                 std::cerr << "recvfrom failed! errno: " << strerror(errno) << '\n';
 #endif
-                continue;
             }
+            return 0;
+        }
+        dispatch(packet.data(), bytes_received, sender_addr);
+        flush_send_queue();
+        return 1;
+    }
 
-            std::cout << "[DHT] Received " << bytes_received << " bytes from "
-                      << inet_ntoa(sender_addr.sin_addr) << ":"
-                      << ntohs(sender_addr.sin_port) << '\n';
-
-            // Log raw message in hex format
-            std::cout << "[DHT] Raw Data: ";
-            for (int i = 0; i < bytes_received; i++) {
-                printf("%02x ", (unsigned char)buffer[i]);
-            }
-            std::cout << '\n';
+    /**
+     * @brief Encode a KRPC message straight into a pooled packet (the
+     *        calling worker's own pool on a shard or pipeline worker) and
+     *        send it.
+     *
+     * @param message The message to encode.
+     * @param addr    The destination.
+     *
+     * @return False if the send failed outright.
+     */
+    bool DHTBootstrap::send_message(const BencodedValue& message, const sockaddr_in& addr) {
+        SocketShard* shard = SocketShard::current();
+        Pipeline* pipeline = Pipeline::current();
+        PacketPool& pool = shard != nullptr    ? shard->packet_pool()
+                           : pipeline != nullptr ? pipeline->packet_pool()
+                                                 : packet_pool_;
+        Packet packet = pool.acquire();
+        size_t length = BencodeEncoder::encode(message, packet.data(), packet.capacity());
+        if (length > packet.capacity()) {
+            packet = pool.acquire(length);
+            BencodeEncoder::encode(message, packet.data(), packet.capacity());
+        }
+        packet.resize(length);
+        return send_datagram(std::move(packet), addr);
+    }
 
-            // Parse the message
-            try {
-                BencodeParser parser;
-                std::string message_str(buffer, bytes_received);
-                BencodedValue message = parser.parse(message_str);
+    /**
+     * @brief Queue a datagram for the thread pumping the socket, which sends
+     *        the queue in sendmmsg() batches after each receive batch and
+     *        loop iteration. Lock-free and thread-safe; a sender that is not
+     *        the pumping thread wakes the loop (once per flush).
+     *
+     * @param data The encoded message.
+     * @param addr The destination.
+     *
+     * @return False if the queue is full (the socket has been backed up for
+     *         a while, see send_backlogged()); the datagram is dropped.
+     */
+    bool DHTBootstrap::send_datagram(Packet data, const sockaddr_in& addr) {
+        // Replies from a shard worker leave through the socket that received the query
+        if (SocketShard* shard = SocketShard::current()) {
+            return shard->send(std::move(data), addr);
+        }
+        // Replies from a pipeline worker go through its send stage
+        if (Pipeline* pipeline = Pipeline::current()) {
+            return pipeline->send(std::move(data), addr);
+        }
 
-                std::cout << "[DHT] Parsed Message: " << message_str << '\n';
+        Datagram datagram{std::move(data), addr};
+        if (!send_queue_.push(datagram)) {
+            std::cerr << "[DHT] Send queue full; dropping datagram" << '\n';
+            return false;
+        }
+        if (pumping_instance != this && !send_wake_pending_.exchange(true)) {
+            loop_->wake();
+        }
+        return true;
+    }
 
-                // Extract the message type
-                std::string message_type = message.asDict().at("y").asString();
+    /**
+     * @brief Whether the socket buffer was full at the last flush. Queued
+     *        sends are waiting for it to drain; senders that can wait (e.g.
+     *        maintenance pings) should hold off. Thread-safe.
+     */
+    bool DHTBootstrap::send_backlogged() const {
+        return send_backlogged_.load();
+    }
 
-                if (message_type == "q") {  // Query message
-                    std::string query_type = message.asDict().at("q").asString();
-                    std::cout << "[DHT] Query Type: " << query_type << '\n';
+    /**
+     * @brief Move queued datagrams into outgoing_ until it holds limit of
+     *        them or the queue is empty. Requires pump_mutex_.
+     *
+     * @return Datagrams moved.
+     */
+    size_t DHTBootstrap::drain_send_queue(size_t limit) {
+        size_t moved = 0;
+        while (outgoing_.size() < limit) {
+            std::optional<Datagram> datagram = send_queue_.pop();
+            if (!datagram) {
+                break;
+            }
+            outgoing_.push_back(std::move(*datagram));
+            moved++;
+        }
+        return moved;
+    }
 
-                    if (query_type == "ping") {
-                        std::cout << "[DHT] Handling PING request from "
-                                  << inet_ntoa(sender_addr.sin_addr) << ":"
-                                  << ntohs(sender_addr.sin_port) << '\n';
-                        handle_ping(message, sender_addr);
+    /**
+     * @brief Send queued datagrams in order, SEND_BATCH per sendmmsg(), until
+     *        the queue is empty or the socket would block, which sets the
+     *        backlog flag until a later flush gets through. A datagram the
+     *        kernel rejects outright is dropped. Requires pump_mutex_.
+     */
+    void DHTBootstrap::flush_send_queue() {
+        send_wake_pending_.exchange(false);
+        for (;;) {
+            drain_send_queue(SEND_BATCH);
+            if (outgoing_.empty()) {
+                send_backlogged_.store(false);
+                return;
+            }
+            int sent = send_batch_.send(sock_, outgoing_);
+            if (sent < 0) {
+                if (would_block()) {
+                    send_backlogged_.store(true);
+                    return;
+                }
+#ifdef _WIN32
+                std::cerr << "Sendto failed! Winsock error: " << WSAGetLastError() << '\n';
+#else
+                std::cerr << "Sendto failed! errno: " << strerror(errno) << '\n';
+#endif
+                sent = 1;
+            }
+            outgoing_.erase(outgoing_.begin(), outgoing_.begin() + sent);
+        }
+    }
 
-                    } else if (query_type == "find_node") {
-                        std::cout << "[DHT] Handling FIND_NODE request" << '\n';
-                        handle_find_node(message, sender_addr);
+    /**
+     * @brief io_uring counterpart of flush_send_queue(): turn queued
+     *        datagrams into sendmsg submissions until the queue is empty or
+     *        the ring's send slots run out. The backlog flag is set while
+     *        datagrams wait for a slot or the last send completion found
+     *        the socket buffer full. Requires pump_mutex_.
+     */
+    void DHTBootstrap::queue_uring_sends() {
+        send_wake_pending_.exchange(false);
+        while (drain_send_queue(SEND_BATCH) > 0 || !outgoing_.empty()) {
+            uring_.queue_sends(outgoing_);
+            if (!outgoing_.empty()) {
+                break;
+            }
+        }
+        send_backlogged_.store(!outgoing_.empty() || uring_.send_blocked());
+    }
 
-                    } else if (query_type == "get_peers") {
-                        std::cout << "[DHT] Handling GET_PEERS request" << '\n';
-                        handle_get_peers(message, sender_addr);
+    /**
+     * @brief Wake the loop if it is blocked past a new deadline.
+     *
+     * @param when The new timer or query deadline.
+     */
+    void DHTBootstrap::wake_if_sooner(TimerQueue::Clock::time_point when) {
+        if (when.time_since_epoch().count() < wait_until_.load()) {
+            loop_->wake();
+        }
+    }
 
-                    } else if (query_type == "announce_peer") {
-                        std::cout << "[DHT] Handling ANNOUNCE_PEER request" << '\n';
-                        handle_announce_peer(message, sender_addr);
-                    }
+    /**
+     * @brief Parse one datagram and route it: queries to their handlers,
+     *        responses and errors to the transaction manager.
+     *
+     * @param data        The datagram payload.
+     * @param length      Payload length in bytes.
+     * @param sender_addr Where the datagram came from.
+     */
+    void DHTBootstrap::dispatch(const char* data, size_t length, const sockaddr_in& sender_addr) {
+        if (config_.log_packets) {
+            // One write per datagram, so concurrent workers do not interleave
+            std::ostringstream log;
+            log << "[DHT] Received " << length << " bytes from " << ip_string(sender_addr.sin_addr) << ":"
+                << ntohs(sender_addr.sin_port) << "\n[DHT] Raw Data: " << std::hex << std::setfill('0');
+            for (size_t i = 0; i < length; i++) {
+                log << std::setw(2) << static_cast<unsigned>(static_cast<unsigned char>(data[i])) << ' ';
+            }
+            log << "\n[DHT] Message: " << std::string_view(data, length) << '\n';
+            std::cout << log.str();
+        }
 
-                } else if (message_type == "r") {  // Response message
-                    std::cout << "[DHT] Received RESPONSE message" << '\n';
+        // Parse the message in place
+        try {
+            BencodeParser parser;
+            std::string_view message_str(data, length);
+            BencodedValue message = parser.parse(message_str);
+
+            // Extract the message type
+            std::string message_type = message.asDict().at("y").asString();
+
+            if (message_type == "q") {  // Query message
+                std::string query_type = message.asDict().at("q").asString();
+
+                if (query_type == "ping") {
+                    handle_ping(message, sender_addr);
+                } else if (query_type == "find_node") {
+                    handle_find_node(message, sender_addr);
+                } else if (query_type == "get_peers") {
+                    handle_get_peers(message, sender_addr);
+                } else if (query_type == "announce_peer") {
+                    handle_announce_peer(message, sender_addr);
+                }
 
-                } else if (message_type == "e") {  // Error message
-                    std::cout << "[DHT] Received ERROR message" << '\n';
+            } else if (message_type == "r" || message_type == "e") {  // Response / error message
+                std::string transaction_id = message.asDict().at("t").asString();
+
+                QueryResult result;
+                result.status = message_type == "r" ? QueryResult::Status::Response
+                                                    : QueryResult::Status::Error;
+                result.message = std::move(message);
+                result.ip = ip_string(sender_addr.sin_addr);
+                result.port = ntohs(sender_addr.sin_port);
+
+                if (SocketShard::current() != nullptr || Pipeline::current() != nullptr) {
+                    // Query callbacks run on the thread pumping the primary socket
+                    auto shared_result = std::make_shared<QueryResult>(std::move(result));
+                    uint32_t ip = sender_addr.sin_addr.s_addr;
+                    schedule(std::chrono::milliseconds(0), [this, transaction_id, ip, shared_result]() {
+                        uint16_t port = shared_result->port;
+                        if (!transactions_.complete(transaction_id, ip, port, std::move(*shared_result))) {
+                            unmatched_replies_.fetch_add(1, std::memory_order_relaxed);
+                            if (config_.log_packets) {
+                                std::cout << "[DHT] Received unmatched reply on a worker" << '\n';
+                            }
+                        }
+                    });
+                } else if (!transactions_.complete(transaction_id, sender_addr.sin_addr.s_addr,
+                                                   result.port, std::move(result))) {
+                    // Normal after a timeout or a hedged query was answered twice
+                    unmatched_replies_.fetch_add(1, std::memory_order_relaxed);
+                    if (config_.log_packets) {
+                        std::cout << "[DHT] Received unmatched " << (message_type == "r" ? "RESPONSE" : "ERROR")
+                                  << " message" << '\n';
+                    }
                 }
-            } catch (const std::exception& e) {
-                std::cerr << "[DHT] Error parsing message: " << e.what() << '\n';
             }
+        } catch (const std::exception& e) {
+            std::cerr << "[DHT] Error parsing message: " << e.what() << '\n';
         }
     }
 
@@ -0,0 +1,148 @@
+#include "../include/dht_coro.hpp"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+namespace DHT {
+
+    /**
+     * @brief Awaitable KRPC query.
+     *
+     * @param node     The node to query.
+     * @param method   KRPC method name.
+     * @param args     Query arguments ("id" is filled in if missing).
+     * @param deadline Query timeout (0: the node's adaptive timeout).
+     * @param token    Cancels the query; the result is then Status::Cancelled.
+     */
+    Operation<QueryResult> AsyncDHT::query(const Node& node, const std::string& method, BencodedDict args,
+                                           std::chrono::milliseconds deadline, CancellationToken token) {
+        QueryResult cancelled;
+        cancelled.status = QueryResult::Status::Cancelled;
+        cancelled.ip = node.ip;
+        cancelled.port = node.port;
+
+        DHTBootstrap& dht = dht_;
+        auto start = [&dht, node, method, args = std::move(args), deadline](
+                         const std::shared_ptr<Operation<QueryResult>::State>& state) {
+            auto done = [state](const QueryResult& result) { state->finish(result); };
+            if (deadline.count() > 0) {
+                state->sent(dht.send_query(node, method, args, std::move(done), deadline));
+            } else {
+                state->sent(dht.send_query(node, method, args, std::move(done)));
+            }
+        };
+        return Operation<QueryResult>(dht_, std::move(start), std::move(cancelled), std::move(token));
+    }
+
+    /**
+     * @brief Awaitable find_node query to a single node.
+     *
+     * @param node     The node to ask.
+     * @param target   The ID to ask about.
+     * @param deadline Query timeout (0: the node's adaptive timeout).
+     * @param token    Cancels the query.
+     */
+    Operation<FindNodeResult> AsyncDHT::find_node(const Node& node, const NodeID& target,
+                                                  std::chrono::milliseconds deadline, CancellationToken token) {
+        FindNodeResult cancelled;
+        cancelled.status = QueryResult::Status::Cancelled;
+
+        DHTBootstrap& dht = dht_;
+        auto start = [&dht, node, target, deadline](const std::shared_ptr<Operation<FindNodeResult>::State>& state) {
+            BencodedDict args;
+            args["target"] = BencodedValue(std::string(reinterpret_cast<const char*>(target.data()), NODE_ID_SIZE));
+
+            auto done = [&dht, state](const QueryResult& result) {
+                FindNodeResult found;
+                found.status = result.status;
+                if (result.ok()) {
+                    try {
+                        const auto& r = result.message.asDict().at("r").asDict();
+                        auto nodes_it = r.find("nodes");
+                        if (nodes_it != r.end()) {
+                            dht.parse_compact_nodes(nodes_it->second.asString(), found.nodes);
+                        }
+                    } catch (const std::exception& e) {
+                        std::cerr << "Malformed find_node response from " << result.ip << ":"
+                                  << result.port << ": " << e.what() << '\n';
+                        found.status = QueryResult::Status::Error;
+                    }
+                }
+                state->finish(std::move(found));
+            };
+            if (deadline.count() > 0) {
+                state->sent(dht.send_query(node, "find_node", std::move(args), std::move(done), deadline));
+            } else {
+                state->sent(dht.send_query(node, "find_node", std::move(args), std::move(done)));
+            }
+        };
+        return Operation<FindNodeResult>(dht_, std::move(start), std::move(cancelled), std::move(token));
+    }
+
+    /**
+     * @brief Awaitable ping. Yields true if the node answered.
+     */
+    Operation<bool> AsyncDHT::ping(const Node& node, std::chrono::milliseconds deadline, CancellationToken token) {
+        DHTBootstrap& dht = dht_;
+        auto start = [&dht, node, deadline](const std::shared_ptr<Operation<bool>::State>& state) {
+            auto done = [state](const QueryResult& result) { state->finish(result.ok()); };
+            if (deadline.count() > 0) {
+                state->sent(dht.send_query(node, "ping", BencodedDict{}, std::move(done), deadline));
+            } else {
+                state->sent(dht.send_query(node, "ping", BencodedDict{}, std::move(done)));
+            }
+        };
+        return Operation<bool>(dht_, std::move(start), false, std::move(token));
+    }
+
+    /**
+     * @brief Awaitable iterative find_node lookup with the node's options.
+     */
+    Operation<LookupResult> AsyncDHT::lookup(const NodeID& target, std::chrono::milliseconds deadline,
+                                             CancellationToken token) {
+        return run_lookup(target, dht_.default_lookup_options(), deadline, std::move(token));
+    }
+
+    /**
+     * @brief Awaitable iterative get_peers lookup.
+     *
+     * @param info_hash The infohash.
+     * @param max_peers Finish once this many distinct peers are known (0: run
+     *                  to convergence).
+     * @param deadline  Finish with the partial result after this long (0: no
+     *                  deadline).
+     * @param token     Cancels the lookup.
+     */
+    Operation<LookupResult> AsyncDHT::get_peers(const NodeID& info_hash, size_t max_peers,
+                                                std::chrono::milliseconds deadline,
+                                                CancellationToken token) {
+        LookupOptions options = dht_.default_lookup_options();
+        options.get_peers = true;
+        options.max_peers = max_peers;
+        return run_lookup(info_hash, options, deadline, std::move(token));
+    }
+
+    /**
+     * @brief Shared body of the lookup awaitables. The deadline and token are
+     *        handed to the lookup, which then finishes with its partial result.
+     */
+    Operation<LookupResult> AsyncDHT::run_lookup(const NodeID& target, const LookupOptions& options,
+                                                 std::chrono::milliseconds deadline,
+                                                 CancellationToken token) {
+        LookupOptions bounded = options;
+        bounded.deadline = deadline;
+        bounded.cancel = token;
+
+        LookupResult cancelled;
+        cancelled.status = LookupResult::Status::Cancelled;
+        cancelled.target = target;
+
+        DHTBootstrap& dht = dht_;
+        auto start = [&dht, target, bounded](const std::shared_ptr<Operation<LookupResult>::State>& state) {
+            dht.lookup(target, bounded, [state](const LookupResult& result) { state->finish(result); });
+        };
+        return Operation<LookupResult>(dht_, std::move(start), std::move(cancelled), std::move(token));
+    }
+
+} // namespace DHT
+
+#endif // __cpp_impl_coroutine
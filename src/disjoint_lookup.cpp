@@ -0,0 +1,215 @@
+#include "../include/disjoint_lookup.hpp"
+#include "../include/dht_bootstrap.hpp"
+#include <algorithm>
+
+namespace DHT {
+
+    /**
+     * @brief Construct a disjoint-path lookup. Nothing is sent until start().
+     *
+     * @param dht     The node whose socket and routing table the paths use.
+     * @param target  The ID being looked up.
+     * @param options Per-path options plus disjoint_paths and path_quorum.
+     * @param done    Invoked once with the merged result.
+     */
+    DisjointLookup::DisjointLookup(DHTBootstrap& dht, const NodeID& target, const LookupOptions& options,
+                                   LookupCallback done)
+        : dht_(dht), target_(target), options_(options), done_(std::move(done)) {
+        options_.disjoint_paths = std::max<size_t>(options_.disjoint_paths, 1);
+        options_.path_quorum = std::clamp<size_t>(options_.path_quorum, 1, options_.disjoint_paths);
+        if (options_.k == 0) {
+            options_.k = K;
+        }
+    }
+
+    /**
+     * @brief Deal the seeds, closest first, round-robin to the paths and start
+     *        them all.
+     *
+     * @param seeds Initial contacts; duplicates are dropped.
+     */
+    void DisjointLookup::start(const std::vector<Node>& seeds) {
+        std::vector<Node> unique;
+        for (const auto& node : seeds) {
+            bool known = std::any_of(unique.begin(), unique.end(), [&](const Node& n) {
+                return n.id == node.id || (n.ip == node.ip && n.port == node.port);
+            });
+            if (!known) {
+                unique.push_back(node);
+            }
+        }
+        std::stable_sort(unique.begin(), unique.end(), [this](const Node& a, const Node& b) {
+            return xor_distance(a.id, target_) < xor_distance(b.id, target_);
+        });
+
+        size_t count = options_.disjoint_paths;
+        std::vector<std::vector<Node>> dealt(count);
+        for (size_t i = 0; i < unique.size(); ++i) {
+            dealt[i % count].push_back(unique[i]);
+        }
+
+        LookupOptions path_options = options_;
+        path_options.disjoint_paths = 1;
+        path_options.path_quorum = 1;
+
+        // The paths hold this object until it finishes and drops them
+        auto self = shared_from_this();
+        std::vector<std::shared_ptr<Lookup>> paths;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            results_.resize(count);
+            path_finished_.assign(count, false);
+            for (size_t i = 0; i < count; ++i) {
+                paths_.push_back(std::make_shared<Lookup>(
+                    dht_, target_, path_options,
+                    [self, i](const LookupResult& result) { self->on_path_done(i, result); },
+                    nullptr,
+                    [self](const Node& node) { return self->claim(node); }));
+            }
+            paths = paths_;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            paths[i]->start(dealt[i]);
+        }
+    }
+
+    /**
+     * @brief ContactFilter shared by the paths: the first path to query a
+     *        contact owns it.
+     *
+     * @return Whether the asking path may query the contact.
+     */
+    bool DisjointLookup::claim(const Node& node) {
+        std::lock_guard<std::mutex> lock(claim_mutex_);
+        return claimed_.insert(node.ip + ":" + std::to_string(node.port)).second;
+    }
+
+    /**
+     * @brief Record a finished path. Once the quorum is met (or every path has
+     *        finished) cancel the rest; when the last of them has reported its
+     *        partial result, merge everything found and report.
+     *
+     * @param path   Index of the path.
+     * @param result The path's result; partial if it was cancelled.
+     */
+    void DisjointLookup::on_path_done(size_t path, const LookupResult& result) {
+        std::vector<std::shared_ptr<Lookup>> to_cancel;
+        bool report = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (path_finished_[path]) {
+                return;
+            }
+            path_finished_[path] = true;
+            results_[path] = result;
+            paths_finished_++;
+            bool complete = result.status == LookupResult::Status::Converged ||
+                            result.status == LookupResult::Status::EnoughPeers;
+            if (complete && !result.closest.empty()) {
+                quorum_reached_++;
+            }
+            if (!cancelling_ && quorum_reached_ >= options_.path_quorum) {
+                cancelling_ = true;
+                for (size_t i = 0; i < paths_.size(); ++i) {
+                    if (!path_finished_[i]) {
+                        to_cancel.push_back(paths_[i]);
+                    }
+                }
+            }
+            if (!finished_ && paths_finished_ == options_.disjoint_paths) {
+                finished_ = true;
+                report = true;
+            }
+        }
+
+        // Cancelled paths report back on a later pass of the loop
+        for (const auto& lookup : to_cancel) {
+            lookup->cancel();
+        }
+        if (!report) {
+            return;
+        }
+
+        LookupResult merged;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            merged = merge();
+            paths_.clear();
+        }
+        if (done_) {
+            done_(merged);
+        }
+    }
+
+    /**
+     * @brief Combine the path results: the k closest distinct responders with
+     *        their tokens, the union of peers and the summed statistics.
+     *        Requires mutex_.
+     */
+    LookupResult DisjointLookup::merge() const {
+        struct Responder {
+            Node node;
+            std::string token;
+        };
+        std::vector<Responder> responders;
+
+        LookupResult merged;
+        merged.target = target_;
+        bool converged = false;
+        bool enough_peers = false;
+        bool expired = false;
+        for (const auto& result : results_) {
+            for (size_t i = 0; i < result.closest.size(); ++i) {
+                responders.push_back({result.closest[i], i < result.tokens.size() ? result.tokens[i] : std::string()});
+            }
+            for (const auto& peer : result.peers) {
+                bool known = std::any_of(merged.peers.begin(), merged.peers.end(), [&](const Node& p) {
+                    return p.ip == peer.ip && p.port == peer.port;
+                });
+                if (!known) {
+                    merged.peers.push_back(peer);
+                }
+            }
+            merged.hops = std::max(merged.hops, result.hops);
+            merged.queries += result.queries;
+            merged.responses += result.responses;
+            merged.timeouts += result.timeouts;
+            merged.errors += result.errors;
+            merged.hedges += result.hedges;
+            merged.duration = std::max(merged.duration, result.duration);
+            converged |= result.status == LookupResult::Status::Converged && !result.closest.empty();
+            enough_peers |= result.status == LookupResult::Status::EnoughPeers;
+            expired |= result.status == LookupResult::Status::DeadlineExpired;
+        }
+
+        std::stable_sort(responders.begin(), responders.end(), [this](const Responder& a, const Responder& b) {
+            return xor_distance(a.node.id, target_) < xor_distance(b.node.id, target_);
+        });
+        for (const auto& responder : responders) {
+            if (merged.closest.size() == options_.k) {
+                break;
+            }
+            if (!merged.closest.empty() && merged.closest.back().id == responder.node.id) {
+                continue;
+            }
+            merged.closest.push_back(responder.node);
+            if (options_.get_peers) {
+                merged.tokens.push_back(responder.token);
+            }
+        }
+
+        if (enough_peers || (options_.max_peers > 0 && merged.peers.size() >= options_.max_peers)) {
+            merged.status = LookupResult::Status::EnoughPeers;
+        } else if (converged || (!expired && results_.size() > 0 &&
+                                 std::all_of(results_.begin(), results_.end(), [](const LookupResult& r) {
+                                     return r.status == LookupResult::Status::Converged;
+                                 }))) {
+            merged.status = LookupResult::Status::Converged;
+        } else {
+            merged.status = expired ? LookupResult::Status::DeadlineExpired : LookupResult::Status::Cancelled;
+        }
+        return merged;
+    }
+
+} // namespace DHT
@@ -0,0 +1,152 @@
+#include "../include/epoch.hpp"
+#include <limits>
+#include <thread>
+
+namespace DHT {
+
+    /**
+     * @brief Per-thread registration with the global epoch domain. The slot is
+     *        claimed lazily on first use and handed back when the thread exits.
+     */
+    struct EpochThreadState {
+        size_t slot = EpochDomain::MAX_THREADS;
+        size_t depth = 0;
+
+        ~EpochThreadState() {
+            if (slot != EpochDomain::MAX_THREADS) {
+                EpochDomain::global().release_slot(slot);
+            }
+        }
+    };
+
+    static thread_local EpochThreadState epoch_thread_state;
+
+    /**
+     * @brief Access the process-wide epoch domain shared by all RCU structures.
+     */
+    EpochDomain& EpochDomain::global() {
+        static EpochDomain domain;
+        return domain;
+    }
+
+    /**
+     * @brief Free any versions still waiting for reclamation. By the time the
+     *        domain is destroyed no reader can be running.
+     */
+    EpochDomain::~EpochDomain() {
+        for (auto& entry : retired_) {
+            entry.second();
+        }
+    }
+
+    /**
+     * @brief Claim a free reader slot for the calling thread. Spins (yielding)
+     *        if more than MAX_THREADS threads are reading concurrently.
+     *
+     * @return Index of the claimed slot.
+     */
+    size_t EpochDomain::acquire_slot() {
+        while (true) {
+            for (size_t i = 0; i < MAX_THREADS; ++i) {
+                bool expected = false;
+                if (!slots_[i].in_use.load(std::memory_order_relaxed) &&
+                    slots_[i].in_use.compare_exchange_strong(expected, true)) {
+                    return i;
+                }
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    /**
+     * @brief Hand a reader slot back to the pool.
+     */
+    void EpochDomain::release_slot(size_t index) {
+        slots_[index].epoch.store(0);
+        slots_[index].in_use.store(false);
+    }
+
+    /**
+     * @brief Enter a read-side critical section. Everything loaded from an RCU
+     *        pointer after this call stays valid until the matching leave().
+     */
+    void EpochDomain::enter() {
+        auto& state = epoch_thread_state;
+        if (state.depth++ > 0) {
+            return;
+        }
+        if (state.slot == MAX_THREADS) {
+            state.slot = acquire_slot();
+        }
+        // seq_cst: the slot store must be visible before the caller loads the
+        // protected pointer, otherwise a writer could miss this reader.
+        slots_[state.slot].epoch.store(global_epoch_.load());
+    }
+
+    /**
+     * @brief Leave the read-side critical section entered with enter().
+     */
+    void EpochDomain::leave() {
+        auto& state = epoch_thread_state;
+        if (--state.depth == 0) {
+            slots_[state.slot].epoch.store(0);
+        }
+    }
+
+    /**
+     * @brief Smallest epoch announced by a thread currently reading.
+     *
+     * @return The minimum active epoch, or UINT64_MAX if nobody is reading.
+     */
+    uint64_t EpochDomain::min_active_epoch() const {
+        uint64_t min_epoch = std::numeric_limits<uint64_t>::max();
+        for (const auto& slot : slots_) {
+            uint64_t epoch = slot.epoch.load();
+            if (epoch != 0 && epoch < min_epoch) {
+                min_epoch = epoch;
+            }
+        }
+        return min_epoch;
+    }
+
+    /**
+     * @brief Retire an unpublished version. The deleter runs once all readers
+     *        that might still hold a reference have left their critical section.
+     *        Must be called after the replacement has been published.
+     *
+     * @param deleter Callable that frees the retired version.
+     */
+    void EpochDomain::retire(std::function<void()> deleter) {
+        uint64_t epoch = global_epoch_.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(retire_mutex_);
+            retired_.emplace_back(epoch, std::move(deleter));
+        }
+        reclaim();
+    }
+
+    /**
+     * @brief Run the deleters of every retired version that no active reader
+     *        can still observe.
+     */
+    void EpochDomain::reclaim() {
+        std::vector<std::function<void()>> ready;
+        {
+            std::lock_guard<std::mutex> lock(retire_mutex_);
+            uint64_t safe_below = min_active_epoch();
+            auto it = retired_.begin();
+            while (it != retired_.end()) {
+                if (it->first < safe_below) {
+                    ready.push_back(std::move(it->second));
+                    it = retired_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        for (auto& deleter : ready) {
+            deleter();
+        }
+    }
+
+} // namespace DHT
@@ -0,0 +1,196 @@
+#include "../include/event_loop.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+#else
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <unistd.h>
+#endif
+
+#ifdef __linux__
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+#endif
+
+namespace DHT {
+
+    /**
+     * @brief Put a socket into non-blocking mode.
+     *
+     * @return True on success.
+     */
+    bool set_nonblocking(int sock) {
+#ifdef _WIN32
+        u_long mode = 1;
+        return ioctlsocket(sock, FIONBIO, &mode) == 0;
+#else
+        int flags = fcntl(sock, F_GETFL, 0);
+        return flags >= 0 && fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+    }
+
+    /**
+     * @brief Block until a socket has room to send, for a thread that only
+     *        writes to it (no event loop of its own).
+     *
+     * @return True if writable, false on timeout or error.
+     */
+    bool wait_writable(int sock, std::chrono::milliseconds timeout) {
+        int timeout_ms = static_cast<int>(std::clamp<std::chrono::milliseconds::rep>(timeout.count(), 0, INT32_MAX));
+#ifdef _WIN32
+        WSAPOLLFD fd{};
+        fd.fd = sock;
+        fd.events = POLLWRNORM;
+        return WSAPoll(&fd, 1, timeout_ms) > 0 && (fd.revents & POLLWRNORM) != 0;
+#else
+        pollfd fd{};
+        fd.fd = sock;
+        fd.events = POLLOUT;
+        return poll(&fd, 1, timeout_ms) > 0 && (fd.revents & POLLOUT) != 0;
+#endif
+    }
+
+    /**
+     * @brief Watch a socket for readability. On Linux, also create the eventfd
+     *        used by wake().
+     *
+     * @param sock The (non-blocking) socket.
+     */
+    EventLoop::EventLoop(int sock) : sock_(sock) {
+#ifdef __linux__
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epoll_fd_ < 0 || wake_fd_ < 0) {
+            std::cerr << "[EventLoop] Failed to create epoll instance: " << strerror(errno) << '\n';
+            return;
+        }
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = sock_;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, sock_, &event) < 0) {
+            std::cerr << "[EventLoop] Failed to watch socket: " << strerror(errno) << '\n';
+        }
+        event.data.fd = wake_fd_;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event) < 0) {
+            std::cerr << "[EventLoop] Failed to watch eventfd: " << strerror(errno) << '\n';
+        }
+#endif
+    }
+
+    /**
+     * @brief Close the epoll instance and eventfd. The socket is not closed.
+     */
+    EventLoop::~EventLoop() {
+#ifdef __linux__
+        if (epoll_fd_ >= 0) {
+            close(epoll_fd_);
+        }
+        if (wake_fd_ >= 0) {
+            close(wake_fd_);
+        }
+#endif
+    }
+
+    /**
+     * @brief Wait for socket readiness, a wake-up or the timeout.
+     *
+     * @param timeout    Longest wait (0 polls without blocking).
+     * @param want_write Also report when the socket becomes writable.
+     *
+     * @return What became ready; all false on timeout.
+     */
+    EventLoop::Ready EventLoop::wait(std::chrono::milliseconds timeout, bool want_write) {
+        Ready ready;
+        int timeout_ms = static_cast<int>(std::clamp<std::chrono::milliseconds::rep>(timeout.count(), 0, INT32_MAX));
+
+#ifdef __linux__
+        if (epoll_fd_ >= 0) {
+            if (want_write != write_armed_) {
+                epoll_event event{};
+                event.events = EPOLLIN | (want_write ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+                event.data.fd = sock_;
+                if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, sock_, &event) == 0) {
+                    write_armed_ = want_write;
+                }
+            }
+
+            epoll_event events[2];
+            int count = epoll_wait(epoll_fd_, events, 2, timeout_ms);
+            if (count < 0 && errno != EINTR) {
+                std::cerr << "[EventLoop] epoll_wait failed: " << strerror(errno) << '\n';
+            }
+            for (int i = 0; i < count; ++i) {
+                if (events[i].data.fd == wake_fd_) {
+                    uint64_t value;
+                    while (read(wake_fd_, &value, sizeof(value)) > 0) {
+                    }
+                    ready.woken = true;
+                } else {
+                    ready.readable = (events[i].events & (EPOLLIN | EPOLLERR)) != 0;
+                    ready.writable = (events[i].events & EPOLLOUT) != 0;
+                }
+            }
+            return ready;
+        }
+#endif
+
+        timeout_ms = std::min(timeout_ms, FALLBACK_WAIT_MS);
+#ifdef _WIN32
+        WSAPOLLFD fd{};
+        fd.fd = sock_;
+        fd.events = POLLRDNORM | (want_write ? POLLWRNORM : 0);
+        int count = WSAPoll(&fd, 1, timeout_ms);
+        if (count > 0) {
+            ready.readable = (fd.revents & (POLLRDNORM | POLLERR)) != 0;
+            ready.writable = (fd.revents & POLLWRNORM) != 0;
+        }
+#else
+        pollfd fd{};
+        fd.fd = sock_;
+        fd.events = POLLIN | (want_write ? POLLOUT : 0);
+        int count = poll(&fd, 1, timeout_ms);
+        if (count > 0) {
+            ready.readable = (fd.revents & (POLLIN | POLLERR)) != 0;
+            ready.writable = (fd.revents & POLLOUT) != 0;
+        }
+#endif
+        return ready;
+    }
+
+    /**
+     * @brief Interrupt a wait() in progress, or make the next one return at
+     *        once. Without epoll this is a no-op (waits are short instead).
+     */
+    void EventLoop::wake() {
+#ifdef __linux__
+        if (wake_fd_ >= 0) {
+            uint64_t one = 1;
+            if (write(wake_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+                std::cerr << "[EventLoop] Failed to signal eventfd: " << strerror(errno) << '\n';
+            }
+        }
+#endif
+    }
+
+    /**
+     * @brief The eventfd signalled by wake(), so another backend can wait on
+     *        it instead of wait().
+     *
+     * @return The descriptor, or -1 without epoll.
+     */
+    int EventLoop::wake_fd() const {
+#ifdef __linux__
+        return wake_fd_;
+#else
+        return -1;
+#endif
+    }
+
+} // namespace DHT
@@ -0,0 +1,207 @@
+#include "../include/host_resolver.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+#else
+    #include <arpa/inet.h>
+    #include <netdb.h>
+    #include <sys/socket.h>
+#endif
+
+namespace DHT {
+
+    /**
+     * @brief Construct a resolver. No thread runs until the first request.
+     *
+     * @param cache_path File the cache is loaded from and saved to ("" keeps
+     *                   the cache in memory only).
+     */
+    HostResolver::HostResolver(const std::string& cache_path) : cache_path_(cache_path) {
+        load_cache();
+    }
+
+    /**
+     * @brief Stop the resolver thread. A lookup already inside getaddrinfo()
+     *        is waited for; queued requests are dropped without a callback.
+     */
+    HostResolver::~HostResolver() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    /**
+     * @brief Resolve a hostname without blocking. A cached host is answered
+     *        immediately and refreshed in the background.
+     *
+     * @param host The hostname (or address literal).
+     * @param done Invoked once with the IPv4 addresses.
+     */
+    void HostResolver::resolve(const std::string& host, Callback done) {
+        std::vector<std::string> addresses;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = cache_.find(host);
+            if (it != cache_.end()) {
+                addresses = it->second;
+                queue_.push_back({host, nullptr});
+            } else {
+                queue_.push_back({host, std::move(done)});
+            }
+            if (!thread_.joinable()) {
+                thread_ = std::thread(&HostResolver::worker, this);
+            }
+        }
+        wake_.notify_one();
+
+        if (!addresses.empty()) {
+            done(host, addresses);
+        }
+    }
+
+    /**
+     * @brief Last known addresses of a host (empty if never resolved).
+     */
+    std::vector<std::string> HostResolver::cached(const std::string& host) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = cache_.find(host);
+        return it != cache_.end() ? it->second : std::vector<std::string>();
+    }
+
+    /**
+     * @brief Requests queued or being resolved.
+     */
+    size_t HostResolver::pending() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return queue_.size() + in_progress_;
+    }
+
+    /**
+     * @brief Resolver thread: take requests one at a time, resolve them with
+     *        getaddrinfo() outside the lock, update the cache and call back.
+     */
+    void HostResolver::worker() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            wake_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            Request request = std::move(queue_.front());
+            queue_.pop_front();
+            in_progress_++;
+            lock.unlock();
+
+            std::vector<std::string> addresses;
+            addrinfo hints{};
+            hints.ai_family = AF_INET;
+            hints.ai_socktype = SOCK_DGRAM;
+            addrinfo* result = nullptr;
+            int error = getaddrinfo(request.host.c_str(), nullptr, &hints, &result);
+            if (error == 0) {
+                for (addrinfo* ai = result; ai; ai = ai->ai_next) {
+                    char ip_str[INET_ADDRSTRLEN];
+                    const auto* addr = reinterpret_cast<const sockaddr_in*>(ai->ai_addr);
+                    inet_ntop(AF_INET, &addr->sin_addr, ip_str, sizeof(ip_str));
+                    if (std::find(addresses.begin(), addresses.end(), ip_str) == addresses.end()) {
+                        addresses.push_back(ip_str);
+                    }
+                }
+                freeaddrinfo(result);
+            } else {
+                std::cerr << "[Resolver] Failed to resolve " << request.host << ": "
+                          << gai_strerror(error) << '\n';
+            }
+
+            lock.lock();
+            if (!addresses.empty()) {
+                cache_[request.host] = addresses;
+                save_cache();
+            } else {
+                // Keep answering with the last known addresses
+                auto it = cache_.find(request.host);
+                if (it != cache_.end()) {
+                    addresses = it->second;
+                }
+            }
+            in_progress_--;
+            lock.unlock();
+
+            if (request.done) {
+                request.done(request.host, addresses);
+            }
+            lock.lock();
+        }
+    }
+
+    /**
+     * @brief Read the cache file: one "host addr[,addr...]" line per host.
+     */
+    void HostResolver::load_cache() {
+        if (cache_path_.empty()) {
+            return;
+        }
+        std::ifstream in(cache_path_);
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string host;
+            std::string list;
+            if (!(fields >> host >> list)) {
+                continue;
+            }
+            std::vector<std::string> addresses;
+            std::istringstream items(list);
+            std::string address;
+            while (std::getline(items, address, ',')) {
+                in_addr parsed{};
+                if (inet_pton(AF_INET, address.c_str(), &parsed) == 1) {
+                    addresses.push_back(address);
+                }
+            }
+            if (!addresses.empty()) {
+                cache_[host] = std::move(addresses);
+            }
+        }
+    }
+
+    /**
+     * @brief Rewrite the cache file through a temporary file, so a crash
+     *        never leaves a truncated cache. Requires mutex_.
+     */
+    void HostResolver::save_cache() {
+        if (cache_path_.empty()) {
+            return;
+        }
+        std::string temp_path = cache_path_ + ".tmp";
+        {
+            std::ofstream out(temp_path, std::ios::trunc);
+            for (const auto& [host, addresses] : cache_) {
+                out << host << ' ';
+                for (size_t i = 0; i < addresses.size(); ++i) {
+                    out << (i ? "," : "") << addresses[i];
+                }
+                out << '\n';
+            }
+            if (!out) {
+                std::cerr << "[Resolver] Failed to write " << temp_path << '\n';
+                return;
+            }
+        }
+        if (std::rename(temp_path.c_str(), cache_path_.c_str()) != 0) {
+            std::cerr << "[Resolver] Failed to replace " << cache_path_ << '\n';
+        }
+    }
+
+} // namespace DHT
@@ -0,0 +1,475 @@
+#include "../include/lookup.hpp"
+#include "../include/dht_bootstrap.hpp"
+#include <algorithm>
+
+namespace DHT {
+
+    /**
+     * @brief Construct a lookup. Nothing is sent until start().
+     *
+     * @param dht     The node whose socket and routing table the lookup uses.
+     * @param target  The ID being looked up.
+     * @param options Parallelism and result size.
+     * @param done    Invoked once when the lookup converges or runs dry.
+     * @param sender  Optional replacement for DHTBootstrap::send_query.
+     * @param filter  Optional check before each query; contacts it refuses
+     *                are skipped as if they had failed.
+     */
+    Lookup::Lookup(DHTBootstrap& dht, const NodeID& target, const LookupOptions& options,
+                   LookupCallback done, QuerySender sender, ContactFilter filter)
+        : dht_(dht), target_(target), options_(options), done_(std::move(done)),
+          sender_(std::move(sender)), filter_(std::move(filter)) {
+        if (options_.alpha == 0) {
+            options_.alpha = 1;
+        }
+        if (options_.k == 0) {
+            options_.k = K;
+        }
+    }
+
+    /**
+     * @brief Seed the shortlist and send the first alpha queries.
+     *
+     * @param seeds Initial contacts, e.g. the closest known nodes and the
+     *              bootstrap nodes.
+     */
+    void Lookup::start(const std::vector<Node>& seeds) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            started_ = Clock::now();
+            for (const auto& node : seeds) {
+                add_candidate(node, 0);
+            }
+        }
+
+        // Neither the timer nor the token keeps the lookup alive
+        std::weak_ptr<Lookup> weak = shared_from_this();
+        if (options_.deadline.count() > 0) {
+            dht_.schedule(options_.deadline, [weak]() {
+                if (auto lookup = weak.lock()) {
+                    lookup->finish_early(LookupResult::Status::DeadlineExpired);
+                }
+            });
+        }
+        if (options_.cancel) {
+            // cancel() may come from any thread; finish on the pumping one
+            DHTBootstrap* dht = &dht_;
+            size_t id = options_.cancel->on_cancel([dht, weak]() {
+                dht->schedule(std::chrono::milliseconds(0), [weak]() {
+                    if (auto lookup = weak.lock()) {
+                        lookup->finish_early(LookupResult::Status::Cancelled);
+                    }
+                });
+            });
+            std::lock_guard<std::mutex> lock(mutex_);
+            cancel_id_ = id;
+        }
+
+        step();
+    }
+
+    /**
+     * @brief Stop the lookup and report what has been found so far. Safe from
+     *        any thread: the callback runs on the thread pumping the socket,
+     *        after this returns.
+     */
+    void Lookup::cancel() {
+        std::weak_ptr<Lookup> weak = shared_from_this();
+        dht_.schedule(std::chrono::milliseconds(0), [weak]() {
+            if (auto lookup = weak.lock()) {
+                lookup->finish_early(LookupResult::Status::Cancelled);
+            }
+        });
+    }
+
+    /**
+     * @brief Finish before convergence (deadline or cancellation) with the
+     *        partial result. Does nothing if the lookup already finished.
+     *
+     * @param status Why the lookup stopped.
+     */
+    void Lookup::finish_early(LookupResult::Status status) {
+        LookupResult result;
+        size_t cancel_id;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (finished_) {
+                return;
+            }
+            finished_ = true;
+            result = build_result();
+            result.status = status;
+            cancel_id = cancel_id_;
+        }
+        if (cancel_id) {
+            options_.cancel->remove(cancel_id);
+        }
+        if (done_) {
+            done_(result);
+        }
+    }
+
+    /**
+     * @brief Insert a contact into the shortlist, keeping it sorted by distance.
+     *        Contacts already present (by ID or address) and our own ID are skipped.
+     *
+     * @param node The contact.
+     * @param hop  Number of referrals that led to it.
+     */
+    void Lookup::add_candidate(const Node& node, size_t hop) {
+        if (node.id == dht_.getMyNodeId() || node.port == 0) {
+            return;
+        }
+        for (const auto& candidate : shortlist_) {
+            if (candidate.node.id == node.id ||
+                (candidate.node.ip == node.ip && candidate.node.port == node.port)) {
+                return;
+            }
+        }
+
+        Candidate candidate;
+        candidate.node = node;
+        candidate.distance = xor_distance(node.id, target_);
+        candidate.hop = hop;
+
+        auto it = std::upper_bound(shortlist_.begin(), shortlist_.end(), candidate,
+                                   [](const Candidate& a, const Candidate& b) {
+                                       return a.distance < b.distance;
+                                   });
+        shortlist_.insert(it, std::move(candidate));
+    }
+
+    /**
+     * @brief Find a shortlist entry by address.
+     */
+    Lookup::Candidate* Lookup::find_candidate(const std::string& ip, uint16_t port) {
+        for (auto& candidate : shortlist_) {
+            if (candidate.node.ip == ip && candidate.node.port == port) {
+                return &candidate;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Whether the k closest candidates that have not failed have all
+     *        answered (or fewer than k live candidates remain and all answered).
+     */
+    bool Lookup::converged() const {
+        size_t answered = 0;
+        for (const auto& candidate : shortlist_) {
+            if (candidate.state == State::Failed) {
+                continue;
+            }
+            if (candidate.state != State::Responded) {
+                return false;
+            }
+            if (++answered == options_.k) {
+                return true;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Whether a get_peers lookup has found the requested number of peers.
+     */
+    bool Lookup::enough_peers() const {
+        return options_.max_peers > 0 && peers_.size() >= options_.max_peers;
+    }
+
+    /**
+     * @brief Collect the k closest responders, their tokens, the peers found
+     *        and the lookup statistics.
+     */
+    LookupResult Lookup::build_result() const {
+        LookupResult result;
+        result.target = target_;
+        for (const auto& candidate : shortlist_) {
+            if (candidate.state != State::Responded) {
+                continue;
+            }
+            result.closest.push_back(candidate.node);
+            if (options_.get_peers) {
+                result.tokens.push_back(candidate.token);
+            }
+            result.hops = std::max(result.hops, candidate.hop + 1);
+            if (result.closest.size() == options_.k) {
+                break;
+            }
+        }
+        result.queries = queries_;
+        result.responses = responses_;
+        result.timeouts = timeouts_;
+        result.errors = errors_;
+        result.hedges = hedges_;
+        result.peers = peers_;
+        result.duration = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - started_);
+        return result;
+    }
+
+    /**
+     * @brief Either finish the lookup or top up the in-flight queries to alpha,
+     *        closest pending candidates first.
+     */
+    void Lookup::step() {
+        std::vector<Node> to_query;
+        LookupResult result;
+        bool finished = false;
+        size_t cancel_id = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (finished_) {
+                return;
+            }
+            if (!converged() && !enough_peers()) {
+                for (auto& candidate : shortlist_) {
+                    if (in_flight_ >= options_.alpha) {
+                        break;
+                    }
+                    if (candidate.state != State::Pending) {
+                        continue;
+                    }
+                    if (filter_ && !filter_(candidate.node)) {
+                        candidate.state = State::Failed;
+                        continue;
+                    }
+                    candidate.state = State::InFlight;
+                    in_flight_++;
+                    queries_++;
+                    to_query.push_back(candidate.node);
+                }
+            }
+            // Checked after topping up: refused candidates may leave nothing to wait for
+            if (to_query.empty() && (converged() || enough_peers())) {
+                finished_ = finished = true;
+                result = build_result();
+                result.status = enough_peers() ? LookupResult::Status::EnoughPeers
+                                               : LookupResult::Status::Converged;
+                cancel_id = cancel_id_;
+            }
+        }
+
+        if (finished) {
+            if (cancel_id) {
+                options_.cancel->remove(cancel_id);
+            }
+            dht_.closest_cache_.store(target_, result.closest);
+            if (done_) {
+                done_(result);
+            }
+            return;
+        }
+
+        // Send outside the lock: a failed send calls back synchronously
+        send(to_query);
+    }
+
+    /**
+     * @brief Query candidates already marked InFlight, and arm a hedge timer for
+     *        each at the configured percentile of observed RTTs.
+     *
+     * @param nodes The candidates to query.
+     */
+    void Lookup::send(const std::vector<Node>& nodes) {
+        auto self = shared_from_this();
+
+        RttEstimator::Duration hedge_after(0);
+        if (options_.hedge_budget > 0) {
+            hedge_after = dht_.rtt_.percentile(options_.hedge_percentile);
+        }
+
+        const char* method = options_.get_peers ? "get_peers" : "find_node";
+        const char* key = options_.get_peers ? "info_hash" : "target";
+
+        for (const auto& node : nodes) {
+            BencodedDict args;
+            args[key] = BencodedValue(std::string(reinterpret_cast<const char*>(target_.data()), NODE_ID_SIZE));
+            QueryCallback callback = [self, ip = node.ip, port = node.port](const QueryResult& result) {
+                self->on_result(ip, port, result);
+            };
+            if (sender_) {
+                sender_(node, method, std::move(args), std::move(callback));
+            } else {
+                dht_.send_query(node, method, std::move(args), std::move(callback));
+            }
+
+            // Zero means too few RTT samples to know what "slow" is yet
+            if (hedge_after.count() > 0) {
+                dht_.schedule(hedge_after, [self, ip = node.ip, port = node.port]() {
+                    self->on_slow(ip, port);
+                });
+            }
+        }
+    }
+
+    /**
+     * @brief Hedge timer: if the query to ip:port is still unanswered, query the
+     *        next-closest pending candidate as well, within the hedge budget.
+     *
+     * @param ip   Address of the slow candidate.
+     * @param port Port of the slow candidate.
+     */
+    void Lookup::on_slow(const std::string& ip, uint16_t port) {
+        std::vector<Node> hedge;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (finished_ || hedges_ >= options_.hedge_budget) {
+                return;
+            }
+            Candidate* slow = find_candidate(ip, port);
+            if (!slow || slow->state != State::InFlight || slow->hedged) {
+                return;
+            }
+            slow->hedged = true;
+
+            for (auto& candidate : shortlist_) {
+                if (candidate.state == State::Pending && filter_ && !filter_(candidate.node)) {
+                    candidate.state = State::Failed;
+                    continue;
+                }
+                if (candidate.state == State::Pending) {
+                    candidate.state = State::InFlight;
+                    in_flight_++;
+                    queries_++;
+                    hedges_++;
+                    hedge.push_back(candidate.node);
+                    break;
+                }
+            }
+        }
+        send(hedge);
+    }
+
+    /**
+     * @brief Fold one query outcome into the shortlist and advance the lookup.
+     *
+     * @param ip     Address of the queried candidate.
+     * @param port   Port of the queried candidate.
+     * @param result The response, error or timeout.
+     */
+    void Lookup::on_result(const std::string& ip, uint16_t port, const QueryResult& result) {
+        std::vector<Node> referrals;
+        std::vector<Node> values;
+        std::string token;
+        Node responder;
+        bool responded = false;
+
+        if (result.ok()) {
+            try {
+                const auto& r = result.message.asDict().at("r").asDict();
+                auto nodes_it = r.find("nodes");
+                if (nodes_it != r.end()) {
+                    dht_.parse_compact_nodes(nodes_it->second.asString(), referrals);
+                }
+                if (options_.get_peers) {
+                    auto token_it = r.find("token");
+                    if (token_it != r.end()) {
+                        token = token_it->second.asString();
+                    }
+                    auto values_it = r.find("values");
+                    if (values_it != r.end()) {
+                        // BEP 5 sends a list of 6-byte strings; older nodes
+                        // send one concatenated string
+                        if (values_it->second.isList()) {
+                            for (const auto& value : values_it->second.asList()) {
+                                dht_.parse_compact_peers(value.asString(), values);
+                            }
+                        } else {
+                            dht_.parse_compact_peers(values_it->second.asString(), values);
+                        }
+                    }
+                }
+                auto id_it = r.find("id");
+                if (id_it != r.end() && id_it->second.asString().size() == NODE_ID_SIZE) {
+                    responder.id = dht_.string_to_node_id(id_it->second.asString());
+                    responded = true;
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "[Lookup] Malformed response from " << ip << ":" << port
+                          << ": " << e.what() << '\n';
+            }
+        }
+
+        LookupProgress progress;
+        bool notify = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Candidate* candidate = find_candidate(ip, port);
+            if (!candidate || candidate->state != State::InFlight) {
+                return;
+            }
+            in_flight_--;
+
+            if (!responded) {
+                // Not a candidate either way, but an error reply is not a
+                // silent node: it has already been timed as a round trip
+                candidate->state = State::Failed;
+                if (result.status == QueryResult::Status::Timeout) {
+                    timeouts_++;
+                } else {
+                    errors_++;
+                }
+            } else {
+                candidate->state = State::Responded;
+                candidate->token = std::move(token);
+                responses_++;
+                size_t hop = candidate->hop;
+
+                // Bootstrap routers are seeded with placeholder IDs; trust the
+                // ID the node reports and re-sort.
+                if (candidate->node.id != responder.id) {
+                    candidate->node.id = responder.id;
+                    candidate->distance = xor_distance(responder.id, target_);
+                    std::stable_sort(shortlist_.begin(), shortlist_.end(),
+                                     [](const Candidate& a, const Candidate& b) {
+                                         return a.distance < b.distance;
+                                     });
+                    candidate = find_candidate(ip, port);
+                }
+                responder = candidate->node;
+
+                for (const auto& node : referrals) {
+                    add_candidate(node, hop + 1);
+                }
+                for (const auto& peer : values) {
+                    bool known = std::any_of(peers_.begin(), peers_.end(), [&](const Node& p) {
+                        return p.ip == peer.ip && p.port == peer.port;
+                    });
+                    if (!known) {
+                        peers_.push_back(peer);
+                        progress.new_peers.push_back(peer);
+                    }
+                }
+
+                if (options_.on_progress && !finished_) {
+                    std::vector<NodeID> closest_ids;
+                    for (const auto& c : shortlist_) {
+                        if (c.state == State::Responded) {
+                            progress.closest.push_back(c.node);
+                            closest_ids.push_back(c.node.id);
+                            if (closest_ids.size() == options_.k) {
+                                break;
+                            }
+                        }
+                    }
+                    progress.closest_changed = closest_ids != reported_closest_;
+                    if (progress.closest_changed) {
+                        reported_closest_ = std::move(closest_ids);
+                    }
+                    notify = progress.closest_changed || !progress.new_peers.empty();
+                }
+            }
+        }
+
+        if (notify) {
+            options_.on_progress(progress);
+        }
+
+        if (responded) {
+            dht_.add_to_routing_table(responder);
+        }
+        step();
+    }
+
+} // namespace DHT
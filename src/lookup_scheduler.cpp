@@ -0,0 +1,294 @@
+#include "../include/lookup_scheduler.hpp"
+#include "../include/dht_bootstrap.hpp"
+#include <algorithm>
+
+namespace DHT {
+
+    // Sweep stale shared responses and rate-limit entries every this many
+    // new share keys, so the maps stay proportional to recent activity.
+    constexpr size_t PRUNE_INTERVAL = 4096;
+
+    /**
+     * @brief Construct a scheduler. Nothing runs until a lookup is submitted.
+     *
+     * @param dht     The node whose socket and contacts the lookups use.
+     * @param options Budgets and sharing policy.
+     */
+    LookupScheduler::LookupScheduler(DHTBootstrap& dht, const BulkLookupOptions& options)
+        : dht_(dht), options_(options) {
+        if (options_.max_outstanding == 0) {
+            options_.max_outstanding = 1;
+        }
+        options_.shared_prefix_bits = std::min<unsigned>(options_.shared_prefix_bits, NODE_ID_SIZE * 8);
+    }
+
+    /**
+     * @brief Start a lookup whose queries go through the shared budget.
+     *
+     * @param target  The ID to look up.
+     * @param options Per-lookup parallelism, result size and method.
+     * @param done    Invoked once with the result.
+     */
+    void LookupScheduler::lookup(const NodeID& target, const LookupOptions& options, LookupCallback done) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.lookups_active++;
+        }
+
+        auto self = shared_from_this();
+        QuerySender sender = [self](const Node& node, const std::string& method, BencodedDict args,
+                                    QueryCallback callback) {
+            self->send(node, method, std::move(args), std::move(callback));
+        };
+        LookupCallback finished = [self, done = std::move(done)](const LookupResult& result) {
+            {
+                std::lock_guard<std::mutex> lock(self->mutex_);
+                self->stats_.lookups_active--;
+            }
+            if (done) {
+                done(result);
+            }
+        };
+
+        auto engine = std::make_shared<Lookup>(dht_, target, options, std::move(finished), std::move(sender));
+        engine->start(dht_.lookup_seeds(target, options.k));
+    }
+
+    /**
+     * @brief Start a lookup with the node's configured options.
+     */
+    void LookupScheduler::lookup(const NodeID& target, LookupCallback done) {
+        lookup(target, dht_.default_lookup_options(), std::move(done));
+    }
+
+    /**
+     * @brief Start a get_peers lookup through the shared budget.
+     *
+     * @param info_hash The infohash.
+     * @param max_peers Stop once this many distinct peers are known (0: run to
+     *                  convergence).
+     * @param done      Invoked once with the result.
+     */
+    void LookupScheduler::get_peers(const NodeID& info_hash, size_t max_peers, LookupCallback done) {
+        LookupOptions options = dht_.default_lookup_options();
+        options.get_peers = true;
+        options.max_peers = max_peers;
+        lookup(info_hash, options, std::move(done));
+    }
+
+    /**
+     * @brief Current counters.
+     */
+    BulkLookupStats LookupScheduler::stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        BulkLookupStats stats = stats_;
+        stats.queued = queue_.size() + deferred_;
+        return stats;
+    }
+
+    /**
+     * @brief Rate-limit key for a contact: its address and port.
+     */
+    std::string LookupScheduler::contact_key(const Node& node) {
+        return node.ip + ":" + std::to_string(node.port);
+    }
+
+    /**
+     * @brief Key under which a query's answer is shared: the contact, the
+     *        method and the part of the target that determines the answer.
+     *        get_peers answers depend on the exact infohash; find_node answers
+     *        come from the contact's routing table and are the same for
+     *        targets sharing a long prefix.
+     *
+     * @return The key, or an empty string if the query must not be shared.
+     */
+    std::string LookupScheduler::share_key(const Node& node, const std::string& method,
+                                           const BencodedDict& args) const {
+        std::string target;
+        size_t bits = 0;
+        if (method == "get_peers") {
+            auto it = args.find("info_hash");
+            if (it == args.end() || !it->second.isString()) {
+                return {};
+            }
+            target = it->second.asString();
+            bits = target.size() * 8;
+        } else if (method == "find_node") {
+            auto it = args.find("target");
+            if (it == args.end() || !it->second.isString()) {
+                return {};
+            }
+            target = it->second.asString();
+            bits = std::min<size_t>(options_.shared_prefix_bits, target.size() * 8);
+        } else {
+            return {};
+        }
+
+        std::string key = contact_key(node);
+        key.push_back('\0');
+        key += method;
+        key.push_back('\0');
+        key.append(target, 0, bits / 8);
+        if (bits % 8) {
+            key.push_back(static_cast<char>(target[bits / 8] & (0xff << (8 - bits % 8))));
+        }
+        return key;
+    }
+
+    /**
+     * @brief QuerySender for the scheduled lookups: answer from a fresh shared
+     *        response, join an identical query in flight, or queue a new one.
+     */
+    void LookupScheduler::send(const Node& node, const std::string& method, BencodedDict args,
+                               QueryCallback callback) {
+        std::string key = share_key(node, method, args);
+        std::shared_ptr<const QueryResult> reuse;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Clock::time_point now = Clock::now();
+
+            Pending pending{node, method, std::move(args), key, nullptr};
+            if (key.empty()) {
+                pending.callback = std::move(callback);
+            } else {
+                auto it = shared_.find(key);
+                if (it != shared_.end() && it->second.in_flight) {
+                    it->second.waiters.push_back(std::move(callback));
+                    stats_.deduplicated++;
+                    return;
+                }
+                if (it != shared_.end() && now - it->second.answered < options_.response_ttl) {
+                    reuse = it->second.result;
+                    stats_.reused++;
+                } else {
+                    Shared& entry = shared_[key];
+                    entry = Shared{};
+                    entry.waiters.push_back(std::move(callback));
+                    if (++inserts_since_prune_ >= PRUNE_INTERVAL) {
+                        prune(now);
+                    }
+                }
+            }
+
+            if (!reuse) {
+                queue_.push_back(std::move(pending));
+            }
+        }
+
+        if (reuse) {
+            callback(*reuse);
+            return;
+        }
+        pump();
+    }
+
+    /**
+     * @brief Send queued queries while the outstanding budget allows. A query
+     *        to a contact queried less than contact_interval ago is parked on a
+     *        timer and re-queued at the front when the contact may be queried.
+     */
+    void LookupScheduler::pump() {
+        std::vector<Pending> to_send;
+        auto self = shared_from_this();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Clock::time_point now = Clock::now();
+
+            while (stats_.outstanding < options_.max_outstanding && !queue_.empty()) {
+                Pending pending = std::move(queue_.front());
+                queue_.pop_front();
+
+                std::string contact = contact_key(pending.node);
+                auto allowed = next_allowed_.find(contact);
+                if (allowed != next_allowed_.end() && allowed->second > now) {
+                    auto delay = std::chrono::ceil<std::chrono::milliseconds>(allowed->second - now);
+                    auto parked = std::make_shared<Pending>(std::move(pending));
+                    deferred_++;
+                    dht_.schedule(delay, [self, parked]() {
+                        {
+                            std::lock_guard<std::mutex> lock(self->mutex_);
+                            self->deferred_--;
+                            self->queue_.push_front(std::move(*parked));
+                        }
+                        self->pump();
+                    });
+                    continue;
+                }
+
+                next_allowed_[contact] = now + options_.contact_interval;
+                stats_.outstanding++;
+                stats_.sent++;
+                to_send.push_back(std::move(pending));
+            }
+        }
+
+        // Send outside the lock: a failed send calls back synchronously
+        for (auto& pending : to_send) {
+            dht_.send_query(pending.node, pending.method, std::move(pending.args),
+                            [self, key = pending.key, callback = std::move(pending.callback)](const QueryResult& result) {
+                                self->on_response(key, callback, result);
+                            });
+        }
+    }
+
+    /**
+     * @brief Release the query's budget slot, hand the answer to everyone
+     *        waiting for it and keep a successful answer for reuse.
+     *
+     * @param key      Share key, or empty for an unshared query.
+     * @param callback The unshared query's callback.
+     * @param result   The response, error or timeout.
+     */
+    void LookupScheduler::on_response(const std::string& key, const QueryCallback& callback,
+                                      const QueryResult& result) {
+        std::vector<QueryCallback> waiters;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stats_.outstanding--;
+
+            auto it = key.empty() ? shared_.end() : shared_.find(key);
+            if (it != shared_.end()) {
+                waiters = std::move(it->second.waiters);
+                if (result.ok()) {
+                    it->second.waiters.clear();
+                    it->second.in_flight = false;
+                    it->second.result = std::make_shared<const QueryResult>(result);
+                    it->second.answered = Clock::now();
+                } else {
+                    shared_.erase(it);
+                }
+            }
+        }
+
+        if (callback) {
+            callback(result);
+        }
+        for (const auto& waiter : waiters) {
+            waiter(result);
+        }
+        pump();
+    }
+
+    /**
+     * @brief Drop expired shared answers and rate-limit entries that no longer
+     *        hold anything back. Requires mutex_.
+     */
+    void LookupScheduler::prune(Clock::time_point now) {
+        inserts_since_prune_ = 0;
+        for (auto it = shared_.begin(); it != shared_.end();) {
+            if (!it->second.in_flight && now - it->second.answered >= options_.response_ttl) {
+                it = shared_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (auto it = next_allowed_.begin(); it != next_allowed_.end();) {
+            if (it->second <= now) {
+                it = next_allowed_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+} // namespace DHT
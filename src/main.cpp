@@ -9,8 +9,8 @@
      // Create a DHTBootstrap instance
      DHT::DHTBootstrap dht_bootstrap(my_node_id);
  
-     // Add a well-known bootstrap node
-     // dht_bootstrap.add_bootstrap_node("router.bittorrent.com", 6881);
+     // Add well-known bootstrap nodes
+     dht_bootstrap.add_bootstrap_node("router.bittorrent.com", 6881); // Resolved in the background
      dht_bootstrap.add_bootstrap_node("67.215.246.10", 6881);
  
      // Generate a random target Node ID
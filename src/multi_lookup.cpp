@@ -0,0 +1,463 @@
+#include "../include/multi_lookup.hpp"
+#include "../include/dht_bootstrap.hpp"
+#include <algorithm>
+
+namespace DHT {
+
+    constexpr size_t ID_BITS = NODE_ID_SIZE * 8;
+
+    /**
+     * @brief Construct a multi-target lookup. Nothing is sent until start().
+     *
+     * @param dht     The node whose socket and routing table the lookup uses.
+     * @param targets The IDs to look up (duplicates are allowed).
+     * @param options Parallelism and result size per traversal.
+     * @param done    Invoked once when every target has converged.
+     */
+    MultiLookup::MultiLookup(DHTBootstrap& dht, const std::vector<NodeID>& targets, const LookupOptions& options,
+                             MultiLookupCallback done)
+        : dht_(dht), targets_(targets), options_(options), done_(std::move(done)) {
+        if (options_.alpha == 0) {
+            options_.alpha = 1;
+        }
+        if (options_.k == 0) {
+            options_.k = K;
+        }
+        result_.lookups.resize(targets_.size());
+        remaining_ = targets_.size();
+    }
+
+    /**
+     * @brief Seed one group holding every target with the closest known
+     *        contacts of each, and start the traversal.
+     */
+    void MultiLookup::start() {
+        std::vector<Node> seeds;
+        for (const auto& target : targets_) {
+            std::vector<Node> more = dht_.lookup_seeds(target, options_.k);
+            seeds.insert(seeds.end(), more.begin(), more.end());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            started_ = Clock::now();
+            if (!targets_.empty()) {
+                Group root;
+                root.pivot = targets_[0];
+                root.prefix_bits = ID_BITS;
+                for (size_t i = 0; i < targets_.size(); ++i) {
+                    root.targets.push_back(i);
+                    root.prefix_bits = std::min(root.prefix_bits, common_prefix(root.pivot, targets_[i]));
+                }
+                for (const auto& node : seeds) {
+                    add_candidate(root, node, 0);
+                }
+                groups_.push_back(std::move(root));
+            }
+        }
+
+        step();
+    }
+
+    /**
+     * @brief Number of leading bits two IDs have in common.
+     */
+    size_t MultiLookup::common_prefix(const NodeID& a, const NodeID& b) {
+        for (size_t i = 0; i < NODE_ID_SIZE; ++i) {
+            uint8_t diff = a[i] ^ b[i];
+            if (diff) {
+                size_t bits = i * 8;
+                while (!(diff & 0x80)) {
+                    diff <<= 1;
+                    bits++;
+                }
+                return bits;
+            }
+        }
+        return ID_BITS;
+    }
+
+    /**
+     * @brief Key for the queries sent to a contact: its address and port.
+     */
+    std::string MultiLookup::contact_key(const Node& node) {
+        return node.ip + ":" + std::to_string(node.port);
+    }
+
+    /**
+     * @brief Find a query already sent to a contact whose answer also serves
+     *        target: one for the same target, or for a target sharing more
+     *        leading bits with it than the contact does (the contact then
+     *        answers both from the same bucket).
+     *
+     * @param sent   Queries sent to the contact.
+     * @param node   The contact.
+     * @param target The target the caller would query for.
+     *
+     * @return Index into sent, or sent.size() if a new query is needed.
+     */
+    size_t MultiLookup::reusable_query(const std::vector<Query>& sent, const Node& node, const NodeID& target) {
+        size_t contact_bits = common_prefix(node.id, target);
+        for (size_t i = 0; i < sent.size(); ++i) {
+            if (sent[i].target == target || contact_bits < common_prefix(sent[i].target, target)) {
+                return i;
+            }
+        }
+        return sent.size();
+    }
+
+    /**
+     * @brief Insert a contact into a group's shortlist, keeping it sorted by
+     *        distance to the pivot. Known contacts and our own ID are skipped.
+     *        Requires mutex_.
+     */
+    void MultiLookup::add_candidate(Group& group, const Node& node, size_t hop) {
+        if (node.id == dht_.getMyNodeId() || node.port == 0) {
+            return;
+        }
+        for (const auto& candidate : group.shortlist) {
+            if (candidate.node.id == node.id ||
+                (candidate.node.ip == node.ip && candidate.node.port == node.port)) {
+                return;
+            }
+        }
+
+        Candidate candidate;
+        candidate.node = node;
+        candidate.distance = xor_distance(node.id, group.pivot);
+        candidate.hop = hop;
+
+        auto it = std::upper_bound(group.shortlist.begin(), group.shortlist.end(), candidate,
+                                   [](const Candidate& a, const Candidate& b) {
+                                       return a.distance < b.distance;
+                                   });
+        group.shortlist.insert(it, std::move(candidate));
+    }
+
+    /**
+     * @brief Whether the k closest candidates of a group that have not failed
+     *        have all answered. Requires mutex_.
+     */
+    bool MultiLookup::converged(const Group& group) const {
+        size_t answered = 0;
+        for (const auto& candidate : group.shortlist) {
+            if (candidate.state == State::Failed) {
+                continue;
+            }
+            if (candidate.state != State::Responded) {
+                return false;
+            }
+            if (++answered == options_.k) {
+                return true;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Split a group at the first bit its targets differ in. Both halves
+     *        start from a copy of the group's shortlist, re-sorted for their own
+     *        pivot; queries in flight are delivered to both. Requires mutex_.
+     *
+     * @param index The group to split.
+     */
+    void MultiLookup::split(size_t index) {
+        size_t bit = groups_[index].prefix_bits;
+        std::vector<size_t> halves[2];
+        for (size_t t : groups_[index].targets) {
+            halves[(targets_[t][bit / 8] >> (7 - bit % 8)) & 1].push_back(t);
+        }
+
+        for (auto& half : halves) {
+            if (half.empty()) {
+                continue;
+            }
+            const Group& parent = groups_[index];
+            Group child;
+            child.targets = half;
+            child.pivot = targets_[half[0]];
+            child.prefix_bits = ID_BITS;
+            for (size_t t : half) {
+                child.prefix_bits = std::min(child.prefix_bits, common_prefix(child.pivot, targets_[t]));
+            }
+            child.parent = index;
+            child.shortlist = parent.shortlist;
+            for (auto& candidate : child.shortlist) {
+                candidate.distance = xor_distance(candidate.node.id, child.pivot);
+            }
+            std::stable_sort(child.shortlist.begin(), child.shortlist.end(),
+                             [](const Candidate& a, const Candidate& b) {
+                                 return a.distance < b.distance;
+                             });
+            child.in_flight = parent.in_flight;
+
+            groups_.push_back(std::move(child));
+            groups_[index].children.push_back(groups_.size() - 1);
+        }
+    }
+
+    /**
+     * @brief Fold a query outcome into a group, or into every half of it if
+     *        the group has split since the query was sent. Requires mutex_.
+     *
+     * @param index The group.
+     * @param ip    Address of the queried contact.
+     * @param port  Port of the queried contact.
+     * @param query The answered query.
+     */
+    void MultiLookup::deliver(size_t index, const std::string& ip, uint16_t port, const Query& query) {
+        if (!groups_[index].children.empty()) {
+            for (size_t child : groups_[index].children) {
+                deliver(child, ip, port, query);
+            }
+            return;
+        }
+
+        Group& group = groups_[index];
+        if (group.finished) {
+            return;
+        }
+        auto it = std::find_if(group.shortlist.begin(), group.shortlist.end(), [&](const Candidate& c) {
+            return c.node.ip == ip && c.node.port == port;
+        });
+        if (it == group.shortlist.end() || it->state != State::InFlight) {
+            return;
+        }
+        group.in_flight--;
+
+        if (!query.responded) {
+            it->state = State::Failed;
+            if (query.timed_out) {
+                group.timeouts++;
+            } else {
+                group.errors++;
+            }
+            return;
+        }
+        it->state = State::Responded;
+        group.responses++;
+        size_t hop = it->hop;
+
+        // Bootstrap routers are seeded with placeholder IDs
+        if (it->node.id != query.responder) {
+            it->node.id = query.responder;
+            it->distance = xor_distance(query.responder, group.pivot);
+            std::stable_sort(group.shortlist.begin(), group.shortlist.end(),
+                             [](const Candidate& a, const Candidate& b) {
+                                 return a.distance < b.distance;
+                             });
+        }
+
+        for (const auto& node : query.referrals) {
+            add_candidate(group, node, hop + 1);
+        }
+    }
+
+    /**
+     * @brief Record the result of a converged single-target group for each of
+     *        its targets. Query counts include the shared traversal the group
+     *        split from. Requires mutex_.
+     *
+     * @param index The group.
+     */
+    void MultiLookup::finish(size_t index) {
+        Group& group = groups_[index];
+        group.finished = true;
+
+        LookupResult result;
+        for (const auto& candidate : group.shortlist) {
+            if (candidate.state != State::Responded) {
+                continue;
+            }
+            result.closest.push_back(candidate.node);
+            result.hops = std::max(result.hops, candidate.hop + 1);
+            if (result.closest.size() == options_.k) {
+                break;
+            }
+        }
+        for (size_t i = index; i != SIZE_MAX; i = groups_[i].parent) {
+            result.queries += groups_[i].queries;
+            result.responses += groups_[i].responses;
+            result.timeouts += groups_[i].timeouts;
+            result.errors += groups_[i].errors;
+        }
+        result.duration = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - started_);
+
+        for (size_t t : group.targets) {
+            result.target = targets_[t];
+            result_.lookups[t] = result;
+            dht_.closest_cache_.store(result.target, result.closest);
+            remaining_--;
+        }
+    }
+
+    /**
+     * @brief Advance every active group: finish or split it once converged,
+     *        split it when its closest pending contact lies inside its common
+     *        prefix, otherwise top up its queries to alpha, reusing answers
+     *        and queries other groups already have for a contact.
+     */
+    void MultiLookup::step() {
+        struct Outgoing {
+            Node node;
+            NodeID target;
+            size_t slot;
+        };
+        std::vector<Outgoing> to_send;
+        bool report = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (reported_) {
+                return;
+            }
+
+            // Halves appended by split() are visited later in the same pass
+            for (size_t i = 0; i < groups_.size(); ++i) {
+                bool again = true;
+                while (again) {
+                    again = false;
+                    Group& group = groups_[i];
+                    if (group.finished || !group.children.empty()) {
+                        break;
+                    }
+                    bool single = group.prefix_bits >= ID_BITS;
+                    if (converged(group)) {
+                        if (single) {
+                            finish(i);
+                        } else {
+                            split(i);
+                        }
+                        break;
+                    }
+
+                    // Only the k closest live candidates are queried; the
+                    // merged shortlists are long and a slow answer among
+                    // them must not turn the wait into a crawl
+                    std::vector<std::pair<Node, size_t>> answered;  // Reused answers to fold in
+                    bool diverged = false;
+                    size_t live = 0;
+                    for (auto& candidate : group.shortlist) {
+                        if (group.in_flight >= options_.alpha || live == options_.k) {
+                            break;
+                        }
+                        if (candidate.state == State::Failed) {
+                            continue;
+                        }
+                        live++;
+                        if (candidate.state != State::Pending) {
+                            continue;
+                        }
+                        if (!single && common_prefix(candidate.node.id, group.pivot) >= group.prefix_bits) {
+                            diverged = true;
+                            break;
+                        }
+                        candidate.state = State::InFlight;
+                        group.in_flight++;
+
+                        std::vector<Query>& sent = queries_[contact_key(candidate.node)];
+                        size_t slot = reusable_query(sent, candidate.node, group.pivot);
+                        if (slot < sent.size()) {
+                            result_.shared++;
+                            if (sent[slot].answered) {
+                                answered.emplace_back(candidate.node, slot);
+                            } else {
+                                sent[slot].groups.push_back(i);
+                            }
+                        } else {
+                            Query query;
+                            query.target = group.pivot;
+                            query.groups.push_back(i);
+                            sent.push_back(std::move(query));
+                            group.queries++;
+                            result_.queries++;
+                            to_send.push_back({candidate.node, group.pivot, slot});
+                        }
+                    }
+
+                    for (const auto& [node, slot] : answered) {
+                        deliver(i, node.ip, node.port, queries_[contact_key(node)][slot]);
+                    }
+                    if (diverged) {
+                        split(i);
+                    } else {
+                        again = !answered.empty();
+                    }
+                }
+            }
+
+            if (remaining_ == 0) {
+                reported_ = report = true;
+            }
+        }
+
+        if (report) {
+            if (done_) {
+                done_(result_);
+            }
+            return;
+        }
+
+        // Send outside the lock: a failed send calls back synchronously
+        auto self = shared_from_this();
+        for (const auto& outgoing : to_send) {
+            BencodedDict args;
+            args["target"] = BencodedValue(std::string(reinterpret_cast<const char*>(outgoing.target.data()), NODE_ID_SIZE));
+            dht_.send_query(outgoing.node, "find_node", std::move(args),
+                            [self, node = outgoing.node, slot = outgoing.slot](const QueryResult& result) {
+                                self->on_result(node, slot, result);
+                            });
+        }
+    }
+
+    /**
+     * @brief Parse a find_node answer and hand it to every group waiting for
+     *        it.
+     *
+     * @param node   The queried contact.
+     * @param slot   Index of the query among those sent to the contact.
+     * @param result The response, error or timeout.
+     */
+    void MultiLookup::on_result(const Node& node, size_t slot, const QueryResult& result) {
+        std::vector<Node> referrals;
+        Node responder = node;
+        bool responded = false;
+
+        if (result.ok()) {
+            try {
+                const auto& r = result.message.asDict().at("r").asDict();
+                auto nodes_it = r.find("nodes");
+                if (nodes_it != r.end()) {
+                    dht_.parse_compact_nodes(nodes_it->second.asString(), referrals);
+                }
+                auto id_it = r.find("id");
+                if (id_it != r.end() && id_it->second.asString().size() == NODE_ID_SIZE) {
+                    responder.id = dht_.string_to_node_id(id_it->second.asString());
+                    responded = true;
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "[MultiLookup] Malformed response from " << node.ip << ":" << node.port
+                          << ": " << e.what() << '\n';
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Query& query = queries_[contact_key(node)][slot];
+            query.answered = true;
+            query.responded = responded;
+            query.timed_out = result.status == QueryResult::Status::Timeout;
+            query.responder = responder.id;
+            query.referrals = std::move(referrals);
+            for (size_t index : query.groups) {
+                deliver(index, node.ip, node.port, query);
+            }
+            query.groups.clear();
+        }
+
+        if (responded) {
+            dht_.add_to_routing_table(responder);
+        }
+        step();
+    }
+
+} // namespace DHT
@@ -0,0 +1,224 @@
+#include "../include/node_trie.hpp"
+#include <algorithm>
+
+namespace DHT {
+
+    /**
+     * @brief Construct an empty trie.
+     *
+     * @param capacity Maximum number of entries before least-recently-seen
+     *                 unpinned entries are evicted (0 = unbounded).
+     */
+    NodeTrie::NodeTrie(size_t capacity) : capacity_(capacity) {}
+
+    NodeTrie::~NodeTrie() = default;
+
+    /**
+     * @brief Value of a single bit of an ID, most significant bit first.
+     */
+    int NodeTrie::bit_at(const NodeID& id, size_t bit) {
+        return (id[bit / 8] >> (7 - bit % 8)) & 1;
+    }
+
+    /**
+     * @brief Index of the first bit where two IDs differ (MSB first).
+     *
+     * @return The bit index, or NODE_ID_SIZE * 8 if the IDs are equal.
+     */
+    size_t NodeTrie::first_diff_bit(const NodeID& a, const NodeID& b) {
+        for (size_t i = 0; i < NODE_ID_SIZE; ++i) {
+            uint8_t diff = a[i] ^ b[i];
+            if (diff) {
+                size_t bit = i * 8;
+                while (!(diff & 0x80)) {
+                    diff <<= 1;
+                    bit++;
+                }
+                return bit;
+            }
+        }
+        return NODE_ID_SIZE * 8;
+    }
+
+    /**
+     * @brief Follow the branching bits of an ID down to a leaf. The leaf is the
+     *        only possible match, but it may hold a different ID.
+     */
+    NodeTrie::TrieNode* NodeTrie::find_leaf(const NodeID& id) const {
+        TrieNode* n = root_.get();
+        while (n && !n->leaf) {
+            n = n->child[bit_at(id, n->bit)].get();
+        }
+        return n;
+    }
+
+    /**
+     * @brief Insert a node, or update its address and mark it as recently seen
+     *        if the ID is already present.
+     *
+     * @param node The node to insert.
+     *
+     * @return True if the ID was not in the trie before.
+     */
+    bool NodeTrie::insert(const Node& node) {
+        TrieNode* nearest = find_leaf(node.id);
+        if (nearest && nearest->node.id == node.id) {
+            nearest->node = node;
+            if (nearest->pins == 0) {
+                lru_.splice(lru_.end(), lru_, nearest->lru);
+            }
+            return false;
+        }
+
+        auto leaf = std::make_unique<TrieNode>();
+        leaf->leaf = true;
+        leaf->node = node;
+        leaf->lru = lru_.insert(lru_.end(), node.id);
+
+        if (!root_) {
+            root_ = std::move(leaf);
+        } else {
+            size_t diff = first_diff_bit(node.id, nearest->node.id);
+
+            // Descend to the first edge that skips past the differing bit
+            std::unique_ptr<TrieNode>* slot = &root_;
+            while (!(*slot)->leaf && (*slot)->bit < diff) {
+                slot = &(*slot)->child[bit_at(node.id, (*slot)->bit)];
+            }
+
+            auto branch = std::make_unique<TrieNode>();
+            branch->bit = diff;
+            int side = bit_at(node.id, diff);
+            branch->child[side] = std::move(leaf);
+            branch->child[1 - side] = std::move(*slot);
+            *slot = std::move(branch);
+        }
+
+        size_++;
+        evict_if_needed();
+        return true;
+    }
+
+    /**
+     * @brief Remove an ID from the trie.
+     *
+     * @return True if the ID was present.
+     */
+    bool NodeTrie::erase(const NodeID& id) {
+        std::unique_ptr<TrieNode>* parent = nullptr;
+        std::unique_ptr<TrieNode>* slot = &root_;
+        while (*slot && !(*slot)->leaf) {
+            parent = slot;
+            slot = &(*slot)->child[bit_at(id, (*slot)->bit)];
+        }
+        if (!*slot || (*slot)->node.id != id) {
+            return false;
+        }
+
+        if ((*slot)->pins == 0) {
+            lru_.erase((*slot)->lru);
+        }
+
+        if (!parent) {
+            root_.reset();
+        } else {
+            // Replace the parent branch with the leaf's sibling
+            TrieNode* branch = parent->get();
+            int side = bit_at(id, branch->bit);
+            std::unique_ptr<TrieNode> sibling = std::move(branch->child[1 - side]);
+            *parent = std::move(sibling);
+        }
+
+        size_--;
+        return true;
+    }
+
+    /**
+     * @brief Check whether an ID is present.
+     */
+    bool NodeTrie::contains(const NodeID& id) const {
+        TrieNode* leaf = find_leaf(id);
+        return leaf && leaf->node.id == id;
+    }
+
+    /**
+     * @brief Exempt an entry from eviction. Pins are counted, so an entry stays
+     *        pinned until every pin() has been matched by an unpin().
+     */
+    void NodeTrie::pin(const NodeID& id) {
+        TrieNode* leaf = find_leaf(id);
+        if (!leaf || leaf->node.id != id) {
+            return;
+        }
+        if (leaf->pins++ == 0) {
+            lru_.erase(leaf->lru);
+        }
+    }
+
+    /**
+     * @brief Release one pin. The entry becomes evictable again (as most
+     *        recently seen) when its last pin is released.
+     */
+    void NodeTrie::unpin(const NodeID& id) {
+        TrieNode* leaf = find_leaf(id);
+        if (!leaf || leaf->node.id != id || leaf->pins == 0) {
+            return;
+        }
+        if (--leaf->pins == 0) {
+            leaf->lru = lru_.insert(lru_.end(), id);
+            evict_if_needed();
+        }
+    }
+
+    /**
+     * @brief Drop least-recently-seen unpinned entries until within capacity.
+     */
+    void NodeTrie::evict_if_needed() {
+        while (capacity_ != 0 && size_ > capacity_ && !lru_.empty()) {
+            NodeID oldest = lru_.front();
+            erase(oldest);
+        }
+    }
+
+    /**
+     * @brief Depth-first traversal visiting the subtree on the target's side of
+     *        every branch first, which emits leaves in increasing XOR distance.
+     */
+    void NodeTrie::collect(const TrieNode* n, const NodeID& target_id, size_t k,
+                           std::vector<Node>& out) const {
+        if (!n || out.size() >= k) {
+            return;
+        }
+        if (n->leaf) {
+            out.push_back(n->node);
+            return;
+        }
+        int side = bit_at(target_id, n->bit);
+        collect(n->child[side].get(), target_id, k, out);
+        collect(n->child[1 - side].get(), target_id, k, out);
+    }
+
+    /**
+     * @brief Find the k entries closest to a target by XOR distance.
+     *
+     * @param target_id The NodeID we want to find.
+     * @param k         The maximum number of nodes to return.
+     *
+     * @return Up to k nodes, closest first.
+     */
+    std::vector<Node> NodeTrie::closest(const NodeID& target_id, size_t k) const {
+        std::vector<Node> out;
+        out.reserve(std::min(k, size_));
+        collect(root_.get(), target_id, k, out);
+        return out;
+    }
+
+    /**
+     * @brief Every entry in the trie, in ID order.
+     */
+    std::vector<Node> NodeTrie::all() const {
+        NodeID zero{};
+        return closest(zero, size_);
+    }
+
+} // namespace DHT
@@ -0,0 +1,131 @@
+#include "../include/packet_pool.hpp"
+#include <algorithm>
+
+namespace DHT {
+
+    Packet::Packet(PacketPool* pool, char* data, size_t capacity)
+        : pool_(pool), data_(data), size_(capacity), capacity_(capacity) {}
+
+    Packet::~Packet() {
+        reset();
+    }
+
+    Packet::Packet(Packet&& other) noexcept
+        : pool_(other.pool_), data_(other.data_), size_(other.size_), capacity_(other.capacity_) {
+        other.pool_ = nullptr;
+        other.data_ = nullptr;
+        other.size_ = other.capacity_ = 0;
+    }
+
+    Packet& Packet::operator=(Packet&& other) noexcept {
+        if (this != &other) {
+            reset();
+            pool_ = other.pool_;
+            data_ = other.data_;
+            size_ = other.size_;
+            capacity_ = other.capacity_;
+            other.pool_ = nullptr;
+            other.data_ = nullptr;
+            other.size_ = other.capacity_ = 0;
+        }
+        return *this;
+    }
+
+    void Packet::resize(size_t size) {
+        size_ = std::min(size, capacity_);
+    }
+
+    /**
+     * @brief Give the buffer back to its pool (or free it, if it came from
+     *        the heap). The packet is empty afterwards.
+     */
+    void Packet::reset() {
+        if (data_ != nullptr) {
+            if (pool_ != nullptr) {
+                pool_->release(data_);
+            } else {
+                delete[] data_;
+            }
+        }
+        pool_ = nullptr;
+        data_ = nullptr;
+        size_ = capacity_ = 0;
+    }
+
+    /**
+     * @param packet_size      Bytes per pooled buffer.
+     * @param capacity         Most pooled buffers ever allocated.
+     * @param packets_per_slab Buffers allocated together when the pool grows.
+     */
+    PacketPool::PacketPool(size_t packet_size, size_t capacity, size_t packets_per_slab)
+        : packet_size_(std::max<size_t>(packet_size, 1)), capacity_(capacity),
+          packets_per_slab_(std::max<size_t>(packets_per_slab, 1)) {}
+
+    /**
+     * @brief Take a free buffer, growing the pool by a slab if none is left.
+     *        Past capacity, or for sizes above packet_size, the buffer comes
+     *        from the heap and the matching counter is bumped.
+     *
+     * @param size Bytes needed (0 = packet_size).
+     */
+    Packet PacketPool::acquire(size_t size) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (size <= packet_size_) {
+                if (free_.empty()) {
+                    grow();
+                }
+                if (!free_.empty()) {
+                    char* data = free_.back();
+                    free_.pop_back();
+                    stats_.in_use++;
+                    stats_.high_water = std::max(stats_.high_water, stats_.in_use);
+                    return Packet(this, data, packet_size_);
+                }
+                stats_.exhausted++;
+            } else {
+                stats_.oversize++;
+            }
+        }
+        size_t capacity = std::max(size, packet_size_);
+        return Packet(nullptr, new char[capacity], capacity);
+    }
+
+    /**
+     * @brief Counters so far.
+     */
+    PacketPool::Stats PacketPool::stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+    void PacketPool::release(char* data) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(data);
+        stats_.in_use--;
+    }
+
+    /**
+     * @brief Allocate one more slab, on the caller's NUMA node, and add its
+     *        buffers to the free list.
+     *
+     * @return False if the pool is at capacity.
+     */
+    bool PacketPool::grow() {
+        size_t count = std::min(packets_per_slab_, capacity_ - stats_.packets);
+        if (count == 0) {
+            return false;
+        }
+        LocalBuffer slab(count * packet_size_, numa_node_of_cpu(current_cpu()));
+        if (slab.data() == nullptr) {
+            return false;
+        }
+        for (size_t i = count; i-- > 0;) {
+            free_.push_back(slab.data() + i * packet_size_);
+        }
+        slabs_.push_back(std::move(slab));
+        stats_.packets += count;
+        return true;
+    }
+
+} // namespace DHT
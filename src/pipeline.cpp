@@ -0,0 +1,239 @@
+#include "../include/pipeline.hpp"
+#include "../include/cpu_placement.hpp"
+#include "../include/event_loop.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <iostream>
+
+namespace DHT {
+
+    namespace {
+
+        thread_local Pipeline* current_pipeline = nullptr;
+        thread_local PacketPool* current_pool = nullptr;
+        thread_local SpscRing<Datagram>* current_outbox = nullptr;
+
+        bool would_block() {
+#ifdef _WIN32
+            int error = WSAGetLastError();
+            return error == WSAEWOULDBLOCK || error == WSAEINTR;
+#else
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+        }
+
+        void place_stage(const char* stage, int cpu) {
+            if (cpu >= 0 && !pin_current_thread(cpu)) {
+                std::cerr << "[Pipeline] Failed to pin " << stage << " to CPU " << cpu << '\n';
+            }
+        }
+
+    } // namespace
+
+    /**
+     * @param sock          The socket the send stage writes to (not owned).
+     * @param workers       Parse/handle stages (at least one).
+     * @param ring_capacity Datagrams per ring, rounded up to a power of two.
+     * @param send_batch    Datagrams per sendmmsg().
+     * @param packet_size   Pooled buffer size for replies.
+     * @param pool_capacity Pooled buffers per worker.
+     */
+    Pipeline::Pipeline(int sock, size_t workers, size_t ring_capacity, size_t send_batch,
+                       size_t packet_size, size_t pool_capacity)
+        : sock_(sock), send_batch_size_(std::max<size_t>(send_batch, 1)) {
+        for (size_t i = 0; i < std::max<size_t>(workers, 1); ++i) {
+            workers_.push_back(std::make_unique<Worker>(ring_capacity, packet_size, pool_capacity));
+        }
+    }
+
+    Pipeline::~Pipeline() {
+        stop();
+    }
+
+    /**
+     * @brief Start the workers and the send stage.
+     *
+     * @param cpus    CPU per stage: workers first, then the send stage
+     *                (missing entries leave the stage unpinned).
+     * @param handler Called on a worker for every datagram submitted.
+     */
+    void Pipeline::start(const std::vector<int>& cpus, DatagramHandler handler) {
+        if (send_thread_.joinable()) {
+            return;
+        }
+        handler_ = std::move(handler);
+        stopping_.store(false);
+        auto cpu_for = [&](size_t stage) { return stage < cpus.size() ? cpus[stage] : -1; };
+        for (size_t i = 0; i < workers_.size(); ++i) {
+            workers_[i]->thread = std::thread([this, i, cpu = cpu_for(i)]() { work(i, cpu); });
+        }
+        send_thread_ = std::thread([this, cpu = cpu_for(workers_.size())]() { send_loop(cpu); });
+    }
+
+    /**
+     * @brief Stop every stage. Datagrams still in the rings are dropped
+     *        (their packets go back to their pools).
+     */
+    void Pipeline::stop() {
+        if (!send_thread_.joinable()) {
+            return;
+        }
+        stopping_.store(true);
+        for (auto& worker : workers_) {
+            worker->inbox_bell.ring();
+        }
+        for (auto& worker : workers_) {
+            worker->thread.join();
+        }
+        send_bell_.ring();
+        send_thread_.join();
+        for (auto& worker : workers_) {
+            while (worker->inbox.pop() || worker->outbox.pop()) {
+            }
+        }
+    }
+
+    /**
+     * @brief Route a received datagram to a worker by its sender's address.
+     *
+     * @param packet The datagram, moved in without copying.
+     * @param sender Where it came from.
+     *
+     * @return False if the worker's ring is full; the datagram is dropped.
+     */
+    bool Pipeline::submit(Packet packet, const sockaddr_in& sender) {
+        uint64_t key = (static_cast<uint64_t>(sender.sin_addr.s_addr) << 16) | sender.sin_port;
+        key *= 0x9e3779b97f4a7c15ULL;
+        Worker& worker = *workers_[(key >> 32) % workers_.size()];
+
+        Datagram datagram{std::move(packet), sender};
+        if (!worker.inbox.push(datagram)) {
+            receive_drops_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        worker.inbox_bell.ring();
+        return true;
+    }
+
+    /**
+     * @brief Hand a reply from the calling worker to the send stage.
+     *
+     * @return False if the worker's outbound ring is full (the socket has
+     *         been backed up for a while); the datagram is dropped.
+     */
+    bool Pipeline::send(Packet data, const sockaddr_in& addr) {
+        Datagram datagram{std::move(data), addr};
+        if (current_outbox == nullptr || !current_outbox->push(datagram)) {
+            send_drops_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        send_bell_.ring();
+        return true;
+    }
+
+    PacketPool& Pipeline::packet_pool() {
+        return *current_pool;
+    }
+
+    /**
+     * @brief Counters so far.
+     */
+    Pipeline::Stats Pipeline::stats() const {
+        Stats stats;
+        stats.handled = handled_.load(std::memory_order_relaxed);
+        stats.sent = sent_.load(std::memory_order_relaxed);
+        stats.receive_drops = receive_drops_.load(std::memory_order_relaxed);
+        stats.send_drops = send_drops_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    Pipeline* Pipeline::current() {
+        return current_pipeline;
+    }
+
+    /**
+     * @brief Parse/handle stage: pop datagrams and run the handler on them.
+     *        When the ring runs dry the worker spins briefly, then sleeps
+     *        on its doorbell.
+     */
+    void Pipeline::work(size_t index, int cpu) {
+        Worker& worker = *workers_[index];
+        current_pipeline = this;
+        current_pool = &worker.pool;
+        current_outbox = &worker.outbox;
+        place_stage("parse worker", cpu);
+
+        int idle = 0;
+        while (!stopping_.load(std::memory_order_relaxed)) {
+            uint32_t ticket = worker.inbox_bell.ticket();
+            std::optional<Datagram> datagram = worker.inbox.pop();
+            if (!datagram) {
+                if (++idle < IDLE_SPINS) {
+                    std::this_thread::yield();
+                } else {
+                    worker.inbox_bell.wait(ticket);
+                    idle = 0;
+                }
+                continue;
+            }
+            idle = 0;
+            handler_(datagram->data.data(), datagram->data.size(), datagram->addr);
+            handled_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        current_pipeline = nullptr;
+        current_pool = nullptr;
+        current_outbox = nullptr;
+    }
+
+    /**
+     * @brief Send stage: gather replies from every worker's ring, up to a
+     *        batch, and send them with one sendmmsg(). While the socket is
+     *        full nothing more is taken, so the rings fill up and workers
+     *        see the backpressure as send drops.
+     */
+    void Pipeline::send_loop(int cpu) {
+        place_stage("send stage", cpu);
+        SendBatch batch(send_batch_size_);
+        std::deque<Datagram> queue;
+
+        int idle = 0;
+        while (!stopping_.load(std::memory_order_relaxed)) {
+            uint32_t ticket = send_bell_.ticket();
+            for (auto& worker : workers_) {
+                while (queue.size() < send_batch_size_) {
+                    std::optional<Datagram> datagram = worker->outbox.pop();
+                    if (!datagram) {
+                        break;
+                    }
+                    queue.push_back(std::move(*datagram));
+                }
+            }
+            if (queue.empty()) {
+                if (++idle < IDLE_SPINS) {
+                    std::this_thread::yield();
+                } else {
+                    send_bell_.wait(ticket);
+                    idle = 0;
+                }
+                continue;
+            }
+            idle = 0;
+
+            int sent = batch.send(sock_, queue);
+            if (sent < 0) {
+                if (would_block()) {
+                    wait_writable(sock_, std::chrono::milliseconds(SEND_WAIT_MS));
+                    continue;
+                }
+                std::cerr << "[Pipeline] sendmmsg failed! errno: " << strerror(errno) << '\n';
+                sent = 1;
+            }
+            sent_.fetch_add(static_cast<uint64_t>(sent), std::memory_order_relaxed);
+            queue.erase(queue.begin(), queue.begin() + sent);
+        }
+    }
+
+} // namespace DHT
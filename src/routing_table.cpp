@@ -0,0 +1,229 @@
+#include "../include/routing_table.hpp"
+#include <algorithm>
+#include <random>
+
+namespace DHT {
+
+    /**
+     * @brief Construct an empty routing table with a single bucket.
+     *
+     * @param self_id The local node's ID, used to compute bucket indices.
+     */
+    RoutingTable::RoutingTable(const NodeID& self_id)
+        : self_id_(self_id), current_(new Table(1)) {}
+
+    /**
+     * @brief Destroy the table. No reader may be inside read() at this point.
+     */
+    RoutingTable::~RoutingTable() {
+        delete current_.load();
+    }
+
+    /**
+     * @brief Index of the bucket a node belongs in, based on the XOR distance
+     *        bits between our ID and the node's ID.
+     *
+     * @param id The NodeID being placed.
+     *
+     * @return The bucket index (may equal the current bucket count).
+     */
+    size_t RoutingTable::bucket_index(const NodeID& id) const {
+        NodeID distance = xor_distance(self_id_, id);
+        const Table& table = *current_.load();
+        size_t index = 0;
+        while (index < table.size() &&
+               (distance[index / 8] & (1 << (index % 8)))) {
+            index++;
+        }
+        return index;
+    }
+
+    /**
+     * @brief A random ID that bucket_index() places in the given bucket once
+     *        the table has that many buckets: the first index distance bits
+     *        are set, the next one is clear, the rest are random.
+     *
+     * @param index The bucket to refresh.
+     *
+     * @return The ID, suitable as a lookup target.
+     */
+    NodeID RoutingTable::random_id_in_bucket(size_t index) const {
+        static thread_local std::mt19937 rng(std::random_device{}());
+        std::uniform_int_distribution<int> byte(0, 255);
+
+        NodeID distance;
+        for (auto& b : distance) {
+            b = static_cast<uint8_t>(byte(rng));
+        }
+        index = std::min(index, NODE_ID_SIZE * 8 - 1);
+        for (size_t bit = 0; bit < index; ++bit) {
+            distance[bit / 8] |= static_cast<uint8_t>(1 << (bit % 8));
+        }
+        distance[index / 8] &= static_cast<uint8_t>(~(1 << (index % 8)));
+        return xor_distance(self_id_, distance);
+    }
+
+    /**
+     * @brief Swap in a new table version and retire the old one.
+     *
+     * @param next The fully built replacement table.
+     */
+    void RoutingTable::publish(const Table* next) {
+        const Table* previous = current_.exchange(next);
+        EpochDomain::global().retire([previous]() { delete previous; });
+    }
+
+    /**
+     * @brief Add a node to the table, or refresh it if already present.
+     *
+     * @param node   The node to add.
+     * @param oldest [out] Optional; receives the least-recently-seen node of a
+     *               full bucket so the caller can ping it outside the lock.
+     *
+     * @return What happened to the node.
+     */
+    RoutingTable::InsertResult RoutingTable::insert(const Node& node, Node* oldest) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+
+        size_t index = bucket_index(node.id);
+        const Table& current = *current_.load();
+
+        if (index < current.size()) {
+            const Bucket& bucket = current[index];
+            if (std::find(bucket.begin(), bucket.end(), node) == bucket.end() &&
+                bucket.size() >= K) {
+                if (oldest) {
+                    *oldest = bucket.front();
+                }
+                return InsertResult::BucketFull;
+            }
+        }
+
+        auto* next = new Table(current);
+        if (index >= next->size()) {
+            next->emplace_back();
+        }
+
+        Bucket& bucket = (*next)[index];
+        InsertResult result = InsertResult::Added;
+        auto it = std::find(bucket.begin(), bucket.end(), node);
+        if (it != bucket.end()) {
+            // Move node to the back (most recently seen)
+            std::rotate(it, it + 1, bucket.end());
+            result = InsertResult::Refreshed;
+        } else {
+            bucket.push_back(node);
+        }
+
+        publish(next);
+        return result;
+    }
+
+    /**
+     * @brief Move a known node to the most-recently-seen end of its bucket.
+     *
+     * @param node The node that just proved to be alive.
+     */
+    void RoutingTable::touch(const Node& node) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+
+        size_t index = bucket_index(node.id);
+        const Table& current = *current_.load();
+        if (index >= current.size()) {
+            return;
+        }
+        const Bucket& bucket = current[index];
+        if (std::find(bucket.begin(), bucket.end(), node) == bucket.end()) {
+            return;
+        }
+
+        auto* next = new Table(current);
+        Bucket& next_bucket = (*next)[index];
+        auto it = std::find(next_bucket.begin(), next_bucket.end(), node);
+        std::rotate(it, it + 1, next_bucket.end());
+        publish(next);
+    }
+
+    /**
+     * @brief Replace an unresponsive node with a fresh one (Kademlia eviction).
+     *
+     * @param stale The node that failed to answer a ping.
+     * @param fresh The node waiting for a slot.
+     *
+     * @return True if the replacement happened; false if the table changed in
+     *         the meantime and stale is no longer present.
+     */
+    bool RoutingTable::replace(const Node& stale, const Node& fresh) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+
+        size_t index = bucket_index(stale.id);
+        const Table& current = *current_.load();
+        if (index >= current.size()) {
+            return false;
+        }
+        const Bucket& bucket = current[index];
+        if (std::find(bucket.begin(), bucket.end(), stale) == bucket.end() ||
+            std::find(bucket.begin(), bucket.end(), fresh) != bucket.end()) {
+            return false;
+        }
+
+        auto* next = new Table(current);
+        Bucket& next_bucket = (*next)[index];
+        auto it = std::find(next_bucket.begin(), next_bucket.end(), stale);
+        next_bucket.erase(it);
+        next_bucket.push_back(fresh);
+        publish(next);
+        return true;
+    }
+
+    /**
+     * @brief Find the K closest nodes in the table to a given target ID.
+     *
+     * @param target_id The NodeID we want to find.
+     * @param k         The maximum number of closest nodes to return.
+     *
+     * @return A vector of up to k closest Node objects.
+     */
+    std::vector<Node> RoutingTable::find_closest(const NodeID& target_id, size_t k) const {
+        std::vector<Node> closest_nodes = read([](const Table& table) {
+            std::vector<Node> nodes;
+            for (const auto& bucket : table) {
+                nodes.insert(nodes.end(), bucket.begin(), bucket.end());
+            }
+            return nodes;
+        });
+
+        auto by_distance = [&](const Node& a, const Node& b) {
+            return xor_distance(a.id, target_id) < xor_distance(b.id, target_id);
+        };
+        if (closest_nodes.size() > k) {
+            std::partial_sort(closest_nodes.begin(), closest_nodes.begin() + k,
+                              closest_nodes.end(), by_distance);
+            closest_nodes.resize(k);
+        } else {
+            std::sort(closest_nodes.begin(), closest_nodes.end(), by_distance);
+        }
+        return closest_nodes;
+    }
+
+    /**
+     * @brief Copy of the current table snapshot.
+     */
+    RoutingTable::Table RoutingTable::copy() const {
+        return read([](const Table& table) { return table; });
+    }
+
+    /**
+     * @brief Total number of nodes across all buckets.
+     */
+    size_t RoutingTable::size() const {
+        return read([](const Table& table) {
+            size_t total = 0;
+            for (const auto& bucket : table) {
+                total += bucket.size();
+            }
+            return total;
+        });
+    }
+
+} // namespace DHT
@@ -0,0 +1,137 @@
+#include "../include/rtt_estimator.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace DHT {
+
+    // Jacobson/Karels gains (RFC 6298)
+    constexpr double RTT_ALPHA = 1.0 / 8.0;
+    constexpr double RTT_BETA = 1.0 / 4.0;
+    constexpr unsigned MAX_BACKOFF = 6;
+
+    /**
+     * @brief Construct an estimator.
+     *
+     * @param initial      Timeout used before any sample exists.
+     * @param min_timeout  Lower bound on any computed timeout.
+     * @param max_timeout  Upper bound on any computed timeout (also caps backoff).
+     * @param max_contacts Per-contact estimates kept before old ones are dropped.
+     */
+    RttEstimator::RttEstimator(Duration initial, Duration min_timeout, Duration max_timeout,
+                               size_t max_contacts)
+        : initial_(initial), min_timeout_(min_timeout), max_timeout_(max_timeout),
+          max_contacts_(max_contacts) {}
+
+    /**
+     * @brief Fold one RTT measurement into an estimate.
+     */
+    void RttEstimator::update(Estimate& estimate, double rtt_ms) {
+        if (!estimate.valid) {
+            estimate.srtt = rtt_ms;
+            estimate.rttvar = rtt_ms / 2;
+            estimate.valid = true;
+        } else {
+            estimate.rttvar = (1 - RTT_BETA) * estimate.rttvar + RTT_BETA * std::fabs(estimate.srtt - rtt_ms);
+            estimate.srtt = (1 - RTT_ALPHA) * estimate.srtt + RTT_ALPHA * rtt_ms;
+        }
+        estimate.backoff = 0;
+    }
+
+    /**
+     * @brief Retransmission timeout for an estimate: SRTT + 4 * RTTVAR, doubled
+     *        per consecutive timeout, clamped to [min_timeout, max_timeout].
+     */
+    RttEstimator::Duration RttEstimator::rto(const Estimate& estimate) const {
+        double timeout_ms = estimate.valid ? estimate.srtt + 4 * estimate.rttvar
+                                           : static_cast<double>(initial_.count());
+        timeout_ms *= static_cast<double>(1u << std::min(estimate.backoff, MAX_BACKOFF));
+        timeout_ms = std::clamp(timeout_ms, static_cast<double>(min_timeout_.count()),
+                                static_cast<double>(max_timeout_.count()));
+        return Duration(static_cast<Duration::rep>(timeout_ms));
+    }
+
+    /**
+     * @brief Record that a query to ip:port was answered after rtt.
+     *
+     * @param ip   Contact IPv4 address (network byte order).
+     * @param port Contact port.
+     * @param rtt  Measured round-trip time.
+     */
+    void RttEstimator::sample(uint32_t ip, uint16_t port, Duration rtt) {
+        double rtt_ms = static_cast<double>(rtt.count());
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        update(global_, rtt_ms);
+
+        if (recent_.size() < RECENT_SAMPLES) {
+            recent_.push_back(rtt.count());
+        } else {
+            recent_[recent_next_] = rtt.count();
+            recent_next_ = (recent_next_ + 1) % RECENT_SAMPLES;
+        }
+
+        auto it = contacts_.find(key(ip, port));
+        if (it == contacts_.end()) {
+            if (contacts_.size() >= max_contacts_) {
+                contacts_.erase(contacts_.begin());
+            }
+            it = contacts_.emplace(key(ip, port), Estimate{}).first;
+        }
+        update(it->second, rtt_ms);
+    }
+
+    /**
+     * @brief Record that a query to ip:port got no answer. Backs off only that
+     *        contact's timeout; one dead node must not slow every lookup down.
+     */
+    void RttEstimator::timed_out(uint32_t ip, uint16_t port) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = contacts_.find(key(ip, port));
+        if (it != contacts_.end() && it->second.backoff < MAX_BACKOFF) {
+            it->second.backoff++;
+        }
+    }
+
+    /**
+     * @brief Deadline to use for the next query to ip:port. Contacts without a
+     *        sample of their own get the global estimate.
+     */
+    RttEstimator::Duration RttEstimator::timeout_for(uint32_t ip, uint16_t port) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = contacts_.find(key(ip, port));
+        if (it != contacts_.end()) {
+            return rto(it->second);
+        }
+        return rto(global_);
+    }
+
+    /**
+     * @brief Deadline for a contact we know nothing about.
+     */
+    RttEstimator::Duration RttEstimator::global_timeout() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return rto(global_);
+    }
+
+    /**
+     * @brief Percentile of the most recent RTT samples.
+     *
+     * @param p Fraction in [0, 1], e.g. 0.9 for p90.
+     *
+     * @return The percentile, or zero if fewer than MIN_PERCENTILE_SAMPLES exist.
+     */
+    RttEstimator::Duration RttEstimator::percentile(double p) const {
+        std::vector<Duration::rep> samples;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (recent_.size() < MIN_PERCENTILE_SAMPLES) {
+                return Duration(0);
+            }
+            samples = recent_;
+        }
+        size_t index = static_cast<size_t>(std::clamp(p, 0.0, 1.0) * (samples.size() - 1));
+        std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+        return Duration(std::max<Duration::rep>(samples[index], 1));
+    }
+
+} // namespace DHT
@@ -0,0 +1,257 @@
+#include "../include/shared_contacts.hpp"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#ifndef _WIN32
+    #include <arpa/inet.h>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace DHT {
+
+    SharedContacts::~SharedContacts() {
+        close();
+    }
+
+    /**
+     * @brief Wall-clock seconds; comparable across processes on the same host.
+     */
+    uint64_t SharedContacts::now_seconds() {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief Create the named shared-memory segment, or attach to it if a
+     *        sibling process already created it. An existing segment keeps its
+     *        original capacity.
+     *
+     * @param name     POSIX shared memory name, e.g. "/dht-contacts".
+     * @param capacity Number of contact slots when creating the segment.
+     *
+     * @return True if the segment is mapped and ready.
+     */
+    bool SharedContacts::open(const std::string& name, size_t capacity) {
+#ifdef _WIN32
+        (void)name;
+        (void)capacity;
+        std::cerr << "Shared contact table is not supported on Windows" << '\n';
+        return false;
+#else
+        close();
+
+        bool creator = true;
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0 && errno == EEXIST) {
+            creator = false;
+            fd = shm_open(name.c_str(), O_RDWR, 0600);
+        }
+        if (fd < 0) {
+            std::cerr << "shm_open failed! errno: " << strerror(errno) << '\n';
+            return false;
+        }
+
+        if (!creator) {
+            // Wait (briefly) for the creator to size and initialize the segment
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            while (true) {
+                struct stat st{};
+                if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(Header)) {
+                    void* probe = mmap(nullptr, sizeof(Header), PROT_READ, MAP_SHARED, fd, 0);
+                    if (probe != MAP_FAILED) {
+                        auto* header = static_cast<Header*>(probe);
+                        bool ready = header->magic.load(std::memory_order_acquire) == MAGIC;
+                        capacity = header->capacity;
+                        munmap(probe, sizeof(Header));
+                        if (ready) {
+                            break;
+                        }
+                    }
+                }
+                if (std::chrono::steady_clock::now() > deadline) {
+                    std::cerr << "Shared contact table " << name << " was never initialized" << '\n';
+                    ::close(fd);
+                    return false;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+
+        size_t size = sizeof(Header) + capacity * sizeof(Slot);
+        if (creator && ftruncate(fd, static_cast<off_t>(size)) < 0) {
+            std::cerr << "ftruncate failed! errno: " << strerror(errno) << '\n';
+            ::close(fd);
+            shm_unlink(name.c_str());
+            return false;
+        }
+
+        void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) {
+            std::cerr << "mmap failed! errno: " << strerror(errno) << '\n';
+            return false;
+        }
+
+        header_ = static_cast<Header*>(base);
+        slots_ = reinterpret_cast<Slot*>(static_cast<char*>(base) + sizeof(Header));
+        capacity_ = capacity;
+        mapped_size_ = size;
+
+        if (creator) {
+            // ftruncate zero-fills: every slot starts empty with an even sequence
+            header_->capacity = capacity;
+            header_->magic.store(MAGIC, std::memory_order_release);
+        }
+        return true;
+#endif
+    }
+
+    /**
+     * @brief Unmap the segment. The segment itself persists for siblings.
+     */
+    void SharedContacts::close() {
+#ifndef _WIN32
+        if (header_) {
+            munmap(header_, mapped_size_);
+        }
+#endif
+        header_ = nullptr;
+        slots_ = nullptr;
+        capacity_ = 0;
+        mapped_size_ = 0;
+    }
+
+    /**
+     * @brief Read a slot consistently under its sequence lock.
+     *
+     * @param slot      The slot to read.
+     * @param node      [out] The stored contact.
+     * @param last_seen [out] When the contact was last published (0 = empty).
+     *
+     * @return False if the slot stayed busy (writer inside or crashed).
+     */
+    bool SharedContacts::read_slot(const Slot& slot, Node& node, uint64_t& last_seen) const {
+        for (int attempt = 0; attempt < 4; ++attempt) {
+            uint64_t before = slot.seq.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+            uint64_t words[5];
+            for (size_t i = 0; i < 5; ++i) {
+                words[i] = slot.words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.seq.load(std::memory_order_relaxed) != before) {
+                continue;
+            }
+
+            last_seen = words[4];
+            std::memcpy(node.id.data(), words, NODE_ID_SIZE);
+#ifndef _WIN32
+            uint32_t ip_binary = static_cast<uint32_t>(words[3] >> 16);
+            char ip_str[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &ip_binary, ip_str, sizeof(ip_str));
+            node.ip = ip_str;
+#endif
+            node.port = static_cast<uint16_t>(words[3] & 0xffff);
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Write a contact into a slot if no other writer holds it.
+     *
+     * @return False if the slot was busy; the caller may skip the update.
+     */
+    bool SharedContacts::try_write_slot(Slot& slot, const Node& node, uint64_t last_seen) {
+        uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+        if ((seq & 1) ||
+            !slot.seq.compare_exchange_strong(seq, seq + 1, std::memory_order_acquire)) {
+            return false;
+        }
+
+        uint64_t words[5] = {};
+        std::memcpy(words, node.id.data(), NODE_ID_SIZE);
+        uint32_t ip_binary = 0;
+#ifndef _WIN32
+        inet_pton(AF_INET, node.ip.c_str(), &ip_binary);
+#endif
+        words[3] = (static_cast<uint64_t>(ip_binary) << 16) | node.port;
+        words[4] = last_seen;
+        for (size_t i = 0; i < 5; ++i) {
+            slot.words[i].store(words[i], std::memory_order_relaxed);
+        }
+
+        slot.seq.store(seq + 2, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Insert or refresh a contact. Probes a short run of slots starting
+     *        at the ID's hash: reuses the slot already holding the ID, else an
+     *        empty slot, else the stalest one. Best effort: a contended slot is
+     *        skipped rather than waited on.
+     *
+     * @param node The contact to publish.
+     */
+    void SharedContacts::publish(const Node& node) {
+        if (!header_) {
+            return;
+        }
+
+        uint64_t hash;
+        std::memcpy(&hash, node.id.data(), sizeof(hash));
+        size_t start = hash % capacity_;
+
+        Slot* target = nullptr;
+        uint64_t target_seen = UINT64_MAX;
+        for (size_t i = 0; i < PROBE_LIMIT && i < capacity_; ++i) {
+            Slot& slot = slots_[(start + i) % capacity_];
+            Node existing;
+            uint64_t last_seen = 0;
+            if (!read_slot(slot, existing, last_seen)) {
+                continue;
+            }
+            if (last_seen != 0 && existing.id == node.id) {
+                target = &slot;
+                break;
+            }
+            if (last_seen < target_seen) {
+                target = &slot;
+                target_seen = last_seen;
+            }
+        }
+
+        if (target) {
+            try_write_slot(*target, node, now_seconds());
+        }
+    }
+
+    /**
+     * @brief Copy out every contact published within the last max_age_seconds.
+     */
+    std::vector<Node> SharedContacts::snapshot(uint64_t max_age_seconds) const {
+        std::vector<Node> nodes;
+        if (!header_) {
+            return nodes;
+        }
+
+        uint64_t now = now_seconds();
+        for (size_t i = 0; i < capacity_; ++i) {
+            Node node;
+            uint64_t last_seen = 0;
+            if (read_slot(slots_[i], node, last_seen) && last_seen != 0 &&
+                now - last_seen <= max_age_seconds) {
+                nodes.push_back(node);
+            }
+        }
+        return nodes;
+    }
+
+} // namespace DHT
@@ -0,0 +1,202 @@
+#include "../include/socket_shard.hpp"
+#include "../include/cpu_placement.hpp"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+#else
+    #include <sys/socket.h>
+    #include <unistd.h>
+#endif
+
+namespace DHT {
+
+    namespace {
+
+        thread_local SocketShard* current_shard = nullptr;
+
+        bool would_block() {
+#ifdef _WIN32
+            int error = WSAGetLastError();
+            return error == WSAEWOULDBLOCK || error == WSAEINTR;
+#else
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+        }
+
+        void close_socket(int sock) {
+#ifdef _WIN32
+            closesocket(sock);
+#else
+            close(sock);
+#endif
+        }
+
+    } // namespace
+
+    /**
+     * @param batch            Datagrams per recvmmsg() / sendmmsg().
+     * @param packet_size      Pooled buffer size (largest datagram received whole).
+     * @param pool_capacity    Pooled buffers at most.
+     * @param max_queued_sends Replies held before further ones are dropped.
+     */
+    SocketShard::SocketShard(size_t batch, size_t packet_size, size_t pool_capacity, size_t max_queued_sends)
+        : pool_(packet_size, pool_capacity), receive_ring_(std::make_unique<ReceiveRing>(batch, pool_)),
+          max_queued_sends_(max_queued_sends), send_batch_(batch) {}
+
+    SocketShard::~SocketShard() {
+        stop();
+    }
+
+    /**
+     * @brief Create a non-blocking UDP socket sharing the port.
+     *
+     * @param port The DHT port, already bound with SO_REUSEPORT.
+     *
+     * @return False (and the shard stays closed) on any failure.
+     */
+    bool SocketShard::open(uint16_t port) {
+        sock_ = static_cast<int>(socket(AF_INET, SOCK_DGRAM, 0));
+        if (sock_ < 0) {
+            std::cerr << "[Shard] Error creating socket! errno: " << strerror(errno) << '\n';
+            return false;
+        }
+
+        sockaddr_in local_addr{};
+        local_addr.sin_family = AF_INET;
+        local_addr.sin_port = htons(port);
+        local_addr.sin_addr.s_addr = INADDR_ANY;
+        if (!enable_reuseport(sock_) ||
+            bind(sock_, reinterpret_cast<sockaddr*>(&local_addr), sizeof(local_addr)) < 0 ||
+            !set_nonblocking(sock_)) {
+            std::cerr << "[Shard] Failed to share port " << port << ": " << strerror(errno) << '\n';
+            close_socket(sock_);
+            sock_ = -1;
+            return false;
+        }
+        loop_ = std::make_unique<EventLoop>(sock_);
+        return true;
+    }
+
+    /**
+     * @brief Start the worker thread.
+     *
+     * @param cpu     CPU to pin the worker to and steer the socket's packets
+     *                to (-1 = unpinned).
+     * @param handler Called on the worker for every datagram received.
+     */
+    void SocketShard::start(int cpu, DatagramHandler handler) {
+        if (sock_ < 0 || worker_.joinable()) {
+            return;
+        }
+        handler_ = std::move(handler);
+        stopping_.store(false);
+        worker_ = std::thread([this, cpu]() { loop(cpu); });
+    }
+
+    /**
+     * @brief Stop the worker, then close the socket. Datagrams still waiting
+     *        in it are dropped; the kernel hashes their flows to the
+     *        remaining sockets from then on.
+     */
+    void SocketShard::stop() {
+        if (worker_.joinable()) {
+            stopping_.store(true);
+            loop_->wake();
+            worker_.join();
+        }
+        loop_.reset();
+        if (sock_ >= 0) {
+            close_socket(sock_);
+            sock_ = -1;
+        }
+    }
+
+    /**
+     * @brief Queue a datagram for the flush after the current batch.
+     *
+     * @return False if the queue is full and the datagram was dropped (counted
+     *         in send_drops()).
+     */
+    bool SocketShard::send(Packet data, const sockaddr_in& addr) {
+        if (send_queue_.size() >= max_queued_sends_) {
+            send_drops_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        send_queue_.push_back({std::move(data), addr});
+        return true;
+    }
+
+    SocketShard* SocketShard::current() {
+        return current_shard;
+    }
+
+    /**
+     * @brief Worker body: place the thread, then wait, drain and flush until
+     *        stop(). The pool grows from here, so its slabs land on the
+     *        worker's node.
+     */
+    void SocketShard::loop(int cpu) {
+        current_shard = this;
+        if (cpu >= 0) {
+            if (!pin_current_thread(cpu)) {
+                std::cerr << "[Shard] Failed to pin worker to CPU " << cpu << '\n';
+            }
+            if (!set_incoming_cpu(sock_, cpu)) {
+                std::cerr << "[Shard] Failed to set SO_INCOMING_CPU " << cpu << '\n';
+            }
+        }
+        while (!stopping_.load()) {
+            EventLoop::Ready ready = loop_->wait(std::chrono::milliseconds(IDLE_WAIT_MS), !send_queue_.empty());
+            if (ready.readable) {
+                receive();
+            }
+            if (ready.writable || !send_queue_.empty()) {
+                flush();
+            }
+        }
+        current_shard = nullptr;
+    }
+
+    /**
+     * @brief Read one batch, hand each datagram to the handler and send the
+     *        replies it queued.
+     *
+     * @return Datagrams handled.
+     */
+    size_t SocketShard::receive() {
+        int count = receive_ring_->receive(sock_);
+        if (count < 0) {
+            if (!would_block()) {
+                std::cerr << "[Shard] recvmmsg failed! errno: " << strerror(errno) << '\n';
+            }
+            return 0;
+        }
+        for (int i = 0; i < count; ++i) {
+            handler_(receive_ring_->data(i), receive_ring_->length(i), receive_ring_->sender(i));
+        }
+        flush();
+        return static_cast<size_t>(count);
+    }
+
+    /**
+     * @brief Send queued datagrams, a batch per sendmmsg(), until the queue
+     *        is empty or the socket would block.
+     */
+    void SocketShard::flush() {
+        while (!send_queue_.empty()) {
+            int sent = send_batch_.send(sock_, send_queue_);
+            if (sent < 0) {
+                if (would_block()) {
+                    return;
+                }
+                std::cerr << "[Shard] sendmmsg failed! errno: " << strerror(errno) << '\n';
+                sent = 1;
+            }
+            send_queue_.erase(send_queue_.begin(), send_queue_.begin() + sent);
+        }
+    }
+
+} // namespace DHT
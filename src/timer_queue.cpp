@@ -0,0 +1,60 @@
+#include "../include/timer_queue.hpp"
+
+namespace DHT {
+
+    /**
+     * @brief Arm a one-shot timer.
+     *
+     * @param when     When the callback should run.
+     * @param callback The work to run on the pumping thread.
+     */
+    void TimerQueue::schedule(Clock::time_point when, std::function<void()> callback) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        timers_.push({when, next_sequence_++, std::move(callback)});
+    }
+
+    /**
+     * @brief Run every timer whose time has come. Timers armed by a callback
+     *        for an instant that is already due run in the same call.
+     *
+     * @param now The current time.
+     *
+     * @return The number of callbacks run.
+     */
+    size_t TimerQueue::run_due(Clock::time_point now) {
+        size_t fired = 0;
+        while (true) {
+            std::function<void()> callback;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (timers_.empty() || timers_.top().when > now) {
+                    break;
+                }
+                callback = std::move(const_cast<Timer&>(timers_.top()).callback);
+                timers_.pop();
+            }
+            if (callback) {
+                callback();
+            }
+            fired++;
+        }
+        return fired;
+    }
+
+    /**
+     * @brief When the earliest pending timer is due.
+     */
+    TimerQueue::Clock::time_point TimerQueue::next_due() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return timers_.empty() ? Clock::time_point::max() : timers_.top().when;
+    }
+
+    /**
+     * @brief Number of armed timers.
+     */
+    size_t TimerQueue::size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return timers_.size();
+    }
+
+} // namespace DHT
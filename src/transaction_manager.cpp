@@ -0,0 +1,215 @@
+#include "../include/transaction_manager.hpp"
+
+namespace DHT {
+
+    /**
+     * @brief Construct a transaction table.
+     *
+     * @param capacity Maximum number of queries in flight. Rounded up to a power
+     *                 of two and capped at 65536 (the 2-byte ID space).
+     */
+    TransactionManager::TransactionManager(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity && size < 65536) {
+            size <<= 1;
+        }
+        slots_.resize(size);
+        mask_ = size - 1;
+    }
+
+    /**
+     * @brief Decode a 2-byte wire transaction ID.
+     *
+     * @return False if the ID was not issued by this manager's format.
+     */
+    bool TransactionManager::decode_id(const std::string& transaction_id, uint16_t& value) {
+        if (transaction_id.size() != 2) {
+            return false;
+        }
+        value = static_cast<uint16_t>((static_cast<uint8_t>(transaction_id[0]) << 8) |
+                                      static_cast<uint8_t>(transaction_id[1]));
+        return true;
+    }
+
+    /**
+     * @brief Reserve a transaction ID for an outbound query.
+     *
+     * @param ip             Remote IPv4 address (network byte order).
+     * @param port           Remote port (host byte order).
+     * @param deadline       When the query times out.
+     * @param callback       Invoked once with the response, error or timeout.
+     *                       Left untouched if the table is full.
+     * @param transaction_id [out] The 2-byte ID to put in the query's "t" field.
+     *
+     * @return False if the table is full.
+     */
+    bool TransactionManager::begin(uint32_t ip, uint16_t port, Clock::time_point deadline,
+                                   QueryCallback&& callback, std::string& transaction_id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_ == slots_.size()) {
+            return false;
+        }
+
+        // Walk the ID space until we land on a free slot
+        uint16_t id = next_id_;
+        while (slots_[id & mask_].in_use) {
+            id++;
+        }
+        next_id_ = static_cast<uint16_t>(id + 1);
+
+        Slot& slot = slots_[id & mask_];
+        slot.in_use = true;
+        slot.id = id;
+        slot.serial = next_serial_++;
+        slot.ip = ip;
+        slot.port = port;
+        slot.deadline = deadline;
+        slot.callback = std::move(callback);
+        pending_++;
+
+        deadlines_.push({deadline, static_cast<uint16_t>(id & mask_), slot.serial});
+
+        transaction_id.assign({static_cast<char>(id >> 8), static_cast<char>(id & 0xff)});
+        return true;
+    }
+
+    /**
+     * @brief Release a slot and hand back its callback. Requires mutex_.
+     */
+    QueryCallback TransactionManager::take(uint16_t index) {
+        Slot& slot = slots_[index];
+        QueryCallback callback = std::move(slot.callback);
+        slot.callback = nullptr;
+        slot.in_use = false;
+        pending_--;
+        return callback;
+    }
+
+    /**
+     * @brief Match an incoming response or error to its pending query and
+     *        invoke the query's callback.
+     *
+     * @param transaction_id The "t" field of the incoming message.
+     * @param ip             Sender IPv4 address (network byte order).
+     * @param port           Sender port (host byte order).
+     * @param result         The decoded result to deliver.
+     *
+     * @return True if a pending query matched.
+     */
+    bool TransactionManager::complete(const std::string& transaction_id, uint32_t ip, uint16_t port,
+                                      QueryResult result) {
+        uint16_t id;
+        if (!decode_id(transaction_id, id)) {
+            return false;
+        }
+
+        QueryCallback callback;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Slot& slot = slots_[id & mask_];
+            if (!slot.in_use || slot.id != id || slot.ip != ip || slot.port != port) {
+                return false;
+            }
+            callback = take(id & mask_);
+        }
+
+        if (callback) {
+            callback(result);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Forget a pending query without invoking its callback.
+     *
+     * @return True if the query was still pending.
+     */
+    bool TransactionManager::cancel(const std::string& transaction_id) {
+        uint16_t id;
+        if (!decode_id(transaction_id, id)) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        Slot& slot = slots_[id & mask_];
+        if (!slot.in_use || slot.id != id) {
+            return false;
+        }
+        take(id & mask_);
+        return true;
+    }
+
+    /**
+     * @brief Complete a pending query immediately with a Timeout result, e.g.
+     *        because sending it failed.
+     */
+    void TransactionManager::fail(const std::string& transaction_id) {
+        uint16_t id;
+        if (!decode_id(transaction_id, id)) {
+            return;
+        }
+
+        QueryCallback callback;
+        QueryResult result;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            Slot& slot = slots_[id & mask_];
+            if (!slot.in_use || slot.id != id) {
+                return;
+            }
+            callback = take(id & mask_);
+        }
+
+        if (callback) {
+            callback(result);
+        }
+    }
+
+    /**
+     * @brief Time out every query whose deadline has passed.
+     *
+     * @param now The current time.
+     *
+     * @return The number of queries that timed out.
+     */
+    size_t TransactionManager::expire(Clock::time_point now) {
+        std::vector<QueryCallback> expired;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            while (!deadlines_.empty() && deadlines_.top().when <= now) {
+                Deadline top = deadlines_.top();
+                deadlines_.pop();
+                Slot& slot = slots_[top.index];
+                if (slot.in_use && slot.serial == top.serial) {
+                    expired.push_back(take(top.index));
+                }
+            }
+        }
+
+        QueryResult timeout;
+        for (auto& callback : expired) {
+            if (callback) {
+                callback(timeout);
+            }
+        }
+        return expired.size();
+    }
+
+    /**
+     * @brief The earliest deadline among pending queries.
+     */
+    TransactionManager::Clock::time_point TransactionManager::next_deadline() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // The heap top may be stale (already completed); that only makes the
+        // caller wake up early, never late.
+        return deadlines_.empty() ? Clock::time_point::max() : deadlines_.top().when;
+    }
+
+    /**
+     * @brief Number of queries currently in flight.
+     */
+    size_t TransactionManager::pending() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pending_;
+    }
+
+} // namespace DHT
@@ -0,0 +1,515 @@
+#include "../include/uring_socket.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#ifdef __linux__
+    #include <linux/io_uring.h>
+    #include <linux/time_types.h>
+    #include <poll.h>
+    #include <sys/mman.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace DHT {
+
+#ifdef __linux__
+    namespace {
+
+        unsigned load_acquire(const unsigned* p) {
+            return std::atomic_ref<const unsigned>(*p).load(std::memory_order_acquire);
+        }
+
+        void store_release(unsigned* p, unsigned value) {
+            std::atomic_ref<unsigned>(*p).store(value, std::memory_order_release);
+        }
+
+    } // namespace
+#endif
+
+    UringSocket::~UringSocket() {
+        close();
+    }
+
+    /**
+     * @brief Create the ring, register the provided-buffer ring and post the
+     *        multishot receive and the wake-up poll.
+     *
+     * @param sock        The non-blocking UDP socket (not owned).
+     * @param wake_fd     Eventfd that interrupts wait() when signalled (not owned).
+     * @param buffers     Receive buffers; rounded up to a power of two.
+     * @param buffer_size Largest datagram payload; longer ones are truncated.
+     * @param numa_node   Node to place the receive buffers on (-1 = any).
+     *
+     * @return True if io_uring is usable; false leaves the object closed.
+     */
+    bool UringSocket::open(int sock, int wake_fd, size_t buffers, size_t buffer_size, int numa_node) {
+#ifdef __linux__
+        close();
+        sock_ = sock;
+        wake_fd_ = wake_fd;
+
+        io_uring_params params{};
+        params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+        params.cq_entries = CQ_ENTRIES;
+        ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, SQ_ENTRIES, &params));
+        if (ring_fd_ < 0 && errno == EINVAL) {
+            // COOP_TASKRUN is 5.19+; the receive needs 6.0 anyway, but let
+            // the probe below be the judge
+            params = {};
+            params.flags = IORING_SETUP_CQSIZE;
+            params.cq_entries = CQ_ENTRIES;
+            ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, SQ_ENTRIES, &params));
+        }
+        if (ring_fd_ < 0) {
+            return false;
+        }
+        const unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+        if ((params.features & required) != required) {
+            close();
+            return false;
+        }
+
+        // SQ and CQ rings share one mapping (IORING_FEAT_SINGLE_MMAP)
+        sq_ring_size_ = std::max<size_t>(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                                         params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+        sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring_fd_, IORING_OFF_SQ_RING);
+        if (sq_ring_ == MAP_FAILED) {
+            sq_ring_ = nullptr;
+            close();
+            return false;
+        }
+        cq_ring_ = sq_ring_;
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring_fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            close();
+            return false;
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        char* sq = static_cast<char*>(sq_ring_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        char* cq = static_cast<char*>(cq_ring_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+
+        // Provided buffers: each holds the recvmsg header, the sender and
+        // the payload
+        buffer_count_ = 1;
+        while (buffer_count_ < std::clamp<size_t>(buffers, 1, 32768)) {
+            buffer_count_ <<= 1;
+        }
+        buffer_stride_ = sizeof(io_uring_recvmsg_out) + sizeof(sockaddr_in) + buffer_size;
+        buffers_ = LocalBuffer(buffer_count_ * buffer_stride_, numa_node);
+        buffer_ring_size_ = buffer_count_ * sizeof(io_uring_buf);
+        void* ring = mmap(nullptr, buffer_ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ring == MAP_FAILED || buffers_.data() == nullptr) {
+            if (ring != MAP_FAILED) {
+                munmap(ring, buffer_ring_size_);
+            }
+            close();
+            return false;
+        }
+        buffer_ring_ = static_cast<io_uring_buf*>(ring);
+
+        io_uring_buf_reg reg{};
+        reg.ring_addr = reinterpret_cast<uint64_t>(buffer_ring_);
+        reg.ring_entries = static_cast<uint32_t>(buffer_count_);
+        reg.bgid = BUFFER_GROUP;
+        if (syscall(__NR_io_uring_register, ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+            close();
+            return false;
+        }
+        for (size_t i = 0; i < buffer_count_; ++i) {
+            recycle_buffer(static_cast<uint16_t>(i));
+        }
+
+        receive_header_ = {};
+        receive_header_.msg_namelen = sizeof(sockaddr_in);
+
+        send_slots_ = std::vector<SendSlot>(SEND_SLOTS);
+        free_send_slots_.clear();
+        for (size_t i = SEND_SLOTS; i-- > 0;) {
+            free_send_slots_.push_back(i);
+        }
+        completions_.reserve(CQ_ENTRIES);
+
+        arm_receive();
+        arm_wake();
+        if (enter(pending_, 0, 0, std::chrono::milliseconds(0)) < 0) {
+            close();
+            return false;
+        }
+
+        // Kernels without multishot recvmsg reject it at once; peek without
+        // consuming so any datagram already delivered is kept
+        for (unsigned head = *cq_head_, tail = load_acquire(cq_tail_); head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+            if ((cqe.user_data == RECV_TAG || cqe.user_data == WAKE_TAG) && cqe.res < 0 &&
+                !(cqe.flags & IORING_CQE_F_MORE)) {
+                close();
+                return false;
+            }
+        }
+        return true;
+#else
+        (void)sock;
+        (void)wake_fd;
+        (void)buffers;
+        (void)buffer_size;
+        (void)numa_node;
+        return false;
+#endif
+    }
+
+    /**
+     * @brief Cancel the receive, wait for sends still owned by the kernel and
+     *        tear the ring down. Datagrams arriving meanwhile are dropped.
+     */
+    void UringSocket::close() {
+#ifdef __linux__
+        if (ring_fd_ >= 0 && sq_ring_ != nullptr && sqes_ != nullptr) {
+            closing_ = true;
+            if (receive_armed_) {
+                if (io_uring_sqe* sqe = next_sqe()) {
+                    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                    sqe->fd = -1;
+                    sqe->addr = RECV_TAG;
+                    sqe->user_data = CANCEL_TAG;
+                }
+            }
+            for (int round = 0; round < 20 && (receive_armed_ || sends_in_flight() > 0); ++round) {
+                wait(std::chrono::milliseconds(50), [](const char*, size_t, const sockaddr_in&) {});
+            }
+            closing_ = false;
+        }
+
+        if (sqes_ != nullptr) {
+            munmap(sqes_, sqes_size_);
+            sqes_ = nullptr;
+        }
+        if (sq_ring_ != nullptr) {
+            munmap(sq_ring_, sq_ring_size_);
+            sq_ring_ = cq_ring_ = nullptr;
+        }
+        if (ring_fd_ >= 0) {
+            ::close(ring_fd_);
+        }
+        if (buffer_ring_ != nullptr) {
+            munmap(buffer_ring_, buffer_ring_size_);
+            buffer_ring_ = nullptr;
+        }
+        buffers_ = LocalBuffer();
+        send_slots_.clear();
+        free_send_slots_.clear();
+        pending_ = 0;
+        receive_armed_ = false;
+        wake_armed_ = false;
+#endif
+        ring_fd_ = -1;
+    }
+
+    /**
+     * @brief Hand queued datagrams to the kernel as sendmsg submissions. Each
+     *        datagram moves into a send slot, which owns it until its
+     *        completion arrives.
+     *
+     * @param queue Datagrams waiting to be sent, oldest first; those that
+     *              found no free slot stay queued.
+     */
+    void UringSocket::queue_sends(std::deque<Datagram>& queue) {
+#ifdef __linux__
+        while (!queue.empty() && !free_send_slots_.empty()) {
+            io_uring_sqe* sqe = next_sqe();
+            if (sqe == nullptr) {
+                return;
+            }
+            size_t index = free_send_slots_.back();
+            free_send_slots_.pop_back();
+            SendSlot& slot = send_slots_[index];
+            slot.datagram = std::move(queue.front());
+            queue.pop_front();
+
+            slot.vector.iov_base = slot.datagram.data.data();
+            slot.vector.iov_len = slot.datagram.data.size();
+            slot.header = {};
+            slot.header.msg_name = &slot.datagram.addr;
+            slot.header.msg_namelen = sizeof(slot.datagram.addr);
+            slot.header.msg_iov = &slot.vector;
+            slot.header.msg_iovlen = 1;
+
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->fd = sock_;
+            sqe->addr = reinterpret_cast<uint64_t>(&slot.header);
+            sqe->len = 1;
+            sqe->user_data = SEND_TAG | index;
+        }
+#else
+        (void)queue;
+#endif
+    }
+
+    /**
+     * @brief Submit pending work and, if nothing has completed yet, wait up
+     *        to the timeout in the same io_uring_enter(). Then handle every
+     *        completion: received datagrams go to the handler (their buffer
+     *        is recycled when it returns), finished sends free their slots,
+     *        and the receive or wake-up poll is re-posted if it ended. The
+     *        handler may call wait() again.
+     *
+     * @param timeout Longest wait (0 only collects what is ready).
+     * @param handler Called for each datagram received.
+     *
+     * @return Datagrams received.
+     */
+    size_t UringSocket::wait(std::chrono::milliseconds timeout, const DatagramHandler& handler) {
+#ifdef __linux__
+        if (ring_fd_ < 0) {
+            return 0;
+        }
+        bool ready = load_acquire(cq_tail_) != *cq_head_;
+        if (!ready && timeout.count() > 0) {
+            if (enter(pending_, 1, IORING_ENTER_GETEVENTS, timeout) < 0 && errno != ETIME && errno != EINTR) {
+                std::cerr << "[io_uring] io_uring_enter failed: " << strerror(errno) << '\n';
+            }
+        } else if (pending_ > 0) {
+            enter(pending_, 0, 0, std::chrono::milliseconds(0));
+        }
+
+        // A nested wait() (from inside the handler) must not reuse the
+        // outer call's batch
+        std::vector<Completion> nested;
+        std::vector<Completion>& batch = nesting_ == 0 ? completions_ : nested;
+        nesting_++;
+        take_completions(batch);
+
+        size_t received = 0;
+        for (const Completion& completion : batch) {
+            if (completion.user_data == RECV_TAG) {
+                if (!(completion.flags & IORING_CQE_F_MORE)) {
+                    receive_armed_ = false;
+                }
+                if (completion.res < 0) {
+                    if (completion.res != -ENOBUFS && completion.res != -ECANCELED) {
+                        std::cerr << "[io_uring] recvmsg failed: " << strerror(-completion.res) << '\n';
+                    }
+                    continue;
+                }
+                if (!(completion.flags & IORING_CQE_F_BUFFER)) {
+                    continue;
+                }
+                uint16_t id = static_cast<uint16_t>(completion.flags >> IORING_CQE_BUFFER_SHIFT);
+                const char* base = buffers_.data() + id * buffer_stride_;
+                io_uring_recvmsg_out out;
+                std::memcpy(&out, base, sizeof(out));
+                size_t header = sizeof(out) + receive_header_.msg_namelen + receive_header_.msg_controllen;
+                size_t length = std::min<size_t>(out.payloadlen, static_cast<size_t>(completion.res) - header);
+                if (out.flags & MSG_TRUNC) {
+                    // Longer than a buffer; a cut-off KRPC message is useless
+                    truncated_.fetch_add(1, std::memory_order_relaxed);
+                } else if (!closing_ && out.namelen >= sizeof(sockaddr_in)) {
+                    sockaddr_in sender;
+                    std::memcpy(&sender, base + sizeof(out), sizeof(sender));
+                    handler(base + header, length, sender);
+                    received++;
+                }
+                recycle_buffer(id);
+            } else if (completion.user_data == WAKE_TAG) {
+                if (!(completion.flags & IORING_CQE_F_MORE)) {
+                    wake_armed_ = false;
+                }
+                uint64_t value;
+                while (read(wake_fd_, &value, sizeof(value)) > 0) {
+                }
+            } else if (completion.user_data & SEND_TAG) {
+                size_t index = static_cast<size_t>(completion.user_data & ~SEND_TAG);
+                if (completion.res == -EAGAIN || completion.res == -ENOBUFS) {
+                    send_blocked_ = true;       // Dropped; the socket buffer is full
+                } else {
+                    send_blocked_ = false;
+                    if (completion.res < 0) {
+                        std::cerr << "[io_uring] sendmsg failed: " << strerror(-completion.res) << '\n';
+                    }
+                }
+                send_slots_[index].datagram.data.reset();
+                free_send_slots_.push_back(index);
+            }
+        }
+        batch.clear();
+        nesting_--;
+
+        if (!closing_) {
+            if (!receive_armed_) {
+                arm_receive();
+            }
+            if (!wake_armed_) {
+                arm_wake();
+            }
+        }
+        return received;
+#else
+        (void)timeout;
+        (void)handler;
+        return 0;
+#endif
+    }
+
+    /**
+     * @brief Submit pending SQEs without waiting for anything.
+     */
+    void UringSocket::submit() {
+#ifdef __linux__
+        if (ring_fd_ >= 0 && pending_ > 0 &&
+            enter(pending_, 0, 0, std::chrono::milliseconds(0)) < 0 && errno != EINTR) {
+            std::cerr << "[io_uring] io_uring_enter failed: " << strerror(errno) << '\n';
+        }
+#endif
+    }
+
+    /**
+     * @brief Sends handed to the kernel whose completion has not arrived.
+     */
+    size_t UringSocket::sends_in_flight() const {
+#ifdef __linux__
+        return send_slots_.size() - free_send_slots_.size();
+#else
+        return 0;
+#endif
+    }
+
+#ifdef __linux__
+    /**
+     * @brief Claim the next submission slot, zeroed. Submits first if the
+     *        ring is full.
+     *
+     * @return The SQE, or nullptr if the ring stays full.
+     */
+    io_uring_sqe* UringSocket::next_sqe() {
+        unsigned tail = *sq_tail_;
+        if (tail - load_acquire(sq_head_) > sq_mask_) {
+            if (enter(pending_, 0, 0, std::chrono::milliseconds(0)) < 0 ||
+                tail - load_acquire(sq_head_) > sq_mask_) {
+                return nullptr;
+            }
+        }
+        // The kernel only reads the SQ inside io_uring_enter() (no SQPOLL),
+        // so the entry can be published before the caller fills it in
+        io_uring_sqe* sqe = &sqes_[tail & sq_mask_];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array_[tail & sq_mask_] = tail & sq_mask_;
+        store_release(sq_tail_, tail + 1);
+        pending_++;
+        return sqe;
+    }
+
+    /**
+     * @brief io_uring_enter(), with the wait bounded by timeout when
+     *        IORING_ENTER_GETEVENTS is set.
+     *
+     * @return The syscall's result (SQEs consumed, or -1 with errno).
+     */
+    int UringSocket::enter(unsigned to_submit, unsigned min_complete, unsigned flags,
+                           std::chrono::milliseconds timeout) {
+        __kernel_timespec ts{};
+        io_uring_getevents_arg arg{};
+        void* argp = nullptr;
+        size_t argsz = 0;
+        if (flags & IORING_ENTER_GETEVENTS) {
+            ts.tv_sec = timeout.count() / 1000;
+            ts.tv_nsec = (timeout.count() % 1000) * 1000000;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+            argp = &arg;
+            argsz = sizeof(arg);
+            flags |= IORING_ENTER_EXT_ARG;
+        }
+        int ret = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete, flags, argp, argsz));
+        if (ret > 0) {
+            pending_ -= std::min<unsigned>(pending_, static_cast<unsigned>(ret));
+        }
+        return ret;
+    }
+
+    /**
+     * @brief Post the multishot recvmsg that fills provided buffers.
+     */
+    void UringSocket::arm_receive() {
+        io_uring_sqe* sqe = next_sqe();
+        if (sqe == nullptr) {
+            return;
+        }
+        sqe->opcode = IORING_OP_RECVMSG;
+        sqe->fd = sock_;
+        sqe->addr = reinterpret_cast<uint64_t>(&receive_header_);
+        sqe->len = 1;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = BUFFER_GROUP;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->user_data = RECV_TAG;
+        receive_armed_ = true;
+    }
+
+    /**
+     * @brief Post the multishot poll on the wake-up eventfd.
+     */
+    void UringSocket::arm_wake() {
+        if (wake_fd_ < 0) {
+            wake_armed_ = true;     // Nothing to watch
+            return;
+        }
+        io_uring_sqe* sqe = next_sqe();
+        if (sqe == nullptr) {
+            return;
+        }
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = wake_fd_;
+        sqe->len = IORING_POLL_ADD_MULTI;
+        sqe->poll32_events = POLLIN;
+        sqe->user_data = WAKE_TAG;
+        wake_armed_ = true;
+    }
+
+    /**
+     * @brief Move every available CQE into out and release the CQ slots.
+     *
+     * @return Completions taken.
+     */
+    size_t UringSocket::take_completions(std::vector<Completion>& out) {
+        unsigned head = *cq_head_;
+        unsigned tail = load_acquire(cq_tail_);
+        for (; head != tail; ++head) {
+            const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+            out.push_back({cqe.user_data, cqe.res, cqe.flags});
+        }
+        store_release(cq_head_, head);
+        return out.size();
+    }
+
+    /**
+     * @brief Return a receive buffer to the provided-buffer ring.
+     */
+    void UringSocket::recycle_buffer(uint16_t id) {
+        // The tail overlays the first entry's resv field (struct
+        // io_uring_buf_ring); its flexible array member is laid out
+        // differently in C++, so the entries are addressed directly
+        std::atomic_ref<__u16> tail(buffer_ring_[0].resv);
+        __u16 next = tail.load(std::memory_order_relaxed);
+        io_uring_buf& buf = buffer_ring_[next & (buffer_count_ - 1)];
+        buf.addr = reinterpret_cast<uint64_t>(buffers_.data() + id * buffer_stride_);
+        buf.len = static_cast<uint32_t>(buffer_stride_);
+        buf.bid = id;
+        tail.store(static_cast<__u16>(next + 1), std::memory_order_release);
+    }
+#endif
+
+} // namespace DHT
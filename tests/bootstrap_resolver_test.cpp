@@ -0,0 +1,131 @@
+#include "../include/host_resolver.hpp"
+#include "../include/dht_bootstrap.hpp"
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <thread>
+
+// Resolution goes through the system resolver, so these tests rely on the
+// /etc/hosts entry mapping "localhost" to a loopback address. The bootstrap
+// node behind it is a stand-in DHTBootstrap on 127.0.0.1.
+
+using namespace DHT;
+
+static const uint16_t STANDIN_PORT = 46881;
+static const uint16_t NODE_PORT = 46882;
+
+static std::string cachePath(const std::string& name) {
+    std::string path = (std::filesystem::temp_directory_path() / name).string();
+    std::remove(path.c_str());
+    return path;
+}
+
+static std::vector<std::string> resolveNow(HostResolver& resolver, const std::string& host) {
+    auto promise = std::make_shared<std::promise<std::vector<std::string>>>();
+    std::future<std::vector<std::string>> result = promise->get_future();
+    resolver.resolve(host, [promise](const std::string&, const std::vector<std::string>& addresses) {
+        promise->set_value(addresses);
+    });
+    assert(result.wait_for(std::chrono::seconds(10)) == std::future_status::ready);
+    return result.get();
+}
+
+static bool hasLoopback(const std::vector<std::string>& addresses) {
+    return std::find(addresses.begin(), addresses.end(), "127.0.0.1") != addresses.end();
+}
+
+void testResolveAndReuseCacheFile() {
+    std::string path = cachePath("dht_resolver_test.cache");
+    {
+        HostResolver resolver(path);
+        assert(resolver.cached("localhost").empty());
+        assert(hasLoopback(resolveNow(resolver, "localhost")));
+        assert(hasLoopback(resolver.cached("localhost")));
+    }
+
+    // A new resolver answers from the file at once, on the calling thread
+    HostResolver restarted(path);
+    assert(hasLoopback(restarted.cached("localhost")));
+    std::thread::id caller = std::this_thread::get_id();
+    bool answered = false;
+    restarted.resolve("localhost", [&](const std::string&, const std::vector<std::string>& addresses) {
+        assert(std::this_thread::get_id() == caller);
+        assert(hasLoopback(addresses));
+        answered = true;
+    });
+    assert(answered);
+
+    std::remove(path.c_str());
+    std::cout << "Resolve/cache-file test passed!" << std::endl;
+}
+
+void testCacheOutlivesFailedLookup() {
+    std::string path = cachePath("dht_resolver_stale.cache");
+    {
+        std::ofstream out(path);
+        out << "dht-standin.invalid 127.0.0.1\n";
+    }
+
+    HostResolver resolver(path);
+    assert(hasLoopback(resolveNow(resolver, "dht-standin.invalid")));
+
+    // The background refresh fails; the cached answer is kept
+    while (resolver.pending() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    assert(hasLoopback(resolver.cached("dht-standin.invalid")));
+
+    std::remove(path.c_str());
+    std::cout << "Stale cache test passed!" << std::endl;
+}
+
+void testDeferredBootstrapWaitsForResolution() {
+    DHTConfig standin_config;
+    standin_config.port = STANDIN_PORT;
+    DHTBootstrap standin(DHTBootstrap::generate_random_node_id(), standin_config);
+
+    DHTConfig config;
+    config.port = NODE_PORT;
+    config.bootstrap_rounds = 1;
+    DHTBootstrap node(DHTBootstrap::generate_random_node_id(), config);
+    node.add_bootstrap_node("localhost", STANDIN_PORT);
+
+    // Both arrive before the answer is delivered on the pumping thread
+    assert(node.get_bootstrap_nodes().empty());
+    int finished = 0;
+    size_t sizes[2] = {0, 0};
+    node.bootstrap([&](size_t size) { sizes[finished++] = size; });
+    node.bootstrap([&](size_t size) { sizes[finished++] = size; });
+    assert(finished == 0);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    while (finished < 2 && std::chrono::steady_clock::now() < deadline) {
+        node.run_once(std::chrono::milliseconds(5));
+        standin.run_once(std::chrono::milliseconds(5));
+    }
+    assert(finished == 2);
+    assert(sizes[0] == sizes[1] && sizes[0] >= 1);
+
+    std::vector<Node> seeds = node.get_bootstrap_nodes();
+    assert(seeds.size() == 1 && seeds[0].ip == "127.0.0.1" && seeds[0].port == STANDIN_PORT);
+    std::vector<Node> contacts = node.get_contacts();
+    assert(std::any_of(contacts.begin(), contacts.end(), [&](const Node& n) {
+        return n.id == standin.getMyNodeId();
+    }));
+
+    std::cout << "Deferred bootstrap test passed!" << std::endl;
+}
+
+int main() {
+    testResolveAndReuseCacheFile();
+    testCacheOutlivesFailedLookup();
+    testDeferredBootstrapWaitsForResolution();
+
+    std::cout << "All bootstrap resolver tests passed!" << std::endl;
+    return 0;
+}
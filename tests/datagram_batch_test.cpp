@@ -0,0 +1,117 @@
+#include "../include/datagram_batch.hpp"
+#include <iostream>
+#include <cassert>
+#include <cerrno>
+#include <string>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// ReceiveRing over a pair of loopback UDP sockets. Packets are 64 bytes, so
+// a 100-byte datagram does not fit.
+
+using namespace DHT;
+
+static const size_t PACKET_SIZE = 64;
+
+struct SocketPair {
+    int receiver;
+    int sender;
+    sockaddr_in to{};
+
+    SocketPair() {
+        receiver = socket(AF_INET, SOCK_DGRAM, 0);
+        sender = socket(AF_INET, SOCK_DGRAM, 0);
+        to.sin_family = AF_INET;
+        to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        assert(bind(receiver, reinterpret_cast<sockaddr*>(&to), sizeof(to)) == 0);
+        socklen_t length = sizeof(to);
+        assert(getsockname(receiver, reinterpret_cast<sockaddr*>(&to), &length) == 0);
+        fcntl(receiver, F_SETFL, fcntl(receiver, F_GETFL, 0) | O_NONBLOCK);
+    }
+
+    ~SocketPair() {
+        close(receiver);
+        close(sender);
+    }
+
+    void send(const std::string& payload) {
+        ssize_t sent = sendto(sender, payload.data(), payload.size(), 0,
+                              reinterpret_cast<sockaddr*>(&to), sizeof(to));
+        assert(sent == static_cast<ssize_t>(payload.size()));
+    }
+};
+
+void testTruncatedDatagramsDropped() {
+    PacketPool pool(PACKET_SIZE, 64);
+    ReceiveRing ring(8, pool);
+    SocketPair sockets;
+
+    sockets.send("first");
+    sockets.send(std::string(100, 'x'));
+    sockets.send(std::string(PACKET_SIZE, 'y'));     // Exactly a packet: kept
+    sockets.send(std::string(PACKET_SIZE + 1, 'z'));
+    sockets.send("last");
+
+    int count = ring.receive(sockets.receiver);
+    assert(count == 3);
+    assert(ring.truncated() == 2);
+    assert(std::string(ring.data(0), ring.length(0)) == "first");
+    assert(std::string(ring.data(1), ring.length(1)) == std::string(PACKET_SIZE, 'y'));
+    assert(std::string(ring.data(2), ring.length(2)) == "last");
+
+    // A moved-out slot keeps its datagram; the slot is refilled next time
+    Packet packet = ring.take(2);
+    assert(std::string(packet.data(), packet.size()) == "last");
+    assert(ring.receive(sockets.receiver) == -1);
+    assert(errno == EAGAIN || errno == EWOULDBLOCK);
+
+    std::cout << "Truncated datagram test passed!" << std::endl;
+}
+
+void testWholeBatchTruncated() {
+    PacketPool pool(PACKET_SIZE, 64);
+    ReceiveRing ring(4, pool);
+    SocketPair sockets;
+
+    sockets.send(std::string(200, 'a'));
+    sockets.send(std::string(300, 'b'));
+    int count = ring.receive(sockets.receiver);
+    assert(count <= 0);
+    assert(ring.truncated() == 2);
+
+    // Slots reused after dropping still receive correctly
+    sockets.send("after");
+    assert(ring.receive(sockets.receiver) == 1);
+    assert(std::string(ring.data(0), ring.length(0)) == "after");
+
+    std::cout << "Whole-batch truncation test passed!" << std::endl;
+}
+
+void testReceiveOneSkipsTruncated() {
+    PacketPool pool(PACKET_SIZE, 64);
+    ReceiveRing ring(4, pool);
+    SocketPair sockets;
+
+    sockets.send(std::string(100, 'x'));
+    sockets.send("next");
+    Packet packet = pool.acquire();
+    sockaddr_in sender{};
+    int length = ring.receive_one(sockets.receiver, packet, sender);
+    assert(length == 4);
+    assert(std::string(packet.data(), length) == "next");
+    assert(sender.sin_addr.s_addr == htonl(INADDR_LOOPBACK));
+    assert(ring.truncated() == 1);
+    assert(ring.receive_one(sockets.receiver, packet, sender) == -1);
+
+    std::cout << "Single receive truncation test passed!" << std::endl;
+}
+
+int main() {
+    testTruncatedDatagramsDropped();
+    testWholeBatchTruncated();
+    testReceiveOneSkipsTruncated();
+
+    std::cout << "All datagram batch tests passed!" << std::endl;
+    return 0;
+}
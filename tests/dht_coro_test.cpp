@@ -0,0 +1,111 @@
+#include "../include/dht_coro.hpp"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <thread>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Coroutine queries between two nodes on 127.0.0.1. The silent peer is a
+// bare UDP socket that never reads, so queries to it only end by timeout or
+// cancellation.
+
+using namespace DHT;
+
+static const uint16_t NODE_PORT = 46895;
+static const uint16_t ANSWERING_PORT = 46896;
+static const uint16_t SILENT_PORT = 46897;
+
+static Node localNode(uint16_t port) {
+    Node node;
+    node.ip = "127.0.0.1";
+    node.port = port;
+    return node;
+}
+
+static void pumpUntil(DHTBootstrap& dht, DHTBootstrap* other, const int& count, int expected) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (count < expected && std::chrono::steady_clock::now() < deadline) {
+        dht.run_once(std::chrono::milliseconds(5));
+        if (other) {
+            other->run_once(std::chrono::milliseconds(5));
+        }
+    }
+    assert(count == expected);
+}
+
+static DetachedTask pingOnce(AsyncDHT& async, Node node, CancellationToken token, bool* answered, int* resumed) {
+    *answered = co_await async.ping(node, std::chrono::seconds(2), token);
+    (*resumed)++;
+}
+
+static DetachedTask queryOnce(AsyncDHT& async, Node node, CancellationToken token,
+                              QueryResult::Status* status, int* resumed) {
+    QueryResult result = co_await async.query(node, "ping", BencodedDict{}, std::chrono::seconds(2), token);
+    *status = result.status;
+    (*resumed)++;
+}
+
+void testAnsweredPing(DHTBootstrap& dht, AsyncDHT& async) {
+    DHTConfig config;
+    config.port = ANSWERING_PORT;
+    DHTBootstrap answering(DHTBootstrap::generate_random_node_id(), config);
+
+    bool answered = false;
+    int resumed = 0;
+    pingOnce(async, localNode(ANSWERING_PORT), CancellationToken(), &answered, &resumed);
+    assert(resumed == 0);
+    pumpUntil(dht, &answering, resumed, 1);
+    assert(answered);
+    assert(dht.pending_queries() == 0);
+
+    std::cout << "Coroutine ping test passed!" << std::endl;
+}
+
+void testCancelFreesTransaction(DHTBootstrap& dht, AsyncDHT& async) {
+    int silent = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(SILENT_PORT);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    assert(bind(silent, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0);
+
+    size_t before = dht.pending_queries();
+    CancellationToken token;
+    QueryResult::Status status = QueryResult::Status::Response;
+    int resumed = 0;
+    queryOnce(async, localNode(SILENT_PORT), token, &status, &resumed);
+    assert(dht.pending_queries() == before + 1);
+
+    // Cancelled from another thread; the coroutine resumes on the pumping one
+    std::thread([&token]() { token.cancel(); }).join();
+    assert(resumed == 0);
+    pumpUntil(dht, nullptr, resumed, 1);
+    assert(status == QueryResult::Status::Cancelled);
+    assert(dht.pending_queries() == before);
+
+    // Past the query's deadline nothing is delivered: the transaction is gone
+    auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(2500);
+    while (std::chrono::steady_clock::now() < until) {
+        dht.run_once(std::chrono::milliseconds(20));
+    }
+    assert(resumed == 1);
+    assert(status == QueryResult::Status::Cancelled);
+
+    close(silent);
+    std::cout << "Coroutine cancellation test passed!" << std::endl;
+}
+
+int main() {
+    DHTConfig config;
+    config.port = NODE_PORT;
+    DHTBootstrap dht(DHTBootstrap::generate_random_node_id(), config);
+    AsyncDHT async(dht);
+
+    testAnsweredPing(dht, async);
+    testCancelFreesTransaction(dht, async);
+
+    std::cout << "All coroutine tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include "../include/mpsc_queue.hpp"
+#include "../include/spsc_ring.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace DHT;
+
+void testMpscFullAndEmpty() {
+    MpscQueue<std::string> queue(3);
+    assert(queue.capacity() == 4);
+    assert(!queue.pop());
+
+    for (int i = 0; i < 4; ++i) {
+        std::string value = std::to_string(i);
+        assert(queue.push(value));
+    }
+    std::string rejected = "kept";
+    assert(!queue.push(rejected));
+    assert(rejected == "kept"); // Left untouched when full
+
+    for (int i = 0; i < 4; ++i) {
+        std::optional<std::string> value = queue.pop();
+        assert(value && *value == std::to_string(i));
+    }
+    assert(!queue.pop());
+    assert(queue.push(rejected)); // Room again after the pops
+
+    std::cout << "MPSC full/empty test passed!" << std::endl;
+}
+
+void testMpscManyProducers() {
+    const uint64_t producers = 4;
+    const uint64_t per_producer = 100000;
+    MpscQueue<uint64_t> queue(256);
+
+    std::vector<std::thread> threads;
+    for (uint64_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&queue, p, per_producer]() {
+            for (uint64_t seq = 0; seq < per_producer; ++seq) {
+                uint64_t value = (p << 32) | seq;
+                while (!queue.push(value)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // Every value arrives exactly once, each producer's in the order pushed
+    std::vector<uint64_t> next(producers, 0);
+    uint64_t received = 0;
+    while (received < producers * per_producer) {
+        std::optional<uint64_t> value = queue.pop();
+        if (!value) {
+            std::this_thread::yield();
+            continue;
+        }
+        uint64_t p = *value >> 32;
+        assert(p < producers);
+        assert((*value & 0xffffffff) == next[p]);
+        next[p]++;
+        received++;
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    assert(!queue.pop());
+    for (uint64_t count : next) {
+        assert(count == per_producer);
+    }
+
+    std::cout << "MPSC multi-producer test passed!" << std::endl;
+}
+
+void testSpscFullAndEmpty() {
+    SpscRing<int> ring(5);
+    assert(ring.capacity() == 8);
+    assert(ring.empty());
+    assert(!ring.pop());
+
+    // Several laps, so the indices wrap around the slots
+    for (int lap = 0; lap < 5; ++lap) {
+        for (int i = 0; i < 8; ++i) {
+            int value = lap * 8 + i;
+            assert(ring.push(value));
+        }
+        int rejected = -1;
+        assert(!ring.push(rejected));
+        assert(!ring.empty());
+
+        for (int i = 0; i < 8; ++i) {
+            std::optional<int> value = ring.pop();
+            assert(value && *value == lap * 8 + i);
+        }
+        assert(ring.empty());
+        assert(!ring.pop());
+    }
+
+    std::cout << "SPSC full/empty test passed!" << std::endl;
+}
+
+void testSpscAcrossThreads() {
+    const int count = 200000;
+    SpscRing<int> ring(64);
+
+    std::thread producer([&ring]() {
+        for (int i = 0; i < count; ++i) {
+            int value = i;
+            while (!ring.push(value)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    for (int expected = 0; expected < count;) {
+        std::optional<int> value = ring.pop();
+        if (!value) {
+            std::this_thread::yield();
+            continue;
+        }
+        assert(*value == expected);
+        expected++;
+    }
+    producer.join();
+    assert(ring.empty());
+
+    std::cout << "SPSC cross-thread test passed!" << std::endl;
+}
+
+int main() {
+    testMpscFullAndEmpty();
+    testMpscManyProducers();
+    testSpscFullAndEmpty();
+    testSpscAcrossThreads();
+
+    std::cout << "All lock-free queue tests passed!" << std::endl;
+    return 0;
+}
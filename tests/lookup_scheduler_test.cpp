@@ -0,0 +1,186 @@
+#include "../include/lookup_scheduler.hpp"
+#include "../include/dht_bootstrap.hpp"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Bulk lookups from one node through a few real responders on 127.0.0.1,
+// all pumped from this thread.
+
+using namespace DHT;
+
+static const uint16_t NODE_PORT = 46900;
+static const uint16_t RESPONDER_PORTS[] = {46901, 46902, 46903, 46904};
+
+struct LocalNetwork {
+    std::unique_ptr<DHTBootstrap> node;
+    std::vector<std::unique_ptr<DHTBootstrap>> responders;
+
+    LocalNetwork() {
+        DHTConfig config;
+        config.port = NODE_PORT;
+        config.bootstrap_rounds = 1;
+        node = std::make_unique<DHTBootstrap>(DHTBootstrap::generate_random_node_id(), config);
+        for (uint16_t port : RESPONDER_PORTS) {
+            DHTConfig responder_config;
+            responder_config.port = port;
+            responders.push_back(std::make_unique<DHTBootstrap>(DHTBootstrap::generate_random_node_id(),
+                                                                responder_config));
+            node->add_bootstrap_node("127.0.0.1", port);
+        }
+
+        bool joined = false;
+        node->bootstrap([&joined](size_t) { joined = true; });
+        pumpUntil([&joined]() { return joined; });
+        assert(node->get_contacts().size() >= 1);
+    }
+
+    void pumpOnce() {
+        node->run_once(std::chrono::milliseconds(1));
+        for (auto& responder : responders) {
+            responder->run_once(std::chrono::milliseconds(0));
+        }
+    }
+
+    template <typename Done>
+    void pumpUntil(Done done) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+        while (!done() && std::chrono::steady_clock::now() < deadline) {
+            pumpOnce();
+        }
+        assert(done());
+    }
+};
+
+static LookupOptions quietOptions() {
+    LookupOptions options;
+    options.hedge_budget = 0;
+    return options;
+}
+
+// A target sharing the first bytes of base and random after them
+static NodeID withPrefix(const NodeID& base, size_t bytes) {
+    NodeID target = DHTBootstrap::generate_random_node_id();
+    for (size_t i = 0; i < bytes; ++i) {
+        target[i] = base[i];
+    }
+    return target;
+}
+
+void testBudgetBatchesQueries(LocalNetwork& network) {
+    BulkLookupOptions options;
+    options.max_outstanding = 2;
+    options.contact_interval = std::chrono::milliseconds(0);
+    options.shared_prefix_bits = NODE_ID_SIZE * 8;      // Share nothing between random targets
+    auto scheduler = std::make_shared<LookupScheduler>(*network.node, options);
+
+    const size_t lookups = 12;
+    size_t finished = 0;
+    size_t queries = 0;
+    for (size_t i = 0; i < lookups; ++i) {
+        scheduler->lookup(DHTBootstrap::generate_random_node_id(), quietOptions(),
+                          [&finished, &queries](const LookupResult& result) {
+            assert(result.status == LookupResult::Status::Converged);
+            queries += result.queries;
+            finished++;
+        });
+    }
+
+    // Everything beyond the budget waits in the queue
+    BulkLookupStats stats = scheduler->stats();
+    assert(stats.lookups_active == lookups);
+    assert(stats.outstanding == options.max_outstanding);
+    assert(stats.queued > 0);
+
+    size_t peak = 0;
+    network.pumpUntil([&]() {
+        peak = std::max(peak, scheduler->stats().outstanding);
+        return finished == lookups;
+    });
+    assert(peak <= options.max_outstanding);
+
+    stats = scheduler->stats();
+    assert(stats.lookups_active == 0 && stats.outstanding == 0 && stats.queued == 0);
+    assert(stats.sent == queries);
+    assert(stats.deduplicated == 0 && stats.reused == 0);
+
+    std::cout << "Outstanding budget test passed!" << std::endl;
+}
+
+void testSharedPrefixDeduplicated(LocalNetwork& network) {
+    BulkLookupOptions options;
+    options.contact_interval = std::chrono::milliseconds(0);
+    options.shared_prefix_bits = 24;
+    auto scheduler = std::make_shared<LookupScheduler>(*network.node, options);
+
+    // Same 3-byte prefix: every contact gives both targets one answer
+    NodeID base = DHTBootstrap::generate_random_node_id();
+    std::vector<LookupResult> results;
+    for (int i = 0; i < 2; ++i) {
+        scheduler->lookup(withPrefix(base, 3), quietOptions(), [&results](const LookupResult& result) {
+            results.push_back(result);
+        });
+    }
+    network.pumpUntil([&]() { return results.size() == 2; });
+
+    BulkLookupStats stats = scheduler->stats();
+    assert(stats.deduplicated + stats.reused > 0);
+    assert(stats.sent + stats.deduplicated + stats.reused == results[0].queries + results[1].queries);
+    assert(stats.sent < results[0].queries + results[1].queries);
+
+    // Within response_ttl a later lookup is answered without new queries
+    size_t sent = stats.sent;
+    bool done = false;
+    scheduler->lookup(withPrefix(base, 3), quietOptions(), [&done](const LookupResult&) { done = true; });
+    network.pumpUntil([&done]() { return done; });
+    assert(scheduler->stats().sent == sent);
+
+    std::cout << "Shared prefix dedupe test passed!" << std::endl;
+}
+
+void testIdenticalLookupsCompleteInOrder(LocalNetwork& network) {
+    BulkLookupOptions options;
+    options.max_outstanding = 1;
+    options.contact_interval = std::chrono::milliseconds(0);
+    auto scheduler = std::make_shared<LookupScheduler>(*network.node, options);
+
+    // The first lookup's queries carry the rest: each answer reaches the
+    // waiters in the order they joined, so they finish in submission order
+    NodeID target = DHTBootstrap::generate_random_node_id();
+    std::vector<size_t> order;
+    std::vector<LookupResult> results;
+    std::thread::id pumping = std::this_thread::get_id();
+    for (size_t i = 0; i < 5; ++i) {
+        scheduler->lookup(target, quietOptions(), [&, i](const LookupResult& result) {
+            assert(std::this_thread::get_id() == pumping);
+            order.push_back(i);
+            results.push_back(result);
+        });
+    }
+    network.pumpUntil([&]() { return order.size() == 5; });
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        assert(order[i] == i);
+        assert(results[i].closest.size() == results[0].closest.size());
+        for (size_t j = 0; j < results[i].closest.size(); ++j) {
+            assert(results[i].closest[j].id == results[0].closest[j].id);
+        }
+    }
+    assert(scheduler->stats().sent == results[0].queries);
+
+    std::cout << "Completion order test passed!" << std::endl;
+}
+
+int main() {
+    LocalNetwork network;
+
+    testBudgetBatchesQueries(network);
+    testSharedPrefixDeduplicated(network);
+    testIdenticalLookupsCompleteInOrder(network);
+
+    std::cout << "All LookupScheduler tests passed!" << std::endl;
+    return 0;
+}
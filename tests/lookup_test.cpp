@@ -0,0 +1,216 @@
+#include "../include/lookup.hpp"
+#include "../include/dht_bootstrap.hpp"
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <set>
+#include <thread>
+
+// Lookups against a simulated network: a stub QuerySender answers on behalf
+// of contacts that exist only in memory, through the node's timer queue so
+// answers arrive on the pumping thread as real ones do.
+
+using namespace DHT;
+
+static const uint16_t LOCAL_PORT = 46891;
+
+struct StubNetwork {
+    std::vector<Node> nodes;
+    std::set<uint16_t> failing;     // Answer with a KRPC error
+    std::set<uint16_t> silent;      // Never answer (time out at once)
+    std::set<uint16_t> queried;
+    std::vector<QueryCallback> held;    // hold = true: answers kept back
+    bool hold = false;
+
+    explicit StubNetwork(size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            Node node;
+            node.id = DHTBootstrap::generate_random_node_id();
+            node.ip = "127.0.0.1";
+            node.port = static_cast<uint16_t>(20000 + i);
+            nodes.push_back(node);
+        }
+    }
+
+    std::vector<Node> closest(const NodeID& target, size_t k) const {
+        std::vector<Node> sorted = nodes;
+        std::sort(sorted.begin(), sorted.end(), [&](const Node& a, const Node& b) {
+            return xor_distance(a.id, target) < xor_distance(b.id, target);
+        });
+        sorted.resize(std::min(k, sorted.size()));
+        return sorted;
+    }
+
+    static std::string compact(const std::vector<Node>& nodes) {
+        std::string out;
+        for (const auto& node : nodes) {
+            out.append(reinterpret_cast<const char*>(node.id.data()), NODE_ID_SIZE);
+            uint32_t ip = htonl(INADDR_LOOPBACK);
+            uint16_t port = htons(node.port);
+            out.append(reinterpret_cast<const char*>(&ip), 4);
+            out.append(reinterpret_cast<const char*>(&port), 2);
+        }
+        return out;
+    }
+
+    QuerySender sender(DHTBootstrap& dht) {
+        return [this, &dht](const Node& node, const std::string&, BencodedDict args, QueryCallback callback) {
+            queried.insert(node.port);
+            if (hold) {
+                held.push_back(std::move(callback));
+                return;
+            }
+
+            QueryResult result;
+            result.ip = node.ip;
+            result.port = node.port;
+            if (failing.count(node.port)) {
+                result.status = QueryResult::Status::Error;
+                result.message = BencodedValue(BencodedDict{
+                    {"e", BencodedValue(BencodedList{BencodedValue(int64_t(201)), BencodedValue("Generic Error")})}
+                });
+            } else if (!silent.count(node.port)) {
+                const Node& self = *std::find_if(nodes.begin(), nodes.end(), [&](const Node& n) {
+                    return n.port == node.port;
+                });
+                NodeID target;
+                std::memcpy(target.data(), args.at("target").asString().data(), NODE_ID_SIZE);
+                result.status = QueryResult::Status::Response;
+                result.message = BencodedValue(BencodedDict{
+                    {"r", BencodedValue(BencodedDict{
+                        {"id", BencodedValue(std::string(reinterpret_cast<const char*>(self.id.data()), NODE_ID_SIZE))},
+                        {"nodes", BencodedValue(compact(closest(target, 8)))}
+                    })}
+                });
+            }
+            dht.schedule(std::chrono::milliseconds(0), [callback = std::move(callback), result]() {
+                callback(result);
+            });
+        };
+    }
+};
+
+static LookupOptions quietOptions() {
+    LookupOptions options;
+    options.alpha = 3;
+    options.hedge_budget = 0;
+    return options;
+}
+
+static void pumpUntil(DHTBootstrap& dht, const bool& done) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!done && std::chrono::steady_clock::now() < deadline) {
+        dht.run_once(std::chrono::milliseconds(5));
+    }
+    assert(done);
+}
+
+void testConvergesOnClosest(DHTBootstrap& dht) {
+    StubNetwork network(200);
+    NodeID target = DHTBootstrap::generate_random_node_id();
+
+    // The first round meets one erroring and one silent seed. The seeds are
+    // the nodes farthest from the target, so no answer ever names them.
+    std::vector<Node> ranked = network.closest(target, network.nodes.size());
+    std::vector<Node> seeds(ranked.end() - 3, ranked.end());
+    network.failing.insert(seeds[0].port);
+    network.silent.insert(seeds[1].port);
+
+    bool done = false;
+    LookupResult result;
+    auto lookup = std::make_shared<Lookup>(dht, target, quietOptions(), [&](const LookupResult& r) {
+        result = r;
+        done = true;
+    }, network.sender(dht));
+    lookup->start(seeds);
+    pumpUntil(dht, done);
+
+    assert(result.status == LookupResult::Status::Converged);
+    assert(result.errors == 1);
+    assert(result.timeouts == 1);
+    assert(result.responses + result.errors + result.timeouts == result.queries);
+
+    // Every other node answers, so the result is the true k closest
+    assert(result.closest.size() == K);
+    for (size_t i = 0; i < K; ++i) {
+        assert(result.closest[i].id == ranked[i].id);
+    }
+    assert(result.queries < network.nodes.size());
+
+    std::cout << "Lookup convergence test passed!" << std::endl;
+}
+
+void testCancelFromAnotherThread(DHTBootstrap& dht) {
+    StubNetwork network(50);
+    network.hold = true;
+    CancellationToken token;
+    LookupOptions options = quietOptions();
+    options.cancel = token;
+
+    bool done = false;
+    LookupResult result;
+    std::thread::id pumping = std::this_thread::get_id();
+    auto lookup = std::make_shared<Lookup>(dht, DHTBootstrap::generate_random_node_id(), options,
+                                           [&](const LookupResult& r) {
+        assert(std::this_thread::get_id() == pumping);
+        result = r;
+        done = true;
+    }, network.sender(dht));
+    lookup->start({network.nodes[0], network.nodes[1], network.nodes[2], network.nodes[3]});
+    assert(network.queried.size() == 3);
+
+    // The callback waits for the pumping thread
+    std::thread([&token]() { token.cancel(); }).join();
+    assert(!done);
+    pumpUntil(dht, done);
+    assert(result.status == LookupResult::Status::Cancelled);
+    assert(result.closest.empty());
+
+    // Answers arriving after the cancel change nothing
+    for (auto& callback : network.held) {
+        callback(QueryResult{});
+    }
+    assert(result.status == LookupResult::Status::Cancelled);
+
+    std::cout << "Lookup cancellation test passed!" << std::endl;
+}
+
+void testCancelMethod(DHTBootstrap& dht) {
+    StubNetwork network(50);
+    network.hold = true;
+
+    int calls = 0;
+    LookupResult result;
+    auto lookup = std::make_shared<Lookup>(dht, DHTBootstrap::generate_random_node_id(), quietOptions(),
+                                           [&](const LookupResult& r) {
+        result = r;
+        calls++;
+    }, network.sender(dht));
+    lookup->start({network.nodes[0], network.nodes[1]});
+    lookup->cancel();
+    lookup->cancel();
+    assert(calls == 0);
+
+    bool done = false;
+    dht.schedule(std::chrono::milliseconds(20), [&done]() { done = true; });
+    pumpUntil(dht, done);
+    assert(calls == 1);
+    assert(result.status == LookupResult::Status::Cancelled);
+
+    std::cout << "Lookup::cancel test passed!" << std::endl;
+}
+
+int main() {
+    DHTConfig config;
+    config.port = LOCAL_PORT;
+    DHTBootstrap dht(DHTBootstrap::generate_random_node_id(), config);
+
+    testConvergesOnClosest(dht);
+    testCancelFromAnotherThread(dht);
+    testCancelMethod(dht);
+
+    std::cout << "All Lookup tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "../include/node_trie.hpp"
+#include "../include/dht_bootstrap.hpp"
+#include <iostream>
+#include <cassert>
+#include <algorithm>
+
+using namespace DHT;
+
+static Node makeNode(uint16_t port) {
+    Node node;
+    node.id = DHTBootstrap::generate_random_node_id();
+    node.ip = "127.0.0.1";
+    node.port = port;
+    return node;
+}
+
+void testClosestMatchesBruteForce() {
+    NodeTrie trie;
+    std::vector<Node> nodes;
+    for (uint16_t i = 0; i < 2000; ++i) {
+        nodes.push_back(makeNode(i));
+        trie.insert(nodes.back());
+    }
+    assert(trie.size() == nodes.size());
+
+    for (int round = 0; round < 50; ++round) {
+        NodeID target = DHTBootstrap::generate_random_node_id();
+        std::vector<Node> expected = nodes;
+        std::sort(expected.begin(), expected.end(), [&](const Node& a, const Node& b) {
+            return xor_distance(a.id, target) < xor_distance(b.id, target);
+        });
+        expected.resize(K);
+
+        std::vector<Node> actual = trie.closest(target, K);
+        assert(actual == expected);
+    }
+
+    std::cout << "Closest-nodes traversal test passed!" << std::endl;
+}
+
+void testEraseAndUpdate() {
+    NodeTrie trie;
+    Node a = makeNode(1);
+    Node b = makeNode(2);
+    assert(trie.insert(a));
+    assert(trie.insert(b));
+
+    a.port = 1234;
+    assert(!trie.insert(a)); // Same ID: address update, not a new entry
+    assert(trie.size() == 2);
+    assert(trie.closest(a.id, 1)[0].port == 1234);
+
+    assert(trie.erase(a.id));
+    assert(!trie.erase(a.id));
+    assert(!trie.contains(a.id));
+    assert(trie.contains(b.id));
+    assert(trie.size() == 1);
+
+    std::cout << "Erase/update test passed!" << std::endl;
+}
+
+void testEvictionSkipsPinned() {
+    NodeTrie trie(2);
+    Node pinned = makeNode(1);
+    Node second = makeNode(2);
+    Node third = makeNode(3);
+
+    trie.insert(pinned);
+    trie.pin(pinned.id);
+    trie.insert(second);
+    trie.insert(third); // Over capacity: oldest unpinned entry goes
+
+    assert(trie.size() == 2);
+    assert(trie.contains(pinned.id));
+    assert(!trie.contains(second.id));
+    assert(trie.contains(third.id));
+
+    std::cout << "Eviction test passed!" << std::endl;
+}
+
+int main() {
+    testClosestMatchesBruteForce();
+    testEraseAndUpdate();
+    testEvictionSkipsPinned();
+
+    std::cout << "All NodeTrie tests passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include "../include/transaction_manager.hpp"
+#include <iostream>
+#include <cassert>
+#include <chrono>
+#include <string>
+
+using namespace DHT;
+using Clock = TransactionManager::Clock;
+
+static const uint32_t REMOTE_IP = 0x0100007f; // 127.0.0.1, network byte order
+static const uint16_t REMOTE_PORT = 6881;
+
+static std::string begin(TransactionManager& manager, Clock::time_point deadline, int* calls,
+                         QueryResult::Status* status = nullptr) {
+    std::string transaction_id;
+    bool ok = manager.begin(REMOTE_IP, REMOTE_PORT, deadline, [calls, status](const QueryResult& result) {
+        (*calls)++;
+        if (status) {
+            *status = result.status;
+        }
+    }, transaction_id);
+    assert(ok);
+    assert(transaction_id.size() == 2);
+    return transaction_id;
+}
+
+static uint16_t idValue(const std::string& transaction_id) {
+    return static_cast<uint16_t>((static_cast<uint8_t>(transaction_id[0]) << 8) |
+                                 static_cast<uint8_t>(transaction_id[1]));
+}
+
+void testIdWraparound() {
+    TransactionManager manager(4);
+    Clock::time_point later = Clock::now() + std::chrono::hours(1);
+    int calls = 0;
+
+    // Walk the whole 16-bit ID space; the next ID after 0xffff is 0 again
+    std::string first = begin(manager, later, &calls);
+    assert(idValue(first) == 0);
+    QueryResult response;
+    response.status = QueryResult::Status::Response;
+    assert(manager.complete(first, REMOTE_IP, REMOTE_PORT, response));
+    for (uint32_t i = 1; i <= 0xffff; ++i) {
+        std::string id = begin(manager, later, &calls);
+        assert(idValue(id) == i);
+        assert(manager.cancel(id));
+    }
+    std::string wrapped = begin(manager, later, &calls);
+    assert(idValue(wrapped) == 0);
+
+    // An answer to an ID from before the wrap that reuses the slot is
+    // matched to the live query only if the full ID agrees
+    std::string stale = {'\x00', '\x04'};   // Same slot as 0 in a 4-slot table
+    assert(!manager.complete(stale, REMOTE_IP, REMOTE_PORT, response));
+    assert(manager.pending() == 1);
+
+    // The walk skips slots still in use: 4 maps onto wrapped's slot
+    for (uint16_t i = 1; i <= 3; ++i) {
+        assert(manager.cancel(begin(manager, later, &calls)));
+    }
+    std::string next = begin(manager, later, &calls);
+    assert(idValue(next) == 5);
+    assert(manager.cancel(wrapped));
+    assert(manager.cancel(next));
+    assert(calls == 1);
+
+    std::cout << "Transaction ID wraparound test passed!" << std::endl;
+}
+
+void testFullTable() {
+    TransactionManager manager(2);
+    Clock::time_point later = Clock::now() + std::chrono::hours(1);
+    int calls = 0;
+    std::string a = begin(manager, later, &calls);
+    begin(manager, later, &calls);
+
+    std::string rejected;
+    assert(!manager.begin(REMOTE_IP, REMOTE_PORT, later, [](const QueryResult&) {}, rejected));
+    assert(manager.cancel(a));
+    assert(manager.begin(REMOTE_IP, REMOTE_PORT, later, [](const QueryResult&) {}, rejected));
+
+    std::cout << "Full table test passed!" << std::endl;
+}
+
+void testTimeoutExpiry() {
+    TransactionManager manager(16);
+    Clock::time_point now = Clock::now();
+    int soon_calls = 0;
+    int later_calls = 0;
+    QueryResult::Status soon_status = QueryResult::Status::Response;
+    std::string soon = begin(manager, now + std::chrono::milliseconds(10), &soon_calls, &soon_status);
+    std::string later = begin(manager, now + std::chrono::seconds(10), &later_calls);
+    assert(manager.next_deadline() == now + std::chrono::milliseconds(10));
+
+    assert(manager.expire(now) == 0);
+    assert(manager.expire(now + std::chrono::milliseconds(20)) == 1);
+    assert(soon_calls == 1 && soon_status == QueryResult::Status::Timeout);
+    assert(later_calls == 0);
+    assert(manager.pending() == 1);
+    assert(manager.next_deadline() == now + std::chrono::seconds(10));
+
+    // A late answer to the expired query is not delivered again
+    QueryResult response;
+    response.status = QueryResult::Status::Response;
+    assert(!manager.complete(soon, REMOTE_IP, REMOTE_PORT, response));
+    assert(soon_calls == 1);
+
+    // Answers are only accepted from the queried address
+    assert(!manager.complete(later, REMOTE_IP, REMOTE_PORT + 1, response));
+    assert(manager.complete(later, REMOTE_IP, REMOTE_PORT, response));
+    assert(later_calls == 1);
+    assert(manager.pending() == 0);
+
+    // Its deadline entry is stale and only goes once expire() passes it
+    assert(manager.expire(now + std::chrono::hours(1)) == 0);
+    assert(manager.next_deadline() == Clock::time_point::max());
+
+    std::cout << "Timeout expiry test passed!" << std::endl;
+}
+
+int main() {
+    testIdWraparound();
+    testFullTable();
+    testTimeoutExpiry();
+
+    std::cout << "All TransactionManager tests passed!" << std::endl;
+    return 0;
+}